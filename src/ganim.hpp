@@ -3,6 +3,8 @@
 #include "ganim/gl/all_gl.hpp"
 #include "ganim/object/all_object.hpp"
 #include "ganim/scene/all_scene.hpp"
+#include "ganim/video_writer/frame_sink.hpp"
+#include "ganim/video_writer/image_sequence_writer.hpp"
 #include "ganim/video_writer/video_writer.hpp"
 #include "ganim/color.hpp"
 #include "ganim/math.hpp"
@@ -1,11 +1,18 @@
 #include "transform.hpp"
 
+#include <algorithm>
+#include <memory>
+#include <numeric>
 #include <ranges>
+#include <span>
+#include <unordered_map>
 
 #include "ganim/scene/base.hpp"
 #include "ganim/animation/animation.hpp"
 #include "ganim/object/bases/single_object.hpp"
 #include "ganim/gl/gl.hpp"
+#include "ganim/gl/scratch_pool.hpp"
+#include "ganim/gl/stats.hpp"
 #include "ganim/object/shaders.hpp"
 #include "ganim/math.hpp"
 
@@ -16,23 +23,65 @@
 using namespace ganim;
 
 namespace {
+    // The texture that one or more static parts were drawn into, each in its
+    // own square cell
+    struct PartAtlas {
+        gl::Texture object_texture = 0;
+        gl::Texture distance_transform = 0;
+        int size = 0;
+        std::vector<float> distances;
+        const std::vector<float>& get_distances()
+        {
+            if (distances.empty()) {
+                distances.resize(std::size_t(size) * size);
+                glGetTextureImage(
+                    distance_transform, 0, GL_RED, GL_FLOAT,
+                    distances.size() * sizeof(float), distances.data()
+                );
+            }
+            return distances;
+        }
+    };
+    // The largest size of an atlas that more than one part is drawn into
+    constexpr int max_atlas_size = 2048;
+    // Finds where the cell at a given point along a Z-order curve is.  When
+    // the cells are sorted from largest to smallest, every cell starts at a
+    // multiple of its own area, so it ends up at a multiple of its own size.
+    int deinterleave_bits(std::uint64_t value)
+    {
+        auto result = 0;
+        for (int i = 0; value != 0; ++i, value >>= 2) {
+            result |= int(value & 1) << i;
+        }
+        return result;
+    }
     struct StaticPart : public Animatable {
         std::optional<ObjectPtr<Object>> M_tracked_object;
         Object& tracked_object() {return **M_tracked_object;}
-        gl::Texture M_object_texture = 0;
-        gl::Texture M_distance_transform = 0;
+        // The parts that are drawn at the same time as this one, or null if
+        // it's drawn by itself
+        std::shared_ptr<std::vector<StaticPart*>> M_batch;
+        std::shared_ptr<PartAtlas> M_atlas;
         Box M_bounding_box;
         double M_x1 = 0;
         double M_x2 = 0;
         double M_y1 = 0;
         double M_y2 = 0;
+        int M_cell_x = 0;
+        int M_cell_y = 0;
         int M_texture_size = 0;
         int M_texture_width = 0;
         int M_texture_height = 0;
         std::pair<unsigned, unsigned> get_textures(const Camera& camera)
         {
-            if (M_object_texture == 0) generate_textures(camera);
-            return {M_object_texture, M_distance_transform};
+            if (!M_atlas) {
+                if (M_batch) generate_textures(camera, *M_batch);
+                else {
+                    auto self = this;
+                    generate_textures(camera, std::span(&self, 1));
+                }
+            }
+            return {M_atlas->object_texture, M_atlas->distance_transform};
         }
         static void draw_object(const Camera& camera, Object& object)
         {
@@ -49,91 +98,114 @@ namespace {
                 object.draw(camera);
             }
         }
-        void generate_textures(const Camera& camera)
+        // This must be called with the rotor of the tracked object undone
+        void measure(double gtp, bool padded)
         {
-            auto rotor = tracked_object().get_rotor();
-            tracked_object().apply_rotor(~rotor);
-
             M_bounding_box = tracked_object().get_true_bounding_box();
             using namespace pga3;
             auto p1 = M_bounding_box.get_inner_lower_left().undual();
             auto p2 = M_bounding_box.get_outer_upper_right().undual();
-            const auto x1 = p1.blade_project<e1>();
-            const auto x2 = p2.blade_project<e1>();
-            const auto y1 = p1.blade_project<e2>();
-            const auto y2 = p2.blade_project<e2>();
+            M_x1 = p1.blade_project<e1>();
+            M_x2 = p2.blade_project<e1>();
+            M_y1 = p1.blade_project<e2>();
+            M_y2 = p2.blade_project<e2>();
             const auto z1 = p1.blade_project<e3>();
             const auto z2 = p2.blade_project<e3>();
-            if (z2 - z1 > std::max(x2 - x1, y2 - y1) * 1e-10) {
-                tracked_object().apply_rotor(rotor);
+            if (z2 - z1 > std::max(M_x2 - M_x1, M_y2 - M_y1) * 1e-10) {
                 throw std::runtime_error("A texture transform was attempted"
                         " on an object that seems to have 3D extent.");
             }
-            const auto size_base = std::max(x2 - x1, y2 - y1);
-
-            auto current_draw_framebuffer = 0;
-            auto current_read_framebuffer = 0;
-            auto current_viewport = std::array<int, 4>{0};
-            auto current_blend = (unsigned char)false;
-            glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &current_draw_framebuffer);
-            glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &current_read_framebuffer);
-            glGetIntegerv(GL_VIEWPORT, current_viewport.data());
-            glGetBooleanv(GL_BLEND, &current_blend);
-            glEnable(GL_BLEND);
-            const auto camera_width = camera.get_starting_width();
-            const auto gtp = current_viewport[2] / camera_width;
-            M_texture_size = std::max(
-                int(std::bit_ceil(static_cast<unsigned>(size_base * gtp))), 8);
-            M_texture_width = (x2 - x1) * gtp;
-            M_texture_height = (y2 - y1) * gtp;
+            const auto size_base = std::max(M_x2 - M_x1, M_y2 - M_y1);
+            // Parts that share a texture get at least a pixel of room on each
+            // side so that filtering doesn't mix them together
+            M_texture_size = std::max(int(std::bit_ceil(static_cast<unsigned>(
+                size_base * gtp + (padded ? 2 : 0)))), 8);
+            M_texture_width = (M_x2 - M_x1) * gtp;
+            M_texture_height = (M_y2 - M_y1) * gtp;
+        }
+        void draw_to_cell(double gtp)
+        {
+            glViewport(M_cell_x, M_cell_y, M_texture_size, M_texture_size);
+            glScissor(M_cell_x, M_cell_y, M_texture_size, M_texture_size);
             const auto size = M_texture_size / gtp;
+            auto fake_camera = Camera(20, size, -size);
+            using namespace pga3;
+            fake_camera.shift((M_x1 + M_x2)/2*e1 + (M_y1 + M_y2)/2*e2);
 
-            auto framebuffer = gl::Framebuffer();
-            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-            M_object_texture = gl::Texture();
-            glBindTexture(GL_TEXTURE_2D, M_object_texture);
+            bool is_visible = tracked_object().is_visible();
+            if (!is_visible) tracked_object().set_visible(true);
+            auto old_peeling_depth_buffer
+                = tracked_object().peeling_depth_buffer();
+            auto old_weighted = tracked_object().weighted_transparency();
+            tracked_object().set_peeling_depth_buffer(nullptr);
+            tracked_object().set_weighted_transparency(false);
+            draw_object(fake_camera, tracked_object());
+            tracked_object().set_peeling_depth_buffer(old_peeling_depth_buffer);
+            tracked_object().set_weighted_transparency(old_weighted);
+            if (!is_visible) tracked_object().set_visible(false);
+        }
+        // Draws some parts into an atlas and finds its distance transform.
+        // This returns false if the atlas couldn't be drawn to.
+        static bool draw_atlas(
+            PartAtlas& atlas,
+            std::span<StaticPart* const> parts,
+            double gtp
+        )
+        {
+            atlas.object_texture = gl::Texture();
+            glBindTexture(GL_TEXTURE_2D, atlas.object_texture);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
             glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F,
-                         M_texture_size, M_texture_size, 0,
+                         atlas.size, atlas.size, 0,
                          GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
             glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                                   GL_TEXTURE_2D, M_object_texture, 0);
+                                   GL_TEXTURE_2D, atlas.object_texture, 0);
             auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-            if (status != GL_FRAMEBUFFER_COMPLETE) {
-                tracked_object().apply_rotor(rotor);
-                throw std::runtime_error("Error: Framebuffer is not complete "
-                        "when performing a texture transform.");
-            }
-            glViewport(0, 0, M_texture_size, M_texture_size);
+            if (status != GL_FRAMEBUFFER_COMPLETE) return false;
+            glViewport(0, 0, atlas.size, atlas.size);
             glClearColor(0, 0, 0, 0);
             glClear(GL_COLOR_BUFFER_BIT);
 
-            auto fake_camera = Camera(20, size, -size);
-            fake_camera.shift((x1 + x2)/2*e1 + (y1 + y2)/2*e2);
+            glEnable(GL_SCISSOR_TEST);
+            for (auto part : parts) part->draw_to_cell(gtp);
+            glDisable(GL_SCISSOR_TEST);
 
-            bool is_visible = tracked_object().is_visible();
-            if (!is_visible) tracked_object().set_visible(true);
-            auto old_peeling_depth_buffer = tracked_object().peeling_depth_buffer();
-            tracked_object().set_peeling_depth_buffer(nullptr);
-            draw_object(fake_camera, tracked_object());
-            tracked_object().set_peeling_depth_buffer(old_peeling_depth_buffer);
-            if (!is_visible) tracked_object().set_visible(false);
-
-            M_distance_transform = distance_transform(
-                alpha_threshold(
-                    M_object_texture,
-                    0.01,
-                    M_texture_size,
-                    M_texture_size
-                ),
-                M_texture_size,
-                1.0/M_texture_size
+            auto threshold = alpha_threshold(
+                atlas.object_texture,
+                0.01,
+                atlas.size,
+                atlas.size
             );
+            if (parts.size() == 1) {
+                atlas.distance_transform = distance_transform(
+                    threshold,
+                    atlas.size,
+                    1.0/atlas.size
+                );
+            }
+            else {
+                auto regions = std::vector<DistanceTransformRegion>();
+                for (auto part : parts) {
+                    regions.push_back({
+                        part->M_cell_x,
+                        part->M_cell_y,
+                        part->M_texture_size,
+                        part->M_texture_size
+                    });
+                }
+                atlas.distance_transform = distance_transform(
+                    threshold,
+                    atlas.size,
+                    atlas.size,
+                    regions,
+                    1.0/atlas.size
+                );
+            }
 
-            glBindTexture(GL_TEXTURE_2D, M_distance_transform);
+            glBindTexture(GL_TEXTURE_2D, atlas.distance_transform);
             glTexParameteri(
                 GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR
             );
@@ -143,22 +215,135 @@ namespace {
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
             glGenerateMipmap(GL_TEXTURE_2D);
+            return true;
+        }
+        // Packs the parts into as few square textures as possible, draws
+        // them, and finds the distance transform of each texture all at once
+        static void generate_textures(
+            const Camera& camera,
+            std::span<StaticPart* const> parts
+        )
+        {
+            auto current_draw_framebuffer = 0;
+            auto current_read_framebuffer = 0;
+            auto current_viewport = std::array<int, 4>{0};
+            auto current_blend = (unsigned char)false;
+            auto current_scissor = (unsigned char)false;
+            auto max_texture_size = 0;
+            glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &current_draw_framebuffer);
+            glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &current_read_framebuffer);
+            glGetIntegerv(GL_VIEWPORT, current_viewport.data());
+            glGetBooleanv(GL_BLEND, &current_blend);
+            glGetBooleanv(GL_SCISSOR_TEST, &current_scissor);
+            glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+            const auto camera_width = camera.get_starting_width();
+            const auto gtp = current_viewport[2] / camera_width;
+            auto restore = [&]{
+                gl::stats.framebuffer_changes += 2;
+                glBindFramebuffer(
+                    GL_DRAW_FRAMEBUFFER, current_draw_framebuffer);
+                glBindFramebuffer(
+                    GL_READ_FRAMEBUFFER, current_read_framebuffer);
+                glViewport(
+                    current_viewport[0], current_viewport[1],
+                    current_viewport[2], current_viewport[3]
+                );
+                if (current_blend) glEnable(GL_BLEND);
+                else glDisable(GL_BLEND);
+                if (current_scissor) glEnable(GL_SCISSOR_TEST);
+                else glDisable(GL_SCISSOR_TEST);
+            };
 
-            M_x1 = x1;
-            M_x2 = x2;
-            M_y1 = y1;
-            M_y2 = y2;
+            auto rotors = std::vector<pga3::Even>();
+            rotors.reserve(parts.size());
+            for (auto part : parts) {
+                rotors.push_back(part->tracked_object().get_rotor());
+                part->tracked_object().apply_rotor(~rotors.back());
+            }
+            auto undo_rotors = [&]{
+                for (std::size_t i = 0; i < rotors.size(); ++i) {
+                    parts[i]->tracked_object().apply_rotor(rotors[i]);
+                }
+            };
+            try {
+                for (auto part : parts) part->measure(gtp, parts.size() > 1);
+            }
+            catch (...) {
+                undo_rotors();
+                throw;
+            }
 
-            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, current_draw_framebuffer);
-            glBindFramebuffer(GL_READ_FRAMEBUFFER, current_read_framebuffer);
-            glViewport(
-                current_viewport[0], current_viewport[1],
-                current_viewport[2], current_viewport[3]
-            );
-            if (current_blend) glEnable(GL_BLEND);
-            else glDisable(GL_BLEND);
+            auto order = std::vector<std::size_t>(parts.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::ranges::stable_sort(order, std::ranges::greater(),
+                    [&](auto i) {return parts[i]->M_texture_size;});
+            // An RGBA32F atlas this big already takes 64 MiB, and finding its
+            // distance transform needs a few more textures of the same size,
+            // so more parts than this are split into several atlases.  A part
+            // that's bigger than this by itself still gets its own atlas.
+            const auto atlas_size = std::min(max_texture_size, max_atlas_size);
+            const auto max_area = std::uint64_t(atlas_size) * atlas_size;
+
+            glEnable(GL_BLEND);
+            glDisable(GL_SCISSOR_TEST);
+            auto framebuffer = gl::get_scratch_framebuffer();
+            ++gl::stats.framebuffer_changes;
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            auto begin = std::size_t(0);
+            while (begin < order.size()) {
+                auto atlas = std::make_shared<PartAtlas>();
+                auto atlas_parts = std::vector<StaticPart*>();
+                auto area = std::uint64_t(0);
+                for (auto end = begin; end < order.size(); ++end) {
+                    auto part = parts[order[end]];
+                    const auto size = std::uint64_t(part->M_texture_size);
+                    if (!atlas_parts.empty() and area + size*size > max_area) {
+                        break;
+                    }
+                    part->M_cell_x = deinterleave_bits(area);
+                    part->M_cell_y = deinterleave_bits(area >> 1);
+                    part->M_atlas = atlas;
+                    atlas_parts.push_back(part);
+                    area += size*size;
+                }
+                begin += atlas_parts.size();
+                atlas->size = atlas_parts.front()->M_texture_size;
+                while (std::uint64_t(atlas->size) * atlas->size < area) {
+                    atlas->size *= 2;
+                }
+                if (!draw_atlas(*atlas, atlas_parts, gtp)) {
+                    for (auto part : parts) part->M_atlas = nullptr;
+                    undo_rotors();
+                    restore();
+                    throw std::runtime_error("Error: Framebuffer is not "
+                            "complete when performing a texture transform.");
+                }
+            }
 
-            tracked_object().apply_rotor(rotor);
+            restore();
+            undo_rotors();
+        }
+        // Gets the distance at a pixel in this part's cell
+        float get_distance(int x, int y)
+        {
+            const auto& distances = M_atlas->get_distances();
+            x = std::min(x, M_texture_size - 1);
+            y = std::min(y, M_texture_size - 1);
+            return distances[M_cell_x + x
+                + std::size_t(M_cell_y + y) * M_atlas->size];
+        }
+        // Gets the texture coordinates of the corners of the object
+        std::array<float, 4> get_texture_coordinates() const
+        {
+            const auto size = double(M_atlas->size);
+            const auto x = M_cell_x + (M_texture_size - M_texture_width)/2.0;
+            const auto y = M_cell_y + (M_texture_size - M_texture_height)/2.0;
+            return {
+                float(x / size),
+                float((x + M_texture_width) / size),
+                float(y / size),
+                float((y + M_texture_height) / size)
+            };
         }
     };
     struct TransformingPart : public SingleObject {
@@ -212,36 +397,69 @@ namespace {
         }
 
         virtual void draw(const Camera& camera) override
+        {
+            auto textures = prepare(camera);
+            auto& shader = use_shader(camera);
+            bind_textures(textures);
+            draw_part(camera, shader);
+        }
+        // Makes sure that the textures exist, and returns the object and
+        // distance transform textures of both ends
+        std::array<unsigned, 4> prepare(const Camera& camera)
         {
             auto [from_object, from_distance_transform]
                 = M_from->get_textures(camera);
             auto [to_object, to_distance_transform]
                 = M_to->get_textures(camera);
 
-            if (M_scale1 == 0) {
-                get_scales(from_distance_transform, to_distance_transform);
+            if (M_scale1 == 0) get_scales();
+            return {
+                from_object,
+                from_distance_transform,
+                to_object,
+                to_distance_transform
+            };
+        }
+        gl::Shader& use_shader(const Camera& camera)
+        {
+            auto features = ShaderFeature::TextureTransform;
+            if (peeling_depth_buffer()) features |= ShaderFeature::DepthPeeling;
+            if (weighted_transparency()) {
+                features |= ShaderFeature::WeightedTransparency;
             }
-
+            auto& shader = get_shader(features);
+            ++gl::stats.program_changes;
+            glUseProgram(shader);
+            if (auto buffer = peeling_depth_buffer()) {
+                bind_peeling_depth_buffer(shader, *buffer);
+            }
+            glUniform2f(shader.get_uniform("camera_scale"),
+                        camera.get_x_scale(), camera.get_y_scale());
+            shader.set_rotor_uniform("view", ~camera.get_rotor());
+            glUniform1f(shader.get_uniform("scale"), 1.0);
+            glUniform1i(shader.get_uniform("object1"), 0);
+            glUniform1i(shader.get_uniform("distance_transform1"), 1);
+            glUniform1i(shader.get_uniform("object2"), 2);
+            glUniform1i(shader.get_uniform("distance_transform2"), 3);
+            return shader;
+        }
+        static void bind_textures(const std::array<unsigned, 4>& textures)
+        {
+            for (int i = 0; i < 4; ++i) {
+                glActiveTexture(GL_TEXTURE0 + i);
+                glBindTexture(GL_TEXTURE_2D, textures[i]);
+            }
+        }
+        // Draws this part with a shader from use_shader and the textures from
+        // prepare already bound
+        void draw_part(const Camera& camera, gl::Shader& shader)
+        {
             float x1 = M_from->M_x1 * (1 - M_t) + M_to->M_x1 * M_t;
             float x2 = M_from->M_x2 * (1 - M_t) + M_to->M_x2 * M_t;
             float y1 = M_from->M_y1 * (1 - M_t) + M_to->M_y1 * M_t;
             float y2 = M_from->M_y2 * (1 - M_t) + M_to->M_y2 * M_t;
-            float t1x1 = (1 - double(M_from->M_texture_width)
-                    / M_from->M_texture_size)/2;
-            float t1x2 = (1 + double(M_from->M_texture_width)
-                    / M_from->M_texture_size)/2;
-            float t1y1 = (1 - double(M_from->M_texture_height)
-                    / M_from->M_texture_size)/2;
-            float t1y2 = (1 + double(M_from->M_texture_height)
-                    / M_from->M_texture_size)/2;
-            float t2x1 = (1 - double(M_to  ->M_texture_width)
-                    / M_to  ->M_texture_size)/2;
-            float t2x2 = (1 + double(M_to  ->M_texture_width)
-                    / M_to  ->M_texture_size)/2;
-            float t2y1 = (1 - double(M_to  ->M_texture_height)
-                    / M_to  ->M_texture_size)/2;
-            float t2y2 = (1 + double(M_to  ->M_texture_height)
-                    / M_to  ->M_texture_size)/2;
+            auto [t1x1, t1x2, t1y1, t1y2] = M_from->get_texture_coordinates();
+            auto [t2x1, t2x2, t2y1, t2y2] = M_to->get_texture_coordinates();
             M_vertices = {{
                 {x1, y2, t1x1, t1y2, t2x1, t2y2},
                 {x2, y2, t1x2, t1y2, t2x2, t2y2},
@@ -249,22 +467,10 @@ namespace {
                 {x2, y1, t1x2, t1y1, t2x2, t2y1}
             }};
 
-            auto features = ShaderFeature::TextureTransform;
-            if (peeling_depth_buffer()) features |= ShaderFeature::DepthPeeling;
-            auto& shader = get_shader(features);
-            glUseProgram(shader);
-            if (auto buffer = peeling_depth_buffer()) {
-                glUniform1i(shader.get_uniform("layer_depth_buffer"), 15);
-                glActiveTexture(GL_TEXTURE15);
-                glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, *buffer);
-            }
-            glUniform2f(shader.get_uniform("camera_scale"),
-                        camera.get_x_scale(), camera.get_y_scale());
-            auto view = ~camera.get_rotor();
-            shader.set_rotor_uniform("view", view);
             auto model = get_rotor();
             if (is_fixed_orientation()) {
                 using namespace pga3;
+                auto view = ~camera.get_rotor();
                 auto view_euclidean =
                     view.blade_project<e>() +
                     view.blade_project<e12>() * e12 +
@@ -273,7 +479,6 @@ namespace {
                 model = ~view_euclidean * model;
             }
             shader.set_rotor_uniform("model", model);
-            glUniform1f(shader.get_uniform("scale"), 1.0);
             glUniform1f(shader.get_uniform("depth_z"), get_depth_z());
 
             glBindVertexArray(M_vertex_array);
@@ -295,22 +500,11 @@ namespace {
                                   reinterpret_cast<void*>(4*sizeof(float)));
             glEnableVertexAttribArray(2);
 
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, from_object);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, from_distance_transform);
-            glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D, to_object);
-            glActiveTexture(GL_TEXTURE3);
-            glBindTexture(GL_TEXTURE_2D, to_distance_transform);
-            glUniform1i(shader.get_uniform("object1"), 0);
-            glUniform1i(shader.get_uniform("distance_transform1"), 1);
-            glUniform1i(shader.get_uniform("object2"), 2);
-            glUniform1i(shader.get_uniform("distance_transform2"), 3);
             glUniform1f(shader.get_uniform("t"), M_t);
             glUniform1f(shader.get_uniform("scale1"), M_scale1);
             glUniform1f(shader.get_uniform("scale2"), M_scale2);
 
+            ++gl::stats.draw_calls;
             glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
             glBindVertexArray(0);
         }
@@ -323,70 +517,40 @@ namespace {
             SingleObject::draw_outline(camera);
             scale(this_scale);
         }
-        void get_scales(unsigned from, unsigned to)
+        virtual bool has_outline() const override
+        {
+            // The outline is drawn at a scale of one, so the scale of this
+            // object doesn't matter
+            return get_outline_thickness() != 0.0;
+        }
+        void get_scales()
         {
-            const auto from_size = M_from->M_texture_size;
-            const auto to_size = M_to->M_texture_size;
-
-            auto from_values = std::vector<float>();
-            from_values.resize(from_size * from_size);
-            glGetTextureImage(
-                from, 0, GL_RED, GL_FLOAT,
-                from_size * from_size * sizeof(float), from_values.data()
-            );
-
-            auto to_values = std::vector<float>();
-            to_values.resize(to_size * to_size);
-            glGetTextureImage(
-                to, 0, GL_RED, GL_FLOAT,
-                to_size * to_size * sizeof(float), to_values.data()
-            );
-
             const auto from_width = M_from->M_texture_width;
             const auto from_height = M_from->M_texture_height;
-            const auto from_x_plus = (from_size - from_width) / 2;
-            const auto from_y_plus = (from_size - from_height) / 2;
+            const auto from_x_plus = (M_from->M_texture_size - from_width) / 2;
+            const auto from_y_plus = (M_from->M_texture_size - from_height) / 2;
             const auto to_width = M_to->M_texture_width;
             const auto to_height = M_to->M_texture_height;
-            const auto to_x_plus = (to_size - to_width) / 2;
-            const auto to_y_plus = (to_size - to_height) / 2;
+            const auto to_x_plus = (M_to->M_texture_size - to_width) / 2;
+            const auto to_y_plus = (M_to->M_texture_size - to_height) / 2;
             for (int x = 0; x < from_width; ++x) {
                 for (int y = 0; y < from_height; ++y) {
-                    int x1 = std::min(x + from_x_plus, from_size - 1);
-                    int y1 = std::min(y + from_y_plus, from_size - 1);
-                    if (from_values[x1 + y1*from_size] == 0) {
-                        int x2 = std::min(
+                    if (M_from->get_distance(x + from_x_plus, y + from_y_plus)
+                            == 0) {
+                        M_scale1 = std::max(M_scale1, M_to->get_distance(
                             int(double(x)/from_width * to_width) + to_x_plus,
-                            to_size - 1
-                        );
-                        int y2 = std::min(
-                            int(double(y)/from_height * to_height) + to_y_plus,
-                            to_size - 1
-                        );
-                        M_scale1 = std::max(
-                            M_scale1,
-                            to_values[x2 + y2*to_size]
-                        );
+                            int(double(y)/from_height * to_height) + to_y_plus
+                        ));
                     }
                 }
             }
             for (int x = 0; x < to_width; ++x) {
                 for (int y = 0; y < to_height; ++y) {
-                    int x1 = std::min(x + to_x_plus, to_size - 1);
-                    int y1 = std::min(y + to_y_plus, to_size - 1);
-                    if (to_values[x1 + y1*to_size] == 0) {
-                        int x2 = std::min(
+                    if (M_to->get_distance(x + to_x_plus, y + to_y_plus) == 0) {
+                        M_scale2 = std::max(M_scale2, M_from->get_distance(
                             int(double(x)/to_width * from_width) + from_x_plus,
-                            from_size - 1
-                        );
-                        int y2 = std::min(
-                            int(double(y)/to_height * from_height)+ from_y_plus,
-                            from_size - 1
-                        );
-                        M_scale2 = std::max(
-                            M_scale2,
-                            from_values[x2 + y2*from_size]
-                        );
+                            int(double(y)/to_height * from_height)+ from_y_plus
+                        ));
                     }
                 }
             }
@@ -463,6 +627,86 @@ namespace {
         float M_scale1 = 0;
         float M_scale2 = 0;
     };
+    // Draws every pair of subobjects in a group transform.  All of the
+    // static parts are drawn into shared textures the first time that any of
+    // them are needed, and the transforming parts are all drawn with the same
+    // shader.
+    struct TransformingGroup : public SingleObject {
+        virtual void interpolate(
+            const Animatable&,
+            const Animatable&,
+            double t
+        ) override
+        {
+            M_t = t;
+            auto opacity = 1.0;
+            auto alpha = 255;
+            for (auto& part : M_parts) {
+                part->interpolate(*part->M_from, *part->M_to, t);
+                opacity = std::min(opacity, part->get_opacity());
+                alpha = std::min(alpha, int(part->get_color().a));
+            }
+            // The scene uses these to decide when to draw this
+            auto color = get_color();
+            color.a = alpha;
+            set_color(color);
+            set_opacity(opacity);
+            set_depth_z(M_from_depth_z * (1 - t) + M_to_depth_z * t);
+        }
+        virtual void draw(const Camera& camera) override
+        {
+            auto textures = std::vector<std::array<unsigned, 4>>();
+            textures.reserve(M_parts.size());
+            for (auto& part : M_parts) {
+                textures.push_back(part->prepare(camera));
+            }
+            auto& shader = M_parts.front()->use_shader(camera);
+            for (std::size_t i = 0; i < M_parts.size(); ++i) {
+                if (i == 0 or textures[i] != textures[i - 1]) {
+                    TransformingPart::bind_textures(textures[i]);
+                }
+                M_parts[i]->draw_part(camera, shader);
+            }
+        }
+        virtual void draw_outline(const Camera& camera) override
+        {
+            for (auto& part : M_parts) {
+                if (part->has_outline()) part->draw_outline(camera);
+            }
+        }
+        virtual bool has_outline() const override
+        {
+            return std::ranges::any_of(M_parts,
+                    [](auto& part) {return part->has_outline();});
+        }
+        virtual void set_peeling_depth_buffer(gl::Texture* texture) override
+        {
+            SingleObject::set_peeling_depth_buffer(texture);
+            for (auto& part : M_parts) part->set_peeling_depth_buffer(texture);
+        }
+        virtual void set_weighted_transparency(bool weighted) override
+        {
+            SingleObject::set_weighted_transparency(weighted);
+            for (auto& part : M_parts) {
+                part->set_weighted_transparency(weighted);
+            }
+        }
+        virtual Box get_original_true_bounding_box() const override
+        {
+            if (M_parts.empty()) return Box();
+            auto result = M_parts.front()->get_true_bounding_box();
+            for (auto& part : M_parts | std::views::drop(1)) {
+                result = merge_boxes(result, part->get_true_bounding_box());
+            }
+            return result;
+        }
+
+        std::vector<ObjectPtr<TransformingPart>> M_parts;
+        std::vector<ObjectPtr<StaticPart>> M_static_parts;
+        double M_from_depth_z = 0;
+        double M_to_depth_z = 0;
+        double M_t = 0;
+    };
 }
 
 void ganim::texture_transform(
@@ -514,12 +758,75 @@ void ganim::group_transform(
     TransformAnimationArgs args
 )
 {
+    auto pairs = std::vector<std::pair<ObjectPtr<Object>, ObjectPtr<Object>>>();
     auto indices = discrete_interpolate(from->size(), to->size());
     for (int i = 0; i < ssize(indices); ++i) {
         for (auto j : indices[i]) {
-            texture_transform(scene, from[i], to[j], args);
+            pairs.emplace_back(from[i], to[j]);
         }
     }
+    for (auto& [from_object, to_object] : pairs) {
+        if (from_object->is_animating()) {
+            throw std::invalid_argument(std::format(
+                "Attempting to animate an object that is already being "
+                "animated.  Stacktrace:\n{}", std::stacktrace::current()
+            ));
+        }
+    }
+    auto to_objects = std::vector<Object*>();
+    for (auto& [from_object, to_object] : pairs) {
+        to_object->set_animating(true);
+        scene.add(to_object);
+        if (!args.copy) from_object->set_visible(false);
+        to_objects.push_back(to_object.get());
+    }
+
+    auto temp_object = ObjectPtr<TransformingGroup>();
+    auto& object = *temp_object;
+    object.set_visible(true);
+    if (from->is_fixed_in_frame()) object.set_fixed_in_frame(true);
+    object.M_from_depth_z = from->get_depth_z();
+    object.M_to_depth_z = to->get_depth_z();
+    // Each subobject only gets drawn once, even if it's in several pairs
+    auto batch = std::make_shared<std::vector<StaticPart*>>();
+    auto static_parts = std::unordered_map<Object*, StaticPart*>();
+    auto get_static_part = [&](const ObjectPtr<Object>& tracked) {
+        auto& result = static_parts[tracked.get()];
+        if (!result) {
+            auto part = ObjectPtr<StaticPart>();
+            part->M_tracked_object = tracked;
+            part->M_batch = batch;
+            result = part.get();
+            batch->push_back(result);
+            object.M_static_parts.push_back(std::move(part));
+        }
+        return result;
+    };
+    for (auto& [from_object, to_object] : pairs) {
+        auto part = ObjectPtr<TransformingPart>();
+        part->set_visible(true);
+        part->M_from = get_static_part(from_object);
+        part->M_to = get_static_part(to_object);
+        object.M_parts.push_back(std::move(part));
+    }
+
+    auto anim = Animation(
+        scene,
+        temp_object,
+        {args.duration, args.rate_function}
+    );
+    anim.at_end([to_objects = std::move(to_objects)]{
+        for (auto to_object : to_objects) {
+            to_object->set_visible(true);
+            to_object->set_animating(false);
+        }
+    });
+    object.add_updater(std::move(anim), true);
+    object.add_updater([&object = object, direction = args.direction]{
+        for (auto& part : object.M_parts) {
+            part->shift(std::sin(object.M_t * τ/2)*direction);
+        }
+    });
 }
 
 // TODO: Generalize this and animation to remove code copying
@@ -50,6 +50,13 @@ void texture_transform(
  * This will map the elements of the first group onto the elements of the second
  * group and then do a texture_transform on each pair.
  *
+ * The pairs are all done together.  Every subobject is drawn into the same
+ * texture (or a few textures for very large groups), their distance transforms
+ * are all calculated at once, and all of the pairs are drawn with the same
+ * shader, which is much faster than doing each pair separately for groups with
+ * a lot of subobjects like text.  All of the outlines are drawn before any of
+ * the pairs.
+ *
  * It will not actually modify from or to, except that from will be made not
  * visible at the start of the animation, and to will be made visible at the end
  * of the animation.
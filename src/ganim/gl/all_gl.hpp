@@ -1,6 +1,9 @@
 #include "ganim/gl/gl.hpp"
 #include "ganim/gl/buffer.hpp"
+#include "ganim/gl/context.hpp"
 #include "ganim/gl/framebuffer.hpp"
+#include "ganim/gl/scratch_pool.hpp"
 #include "ganim/gl/shader.hpp"
+#include "ganim/gl/stats.hpp"
 #include "ganim/gl/texture.hpp"
 #include "ganim/gl/vertex_array.hpp"
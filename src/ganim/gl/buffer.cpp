@@ -1,11 +1,13 @@
 #include "buffer.hpp"
 
+#include "context.hpp"
 #include "gl.hpp"
 
 using namespace ganim::gl;
 
 Buffer::Buffer()
 {
+    ensure_context();
     glGenBuffers(1, &M_id);
 }
 
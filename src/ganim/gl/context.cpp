@@ -0,0 +1,135 @@
+#include "context.hpp"
+
+#include <cstdlib>
+#include <format>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <SFML/Window.hpp>
+
+#include "gl.hpp"
+
+using namespace ganim;
+using namespace ganim::gl;
+
+namespace {
+    bool G_created = false;
+    ContextBackend G_backend = ContextBackend::Automatic;
+    std::unique_ptr<sf::Context> G_sfml_context;
+
+    void debug_callback(
+        GLenum source,
+        GLenum type,
+        GLuint id,
+        GLenum severity,
+        GLsizei length,
+        const GLchar* message,
+        const void*
+    )
+    {
+        if (severity == GL_DEBUG_SEVERITY_NOTIFICATION) return;
+        throw std::runtime_error(std::format(
+            "OpenGL Error:\n"
+            "Source: {}\n"
+            "Type: {}\n"
+            "ID: {}\n"
+            "Severity: {}\n"
+            "Message: {}\n",
+            source, type, id, severity, std::string_view(message, length)));
+    }
+
+    ContextBackend choose_backend()
+    {
+        if (G_backend != ContextBackend::Automatic) return G_backend;
+        if (auto env = std::getenv("GANIM_GL_BACKEND")) {
+            auto name = std::string_view(env);
+            if (name == "sfml") return ContextBackend::SFML;
+            if (name == "egl") return ContextBackend::EGL;
+            throw std::runtime_error(std::format(
+                "Unknown OpenGL backend \"{}\" in GANIM_GL_BACKEND", name));
+        }
+        if (std::getenv("DISPLAY") or std::getenv("WAYLAND_DISPLAY")) {
+            return ContextBackend::SFML;
+        }
+        return ContextBackend::EGL;
+    }
+
+    void create_sfml_context()
+    {
+        auto settings = sf::ContextSettings(
+            24, 0, 4, 4, 3, sf::ContextSettings::Debug);
+        G_sfml_context = std::make_unique<sf::Context>(
+            settings, sf::Vector2u{1, 1});
+    }
+
+    void create_egl_context()
+    {
+        auto display = eglGetPlatformDisplay(
+            EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display == EGL_NO_DISPLAY) {
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+        if (display == EGL_NO_DISPLAY or
+                !eglInitialize(display, nullptr, nullptr)) {
+            throw std::runtime_error("Unable to initialize EGL");
+        }
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            throw std::runtime_error("EGL doesn't support desktop OpenGL");
+        }
+        const EGLint config_attributes[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        auto config = EGLConfig(EGL_NO_CONFIG_KHR);
+        auto config_count = EGLint(0);
+        eglChooseConfig(display, config_attributes, &config, 1, &config_count);
+        if (config_count == 0) config = EGL_NO_CONFIG_KHR;
+        // Ask for a compatibility context to match what SFML makes, but a core
+        // context is fine too.
+        for (auto profile : {EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+                             EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT}) {
+            const EGLint context_attributes[] = {
+                EGL_CONTEXT_MAJOR_VERSION, 4,
+                EGL_CONTEXT_MINOR_VERSION, 3,
+                EGL_CONTEXT_OPENGL_PROFILE_MASK, profile,
+                EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE,
+                EGL_NONE
+            };
+            auto context = eglCreateContext(
+                display, config, EGL_NO_CONTEXT, context_attributes);
+            if (context == EGL_NO_CONTEXT) continue;
+            if (!eglMakeCurrent(
+                    display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+                eglDestroyContext(display, context);
+                throw std::runtime_error(
+                    "Unable to make the EGL context current");
+            }
+            return;
+        }
+        throw std::runtime_error(
+            "Unable to create an OpenGL 4.3 context with EGL");
+    }
+}
+
+void gl::set_context_backend(ContextBackend backend)
+{
+    G_backend = backend;
+}
+
+void gl::ensure_context()
+{
+    if (G_created) return;
+    G_created = true;
+    try {
+        if (choose_backend() == ContextBackend::SFML) create_sfml_context();
+        else create_egl_context();
+    }
+    catch (...) {
+        G_created = false;
+        throw;
+    }
+    glDebugMessageCallback(debug_callback, nullptr);
+}
@@ -0,0 +1,45 @@
+#ifndef GANIM_GL_CONTEXT_HPP
+#define GANIM_GL_CONTEXT_HPP
+
+/** @file
+ * @brief Functions for creating the OpenGL context that ganim draws with.
+ */
+
+namespace ganim::gl {
+    /** @brief The ways that ganim can create an OpenGL context. */
+    enum class ContextBackend {
+        /** @brief Pick a backend at runtime.
+         *
+         * If the environment variable `GANIM_GL_BACKEND` is set to "sfml" or
+         * "egl", that backend is used.  Otherwise, SFML is used when there's
+         * a display to connect to, and EGL is used when there isn't.
+         */
+        Automatic,
+        /** @brief Use SFML, which needs a windowing system. */
+        SFML,
+        /** @brief Use a surfaceless EGL context, which doesn't need a
+         * windowing system or a GPU.
+         */
+        EGL
+    };
+
+    /** @brief Choose how the OpenGL context is created.
+     *
+     * This must be called before anything uses OpenGL, or else it won't do
+     * anything.
+     */
+    void set_context_backend(ContextBackend backend);
+
+    /** @brief Make sure that an OpenGL context exists.
+     *
+     * The context is created the first time this is called.  Every OpenGL
+     * wrapper in this directory calls this when it is created, so you only need
+     * to call this yourself if you call OpenGL functions before making any of
+     * them.
+     *
+     * @throw std::runtime_error If the context can't be created.
+     */
+    void ensure_context();
+}
+
+#endif
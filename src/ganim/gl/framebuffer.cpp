@@ -1,11 +1,13 @@
 #include "framebuffer.hpp"
 
+#include "ganim/gl/context.hpp"
 #include "ganim/gl/gl.hpp"
 
 using namespace ganim::gl;
 
 Framebuffer::Framebuffer()
 {
+    ensure_context();
     glGenFramebuffers(1, &M_id);
 }
 
@@ -0,0 +1,221 @@
+#include "scratch_pool.hpp"
+
+#include <format>
+#include <list>
+#include <stdexcept>
+#include <vector>
+
+#include "ganim/gl/gl.hpp"
+
+using namespace ganim::gl;
+
+namespace {
+    struct PooledTexture {
+        Texture texture;
+        int width = 0;
+        int height = 0;
+        unsigned format = 0;
+        std::size_t bytes = 0;
+    };
+    struct Pool {
+        // The most recently returned texture is at the front
+        std::list<PooledTexture> textures;
+        std::vector<Framebuffer> framebuffers;
+        std::size_t memory = 0;
+        std::size_t budget = 512 << 20;
+    };
+    // Framebuffers are cheap, so only a few are kept in case something
+    // borrows a lot of them at once
+    constexpr std::size_t max_framebuffers = 8;
+
+    Pool& pool()
+    {
+        // This is never destroyed so that it doesn't try to delete anything
+        // after the context is gone
+        static auto& result = *new Pool;
+        return result;
+    }
+
+    std::size_t bytes_per_pixel(unsigned format)
+    {
+        switch (format) {
+            case GL_R8:
+            case GL_R8UI:
+                return 1;
+            case GL_RG8:
+            case GL_R16F:
+                return 2;
+            case GL_RGBA8:
+            case GL_RG16F:
+            case GL_R32F:
+            case GL_R32UI:
+                return 4;
+            case GL_RGBA16F:
+            case GL_RG32F:
+                return 8;
+            case GL_RGBA32F:
+            case GL_RGBA32UI:
+                return 16;
+            default:
+                // Guessing would make the pool's budget wrong
+                throw std::invalid_argument(std::format(
+                    "Unsupported scratch texture format {:#x}", format));
+        }
+    }
+
+    void shrink_to(std::size_t bytes)
+    {
+        auto& p = pool();
+        while (p.memory > bytes) {
+            p.memory -= p.textures.back().bytes;
+            p.textures.pop_back();
+        }
+    }
+}
+
+ScratchTexture::~ScratchTexture()
+{
+    give_back();
+}
+
+ScratchTexture::ScratchTexture(ScratchTexture&& other) noexcept
+:   M_texture(std::move(other.M_texture)),
+    M_width(other.M_width),
+    M_height(other.M_height),
+    M_format(other.M_format)
+{}
+
+ScratchTexture& ScratchTexture::operator=(ScratchTexture&& other) noexcept
+{
+    if (this != &other) {
+        give_back();
+        M_texture = std::move(other.M_texture);
+        M_width = other.M_width;
+        M_height = other.M_height;
+        M_format = other.M_format;
+    }
+    return *this;
+}
+
+Texture ScratchTexture::release()
+{
+    return std::move(M_texture);
+}
+
+void ScratchTexture::give_back()
+{
+    if (!M_texture) return;
+    auto& p = pool();
+    const auto bytes = std::size_t(M_width) * M_height
+        * bytes_per_pixel(M_format);
+    if (bytes > p.budget) {
+        M_texture = 0;
+        return;
+    }
+    shrink_to(p.budget - bytes);
+    p.textures.push_front(
+        {std::move(M_texture), M_width, M_height, M_format, bytes});
+    p.memory += bytes;
+}
+
+ScratchFramebuffer::~ScratchFramebuffer()
+{
+    give_back();
+}
+
+ScratchFramebuffer::ScratchFramebuffer(ScratchFramebuffer&& other) noexcept
+:   M_framebuffer(std::move(other.M_framebuffer))
+{}
+
+ScratchFramebuffer& ScratchFramebuffer::operator=(
+    ScratchFramebuffer&& other
+) noexcept
+{
+    if (this != &other) {
+        give_back();
+        M_framebuffer = std::move(other.M_framebuffer);
+    }
+    return *this;
+}
+
+void ScratchFramebuffer::give_back()
+{
+    if (!M_framebuffer) return;
+    // Otherwise the attached texture couldn't be freed while the framebuffer
+    // is in the pool
+    glNamedFramebufferTexture(M_framebuffer, GL_COLOR_ATTACHMENT0, 0, 0);
+    auto& p = pool();
+    if (p.framebuffers.size() < max_framebuffers) {
+        p.framebuffers.push_back(std::move(M_framebuffer));
+    }
+    M_framebuffer = 0;
+}
+
+ScratchTexture ganim::gl::get_scratch_texture(
+    int width,
+    int height,
+    unsigned format
+)
+{
+    if (width <= 0 or height <= 0) {
+        throw std::invalid_argument(std::format(
+            "The size of a scratch texture must be positive, not {}x{}",
+            width, height));
+    }
+    // This checks the format before anything is made with it, so returning
+    // the texture to the pool later can't fail
+    bytes_per_pixel(format);
+    auto result = ScratchTexture();
+    result.M_width = width;
+    result.M_height = height;
+    result.M_format = format;
+    auto& p = pool();
+    for (auto it = p.textures.begin(); it != p.textures.end(); ++it) {
+        if (it->width == width and it->height == height
+                and it->format == format) {
+            result.M_texture = std::move(it->texture);
+            p.memory -= it->bytes;
+            p.textures.erase(it);
+            return result;
+        }
+    }
+    result.M_texture = Texture();
+    glBindTexture(GL_TEXTURE_2D, result.M_texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return result;
+}
+
+ScratchFramebuffer ganim::gl::get_scratch_framebuffer()
+{
+    auto result = ScratchFramebuffer();
+    auto& p = pool();
+    if (p.framebuffers.empty()) {
+        result.M_framebuffer = Framebuffer();
+    }
+    else {
+        result.M_framebuffer = std::move(p.framebuffers.back());
+        p.framebuffers.pop_back();
+    }
+    return result;
+}
+
+void ganim::gl::clear_scratch_pool()
+{
+    auto& p = pool();
+    p.textures.clear();
+    p.framebuffers.clear();
+    p.memory = 0;
+}
+
+void ganim::gl::set_scratch_pool_budget(std::size_t bytes)
+{
+    auto& p = pool();
+    p.budget = bytes;
+    shrink_to(bytes);
+}
+
+std::size_t ganim::gl::get_scratch_pool_memory()
+{
+    return pool().memory;
+}
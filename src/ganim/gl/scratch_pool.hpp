@@ -0,0 +1,118 @@
+#ifndef GANIM_GL_SCRATCH_POOL_HPP
+#define GANIM_GL_SCRATCH_POOL_HPP
+
+/** @file
+ * @brief Framebuffers and textures that are reused between offscreen passes.
+ *
+ * Things like outlines and texture transforms draw to a temporary
+ * framebuffer and texture, process the result with a few more temporary
+ * textures, and then throw all of them away.  Making large floating point
+ * textures in the middle of a frame is slow on a lot of drivers, so instead
+ * of making new ones every time, these passes borrow them from a pool.  A
+ * borrowed object is returned to the pool when its handle is destroyed.
+ *
+ * Textures are pooled by their size and format.  They're made with
+ * `glTexStorage2D` with one mipmap level, and their contents and parameters
+ * are whatever the last user left them as.
+ */
+
+#include <cstddef>
+
+#include "framebuffer.hpp"
+#include "texture.hpp"
+
+namespace ganim::gl {
+    /** @brief A texture borrowed from the scratch pool.
+     *
+     * Like @ref Texture, this is implicitly convertible to the texture id.
+     * When it is destroyed, the texture is returned to the pool rather than
+     * being deleted.
+     */
+    class ScratchTexture {
+        public:
+            ScratchTexture()=default;
+            ~ScratchTexture();
+            ScratchTexture(ScratchTexture&&) noexcept;
+            ScratchTexture& operator=(ScratchTexture&&) noexcept;
+            ScratchTexture(const ScratchTexture&)=delete;
+            ScratchTexture& operator=(const ScratchTexture&)=delete;
+            operator unsigned() const {return M_texture;}
+
+            /** @brief Keep the texture instead of returning it to the pool.
+             *
+             * After this, this object no longer refers to any texture.
+             */
+            Texture release();
+
+            int get_width() const {return M_width;}
+            int get_height() const {return M_height;}
+            /** @brief Get the sized internal format, like `GL_RGBA32F`. */
+            unsigned get_format() const {return M_format;}
+
+        private:
+            friend ScratchTexture get_scratch_texture(int, int, unsigned);
+            void give_back();
+
+            Texture M_texture = 0;
+            int M_width = 0;
+            int M_height = 0;
+            unsigned M_format = 0;
+    };
+
+    /** @brief A framebuffer borrowed from the scratch pool.
+     *
+     * When it is destroyed, its color attachment is detached and it is
+     * returned to the pool.
+     */
+    class ScratchFramebuffer {
+        public:
+            ScratchFramebuffer()=default;
+            ~ScratchFramebuffer();
+            ScratchFramebuffer(ScratchFramebuffer&&) noexcept;
+            ScratchFramebuffer& operator=(ScratchFramebuffer&&) noexcept;
+            ScratchFramebuffer(const ScratchFramebuffer&)=delete;
+            ScratchFramebuffer& operator=(const ScratchFramebuffer&)=delete;
+            operator unsigned() const {return M_framebuffer;}
+
+        private:
+            friend ScratchFramebuffer get_scratch_framebuffer();
+            void give_back();
+
+            Framebuffer M_framebuffer = 0;
+    };
+
+    /** @brief Borrow a texture from the scratch pool, making a new one if
+     * there isn't one with this size and format.
+     *
+     * @param width The width of the texture, in pixels.
+     * @param height The height of the texture, in pixels.
+     * @param format The sized internal format, like `GL_RGBA32F`.
+     * @throw std::invalid_argument If the size isn't positive or the pool
+     * doesn't know how big the format is.
+     */
+    ScratchTexture get_scratch_texture(int width, int height, unsigned format);
+    /** @brief Borrow a framebuffer from the scratch pool, making a new one if
+     * there isn't one.
+     */
+    ScratchFramebuffer get_scratch_framebuffer();
+
+    /** @brief Delete everything in the scratch pool.
+     *
+     * Objects that are currently borrowed aren't affected.
+     */
+    void clear_scratch_pool();
+    /** @brief Set how many bytes of textures the scratch pool keeps around.
+     *
+     * When a texture is returned to a pool that already has this much, the
+     * textures that were returned the longest time ago are deleted to make
+     * room for it.  The default is 512 MiB.
+     */
+    void set_scratch_pool_budget(std::size_t bytes);
+    /** @brief Get the number of bytes of textures in the scratch pool.
+     *
+     * This doesn't count textures that are currently borrowed.
+     */
+    std::size_t get_scratch_pool_memory();
+}
+
+#endif
@@ -1,7 +1,9 @@
 #include "shader.hpp"
 
+#include <algorithm>
 #include <array>
 #include <iostream>
+#include "context.hpp"
 #include "gl.hpp"
 
 using namespace ganim::gl;
@@ -18,6 +20,7 @@ const std::vector<const char*>& Shader::Source::source() const
 
 Shader::Shader(const Source& vertex, const Source& fragment)
 {
+    ensure_context();
     unsigned int vertex_shader = glCreateShader(GL_VERTEX_SHADER);
     if (!compile_part(vertex_shader, vertex, "vertex")) return;
     unsigned int fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
@@ -28,6 +31,8 @@ Shader::Shader(const Source& vertex, const Source& fragment)
     M_program_id = glCreateProgram();
     glAttachShader(M_program_id, vertex_shader);
     glAttachShader(M_program_id, fragment_shader);
+    glProgramParameteri(
+        M_program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(M_program_id);
     glDeleteShader(vertex_shader);
     glDeleteShader(fragment_shader);
@@ -50,6 +55,7 @@ Shader::Shader(
     const Source& fragment
 )
 {
+    ensure_context();
     unsigned int vertex_shader = glCreateShader(GL_VERTEX_SHADER);
     compile_part(vertex_shader, vertex, "vertex");
     unsigned int geometry_shader = glCreateShader(GL_GEOMETRY_SHADER);
@@ -67,6 +73,8 @@ Shader::Shader(
     glAttachShader(M_program_id, vertex_shader);
     glAttachShader(M_program_id, geometry_shader);
     glAttachShader(M_program_id, fragment_shader);
+    glProgramParameteri(
+        M_program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(M_program_id);
     glDeleteShader(vertex_shader);
     glDeleteShader(geometry_shader);
@@ -86,12 +94,15 @@ Shader::Shader(
 
 Shader::Shader(const Source& compute)
 {
+    ensure_context();
     constexpr auto C_log_size = std::size_t(512);
     auto info_log = std::array<char, 512>{0};
     unsigned int compute_shader = glCreateShader(GL_COMPUTE_SHADER);
     if (!compile_part(compute_shader, compute, "compute")) return;
     M_program_id = glCreateProgram();
     glAttachShader(M_program_id, compute_shader);
+    glProgramParameteri(
+        M_program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(M_program_id);
     glDeleteShader(compute_shader);
     int success = 0;
@@ -105,6 +116,35 @@ Shader::Shader(const Source& compute)
     }
 }
 
+Shader::Shader(const Binary& binary)
+{
+    ensure_context();
+    if (binary.data.empty()) return;
+    // Passing an unsupported format is an OpenGL error rather than just a
+    // failed link, so check for it first
+    int format_count = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    auto formats = std::vector<int>(format_count);
+    if (format_count > 0) {
+        glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+    }
+    if (std::ranges::find(formats, static_cast<int>(binary.format))
+            == formats.end()) {
+        return;
+    }
+    M_program_id = glCreateProgram();
+    glProgramParameteri(
+        M_program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glProgramBinary(M_program_id, binary.format, binary.data.data(),
+                    binary.data.size());
+    int success = 0;
+    glGetProgramiv(M_program_id, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(M_program_id);
+        M_program_id = 0;
+    }
+}
+
 bool Shader::compile_part(
     unsigned int shader,
     const Source& source,
@@ -175,6 +215,20 @@ void Shader::set_rotor_uniform(const char* name, const pga3::Even& rotor)
     glUniform4fv(pos, 2, vals.data());
 }
 
+Shader::Binary Shader::get_binary() const
+{
+    auto result = Binary();
+    if (!M_program_id) return result;
+    int length = 0;
+    glGetProgramiv(M_program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return result;
+    result.data.resize(length);
+    glGetProgramBinary(M_program_id, length, &length, &result.format,
+                       result.data.data());
+    result.data.resize(length);
+    return result;
+}
+
 void Shader::set_plane_uniform(const char* name, const pga3::Vec& plane)
 {
     using namespace pga3;
@@ -5,6 +5,7 @@
  * @brief Contains the @ref ganim::gl::Shader "Shader" class
  */
 
+#include <cstdint>
 #include <vector>
 
 #include "ganim/ga/pga3.hpp"
@@ -40,6 +41,13 @@ namespace ganim::gl {
                 private:
                     std::vector<const char*> M_source;
             };
+            /** @brief A linked shader program in the driver's own binary
+             * format, as returned by @ref get_binary.
+             */
+            struct Binary {
+                unsigned format = 0;
+                std::vector<std::uint8_t> data;
+            };
             /** @brief Create a shader with corresponding vertex and fragment
              * sources.
              */
@@ -55,6 +63,14 @@ namespace ganim::gl {
             /** @brief Create a compute shader
              */
             Shader(const Source& compute);
+            /** @brief Create a shader from a binary made by @ref get_binary.
+             *
+             * Drivers are allowed to reject binaries, for example after they
+             * have been updated.  If that happens, the shader's id will be
+             * zero, so you can check for it by converting the shader to an
+             * unsigned integer.
+             */
+            explicit Shader(const Binary& binary);
             ~Shader();
             Shader(Shader&&) noexcept;
             Shader(const Shader&)=delete;
@@ -74,6 +90,13 @@ namespace ganim::gl {
              */
             void set_rotor_uniform(const char* name, const pga3::Even& rotor);
             void set_plane_uniform(const char* name, const pga3::Vec& plane);
+            /** @brief Get the linked program in the driver's binary format.
+             *
+             * This can be saved and passed to the constructor later to skip
+             * compiling and linking the shader again.  The binary will be empty
+             * if the driver doesn't support getting it.
+             */
+            Binary get_binary() const;
 
         private:
             unsigned M_program_id = 0;
@@ -0,0 +1,44 @@
+#ifndef GANIM_GL_STATS_HPP
+#define GANIM_GL_STATS_HPP
+
+/** @file
+ * @brief Contains @ref ganim::gl::stats "stats", which counts how much work is
+ * sent to OpenGL.
+ */
+
+#include <cstdint>
+
+namespace ganim::gl {
+    /** @brief Counts of the OpenGL calls that are expensive enough to be worth
+     * keeping track of.
+     *
+     * These only ever go up, so to see how many happened during something,
+     * take the difference between two snapshots.
+     */
+    struct Stats {
+        /** @brief Calls to `glDrawElements` and friends */
+        std::uint64_t draw_calls = 0;
+        /** @brief Calls to `glUseProgram` */
+        std::uint64_t program_changes = 0;
+        /** @brief Calls to `glBindFramebuffer` */
+        std::uint64_t framebuffer_changes = 0;
+
+        Stats operator-(const Stats& other) const
+        {
+            return {
+                draw_calls - other.draw_calls,
+                program_changes - other.program_changes,
+                framebuffer_changes - other.framebuffer_changes
+            };
+        }
+    };
+
+    /** @brief The counts since the program started.
+     *
+     * Every place in ganim that makes one of the counted calls increments
+     * this right next to it.
+     */
+    inline Stats stats;
+}
+
+#endif
@@ -1,14 +1,33 @@
 #include "texture.hpp"
 
+#include <unordered_map>
 #include <vector>
 
+#include "ganim/gl/context.hpp"
 #include "ganim/gl/gl.hpp"
 #include "ganim/util/stb_image_write.h"
 
 using namespace ganim::gl;
 
+namespace {
+    std::unordered_map<unsigned, std::uint32_t>& generations()
+    {
+        // This is never destroyed so that textures destroyed at exit can
+        // still use it
+        static auto& result = *new std::unordered_map<unsigned, std::uint32_t>;
+        return result;
+    }
+
+    void delete_texture(unsigned id)
+    {
+        glDeleteTextures(1, &id);
+        ++generations()[id];
+    }
+}
+
 Texture::Texture(std::uint8_t* data, int width, int height)
 {
+    ensure_context();
     glGenTextures(1, &M_id);
     glBindTexture(GL_TEXTURE_2D, M_id);
     glTexParameteri(
@@ -26,12 +45,13 @@ Texture::Texture(std::uint8_t* data, int width, int height)
 
 Texture::Texture()
 {
+    ensure_context();
     glGenTextures(1, &M_id);
 }
 
 Texture::~Texture()
 {
-    if (M_id) glDeleteTextures(1, &M_id);
+    if (M_id) delete_texture(M_id);
 }
 
 Texture::Texture(Texture&& other) noexcept : M_id(other.M_id)
@@ -42,13 +62,24 @@ Texture::Texture(Texture&& other) noexcept : M_id(other.M_id)
 Texture& Texture::operator=(Texture&& other) noexcept
 {
     if (this != &other) {
-        if (M_id) glDeleteTextures(1, &M_id);
+        if (M_id) delete_texture(M_id);
         M_id = other.M_id;
         other.M_id = 0;
     }
     return *this;
 }
 
+std::uint32_t Texture::get_generation(unsigned id)
+{
+    auto it = generations().find(id);
+    return it == generations().end() ? 0 : it->second;
+}
+
+void Texture::mark_modified(unsigned id)
+{
+    ++generations()[id];
+}
+
 void Texture::write_to_file(std::string filename)
 {
     int w = -1;
@@ -41,6 +41,24 @@ namespace ganim::gl {
 
             void write_to_file(std::string filename);
 
+            /** @brief Get how many times a texture id has been deleted or
+             * marked as modified.
+             *
+             * OpenGL reuses the ids of deleted textures, so the id alone
+             * doesn't say which texture it is.  The id together with this
+             * does, for as long as the program runs, and it also tells apart
+             * what a texture had in it before and after it was drawn to again
+             * (see @ref mark_modified).
+             */
+            static std::uint32_t get_generation(unsigned id);
+            /** @brief Note that the contents of a texture have changed.
+             *
+             * Call this after drawing to a texture that already had something
+             * in it, so that things that were made from the old contents,
+             * like shared outlines, aren't used for the new contents.
+             */
+            static void mark_modified(unsigned id);
+
         private:
             unsigned M_id = 0;
     };
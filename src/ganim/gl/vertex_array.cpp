@@ -1,11 +1,13 @@
 #include "vertex_array.hpp"
 
+#include "context.hpp"
 #include "gl.hpp"
 
 using namespace ganim::gl;
 
 VertexArray::VertexArray()
 {
+    ensure_context();
     glGenVertexArrays(1, &M_id);
 }
 
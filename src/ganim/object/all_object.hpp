@@ -1,6 +1,8 @@
 #include "ganim/object/bases/animatable.hpp"
 #include "ganim/object/bases/transformable.hpp"
 #include "ganim/object/bases/object.hpp"
+#include "ganim/object/bases/outline_cache.hpp"
+#include "ganim/object/bases/outline_geometry.hpp"
 #include "ganim/object/shaders.hpp"
 #include "ganim/object/shape.hpp"
 #include "ganim/object/bases/group.hpp"
@@ -6,6 +6,8 @@
 
 #include "group.hpp"
 
+#include "ganim/object/shape_batch.hpp"
+
 using namespace ganim;
 
 Group::Group(const Group& other)
@@ -38,6 +40,64 @@ void Group::copy_members(const Group& other)
     M_draw_together = other.M_draw_together;
 }
 
+Group::Group(Group&& other) noexcept
+:   Object(std::move(other)),
+    M_subobjects(std::move(other.M_subobjects)),
+    M_ratio(other.M_ratio),
+    M_outline_thickness(other.M_outline_thickness),
+    M_outline_color(other.M_outline_color),
+    M_propogate(other.M_propogate),
+    M_draw_together(other.M_draw_together)
+{
+    other.M_subobjects.clear();
+    // The subobjects still think they're in the other group
+    for (auto& obj : M_subobjects) {
+        std::ranges::replace(obj->M_parent_groups.groups, &other, this);
+    }
+}
+
+Group& Group::operator=(Group&& other) noexcept
+{
+    if (this == &other) return *this;
+    detach_subobjects();
+    auto old_subobjects = std::move(M_subobjects);
+    Object::operator=(std::move(other));
+    copy_members(other);
+    M_subobjects = std::move(other.M_subobjects);
+    other.M_subobjects.clear();
+    for (auto& obj : M_subobjects) {
+        std::ranges::replace(obj->M_parent_groups.groups, &other, this);
+    }
+    for (auto& obj : old_subobjects) notify_removed(*obj);
+    for (auto& obj : M_subobjects) notify_added(obj);
+    invalidate_bounding_box();
+    return *this;
+}
+
+Group::~Group()
+{
+    detach_subobjects();
+}
+
+void Group::detach_subobjects()
+{
+    for (auto& obj : M_subobjects) {
+        auto& groups = obj->M_parent_groups.groups;
+        if (auto it = std::ranges::find(groups, this); it != groups.end()) {
+            groups.erase(it);
+        }
+    }
+}
+
+void Group::clear()
+{
+    detach_subobjects();
+    auto old_subobjects = std::move(M_subobjects);
+    M_subobjects.clear();
+    for (auto& obj : old_subobjects) notify_removed(*obj);
+    invalidate_bounding_box();
+}
+
 Group& Group::operator=(const Group& other)
 {
     Object::operator=(other);
@@ -51,23 +111,54 @@ Group& Group::operator=(const Group& other)
 
 void Group::add(ObjectPtr<Object> object)
 {
-    M_new_subobjects.push_back(object);
-    M_subobjects.push_back(std::move(object));
+    object->M_parent_groups.groups.push_back(this);
+    M_subobjects.push_back(object);
+    invalidate_bounding_box();
+    notify_added(object);
 }
 
 void Group::remove(Object& object)
 {
     for (auto it = M_subobjects.begin(); it != M_subobjects.end(); ++it) {
         if (&**it == &object) {
+            auto& groups = object.M_parent_groups.groups;
+            if (auto it2 = std::ranges::find(groups, this);
+                    it2 != groups.end()) {
+                groups.erase(it2);
+            }
+            // Keep the object alive until the observers are done with it
+            auto removed = std::move(*it);
             M_subobjects.erase(it);
+            invalidate_bounding_box();
+            notify_removed(object);
             break;
         }
     }
-    for (auto it = M_new_subobjects.begin(); it != M_new_subobjects.end();++it){
-        if (&**it == &object) {
-            M_new_subobjects.erase(it);
-            break;
-        }
+}
+
+void Group::add_observer(GroupObserver& observer)
+{
+    if (std::ranges::find(M_observers, &observer) == M_observers.end()) {
+        M_observers.push_back(&observer);
+    }
+}
+
+void Group::remove_observer(GroupObserver& observer)
+{
+    std::erase(M_observers, &observer);
+}
+
+void Group::notify_added(const ObjectPtr<Object>& object)
+{
+    for (auto observer : M_observers) {
+        observer->subobject_added(*this, object);
+    }
+}
+
+void Group::notify_removed(Object& object)
+{
+    for (auto observer : M_observers) {
+        observer->subobject_removed(*this, object);
     }
 }
 
@@ -114,11 +205,18 @@ void Group::interpolate(const Animatable& start, const Animatable& end, double t
 }
 
 void Group::draw(const Camera& camera)
+{
+    if (!M_draw_together) return;
+    auto batch = ShapeBatch(camera);
+    draw_batched(batch);
+}
+
+void Group::draw_batched(ShapeBatch& batch)
 {
     if (!M_draw_together) return;
     for (auto drawable : M_subobjects) {
         if (drawable->is_visible()) {
-            drawable->draw(camera);
+            drawable->draw_batched(batch);
         }
     }
 }
@@ -131,6 +229,16 @@ bool Group::is_visible() const
     return false;
 }
 
+bool Group::changed_since(std::uint64_t version) const
+{
+    if (!M_draw_together) return false;
+    if (Object::changed_since(version)) return true;
+    for (auto drawable : M_subobjects) {
+        if (drawable->changed_since(version)) return true;
+    }
+    return false;
+}
+
 void Group::draw_outline(const Camera& camera)
 {
     if (!M_draw_together) return;
@@ -141,6 +249,15 @@ void Group::draw_outline(const Camera& camera)
     }
 }
 
+bool Group::has_outline() const
+{
+    if (!M_draw_together) return false;
+    for (auto drawable : M_subobjects) {
+        if (drawable->is_visible() and drawable->has_outline()) return true;
+    }
+    return false;
+}
+
 void Group::set_outline(const Color& color, double thickness, bool shift_depth)
 {
     M_outline_color = color;
@@ -157,6 +274,17 @@ void Group::invalidate_outline()
     }
 }
 
+void Group::set_outline_mode(
+    OutlineMode mode,
+    OutlineJoin join,
+    double miter_limit
+)
+{
+    for (auto drawable : M_subobjects) {
+        drawable->set_outline_mode(mode, join, miter_limit);
+    }
+}
+
 Color Group::get_outline_color() const
 {
     return M_outline_color;
@@ -175,6 +303,14 @@ void Group::set_peeling_depth_buffer(gl::Texture* texture)
     }
 }
 
+void Group::set_weighted_transparency(bool weighted)
+{
+    Object::set_weighted_transparency(weighted);
+    for (auto obj : M_subobjects) {
+        obj->set_weighted_transparency(weighted);
+    }
+}
+
 void Group::set_fps(int fps)
 {
     Animatable::set_fps(fps);
@@ -394,11 +530,11 @@ Box Group::get_logical_bounding_box() const
     return get_original_logical_bounding_box();
 }
 
-Box Group::get_original_true_bounding_box() const
+template <typename F>
+Box Group::merge_subobject_boxes(F get_box) const
 {
     if (size() == 0) return Box();
-    auto boxes = M_subobjects
-        | std::views::transform(&Object::get_true_bounding_box);
+    auto boxes = M_subobjects | std::views::transform(get_box);
     return std::reduce(
         boxes.begin()+1,
         boxes.end(),
@@ -407,17 +543,44 @@ Box Group::get_original_true_bounding_box() const
     );
 }
 
+Box Group::get_original_true_bounding_box() const
+{
+    if (M_boxes_valid) return M_true_box;
+    if (!has_cacheable_bounding_box()) {
+        return merge_subobject_boxes(&Object::get_true_bounding_box);
+    }
+    M_true_box = merge_subobject_boxes(&Object::get_true_bounding_box);
+    M_logical_box = merge_subobject_boxes(&Object::get_logical_bounding_box);
+    M_boxes_valid = true;
+    return M_true_box;
+}
+
 Box Group::get_original_logical_bounding_box() const
 {
-    if (size() == 0) return Box();
-    auto boxes = M_subobjects
-        | std::views::transform(&Object::get_logical_bounding_box);
-    return std::reduce(
-        boxes.begin()+1,
-        boxes.end(),
-        *boxes.begin(),
-        merge_boxes
-    );
+    if (M_boxes_valid) return M_logical_box;
+    if (!has_cacheable_bounding_box()) {
+        return merge_subobject_boxes(&Object::get_logical_bounding_box);
+    }
+    get_original_true_bounding_box();
+    return M_logical_box;
+}
+
+bool Group::has_cacheable_bounding_box() const
+{
+    if (M_boxes_valid) return true;
+    for (auto& obj : M_subobjects) {
+        if (!obj->has_cacheable_bounding_box()) return false;
+    }
+    return true;
+}
+
+void Group::invalidate_bounding_box()
+{
+    // If the boxes are already invalid, then so are the boxes of every group
+    // containing this one, so there's no need to go any further
+    if (!M_boxes_valid) return;
+    M_boxes_valid = false;
+    Object::invalidate_bounding_box();
 }
 
 void Group::set_animating(bool animating)
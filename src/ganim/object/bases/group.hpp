@@ -28,6 +28,29 @@ concept normal_input_range =
         group->range(0, 0);
     };
 
+/** @brief Interface for things that want to know when a @ref Group changes.
+ *
+ * This is mainly used by scenes so that they can find out about new
+ * subobjects without having to look through every group every frame.  An
+ * observer must remove itself from every group it was added to before it is
+ * destroyed.
+ */
+class GroupObserver {
+    public:
+        virtual ~GroupObserver()=default;
+        /** @brief Called after an object is added to a group. */
+        virtual void subobject_added(
+            Group& group,
+            const ObjectPtr<Object>& object
+        )=0;
+        /** @brief Called after an object is removed from a group.
+         *
+         * The group might have held the last reference to the object, so don't
+         * hold onto it.
+         */
+        virtual void subobject_removed(Group& group, Object& object)=0;
+};
+
 struct ArrangeArgs {
     double buff = 0.25;
     std::vector<vga2::Vec> align = {};
@@ -51,9 +74,10 @@ class Group : public Object {
     public:
         Group()=default;
         Group(const Group&);
-        Group(Group&&) noexcept=default;
+        Group(Group&&) noexcept;
         Group& operator=(const Group&);
-        Group& operator=(Group&&) noexcept=default;
+        Group& operator=(Group&&) noexcept;
+        ~Group();
         /*** @brief Add an object to this group */
         void add(ObjectPtr<Object> object);
         /** @brief Adds a range of objects to this group
@@ -121,17 +145,25 @@ class Group : public Object {
         ObjectPtr<Group> copy() const;
 
         virtual void draw(const Camera& camera) override;
+        virtual void draw_batched(ShapeBatch& batch) override;
         virtual bool is_visible() const override;
         virtual void draw_outline(const Camera& camera) override;
+        virtual bool has_outline() const override;
         virtual void set_outline(
             const Color& color,
             double thickness,
             bool shift_depth = false
         ) override;
         virtual void invalidate_outline() override;
+        virtual void set_outline_mode(
+            OutlineMode mode,
+            OutlineJoin join = OutlineJoin::Round,
+            double miter_limit = 4.0
+        ) override;
         virtual Color get_outline_color() const override;
         virtual double get_outline_thickness() const override;
         virtual void set_peeling_depth_buffer(gl::Texture* texture) override;
+        virtual void set_weighted_transparency(bool weighted) override;
 
         // I can't use the macro here because I'm overloading some of the
         // functions
@@ -185,10 +217,20 @@ class Group : public Object {
         virtual void set_noise_creating(double noise_creating) override;
         virtual void set_fixed_in_frame(bool fixed_in_frame) override;
         virtual void set_fixed_orientation(bool fixed_orientation) override;
+        /** @brief Groups that draw their subobjects together change
+         * whenever any of their subobjects do.  Other groups don't draw
+         * anything themselves, so they never change.
+         */
+        virtual bool changed_since(std::uint64_t version) const override;
         virtual Box get_true_bounding_box() const override;
         virtual Box get_logical_bounding_box() const override;
         virtual Box get_original_true_bounding_box() const override;
         virtual Box get_original_logical_bounding_box() const override;
+        /** @brief Groups cache their bounding boxes as long as all of their
+         * subobjects allow it.
+         */
+        virtual bool has_cacheable_bounding_box() const override;
+        virtual void invalidate_bounding_box() override;
         virtual void set_animating(bool animating) override;
         virtual bool is_animating() const override;
         /** @brief Set how far into one subobject to draw before starting to
@@ -246,7 +288,7 @@ class Group : public Object {
         ObjectPtr<const Object> operator[](int index) const
             {return M_subobjects[index];}
         /** @brief Remove all subobjects from this object */
-        void clear() {M_subobjects.clear(); M_new_subobjects.clear();}
+        void clear();
 
         /** @brief Get a range of subobjects
          *
@@ -371,11 +413,13 @@ class Group : public Object {
             ArrangeArgs ver_args = {}
         );
 
-        /** @private */
-        std::vector<ObjectPtr<Object>> take_new_subobjects()
-        {
-            return std::move(M_new_subobjects);
-        }
+        /** @brief Start notifying an observer about changes to this group.
+         *
+         * Observers aren't copied or moved along with the group.
+         */
+        void add_observer(GroupObserver& observer);
+        /** @brief Stop notifying an observer about changes to this group. */
+        void remove_observer(GroupObserver& observer);
 
     protected:
         bool propagate() const {return M_propogate;}
@@ -384,14 +428,24 @@ class Group : public Object {
 
     private:
         virtual Group* copy_impl() const override;
+        void detach_subobjects();
+        void notify_added(const ObjectPtr<Object>& object);
+        void notify_removed(Object& object);
+        template <typename F>
+        Box merge_subobject_boxes(F get_box) const;
 
         std::vector<ObjectPtr<Object>> M_subobjects;
-        std::vector<ObjectPtr<Object>> M_new_subobjects;
+        std::vector<GroupObserver*> M_observers;
         double M_ratio = 1;
         double M_outline_thickness = 0;
         Color M_outline_color = Color("#000000");
         bool M_propogate = true;
         bool M_draw_together = false;
+        // Both bounding boxes are valid at the same time, and only when every
+        // subobject has a cacheable bounding box
+        mutable Box M_true_box;
+        mutable Box M_logical_box;
+        mutable bool M_boxes_valid = false;
 };
 
 /** @brief Make a group in an ObjectPtr.
@@ -6,6 +6,8 @@
 #include "ganim/rate_functions.hpp"
 
 #include "ganim/object/shape.hpp"
+#include "ganim/object/shape_batch.hpp"
+#include "ganim/object/bases/group.hpp"
 
 using namespace ganim;
 using namespace pga3;
@@ -13,12 +15,14 @@ using namespace pga3;
 Object& Object::set_visible(bool visible)
 {
     M_visible = visible;
+    mark_changed();
     return *this;
 }
 
 Object& Object::set_color(Color color)
 {
     M_color.back() = color;
+    mark_changed();
     return *this;
 }
 
@@ -31,18 +35,21 @@ Object& Object::push_color()
 Object& Object::push_color(Color color)
 {
     M_color.push_back(color);
+    mark_changed();
     return *this;
 }
 
 Object& Object::pop_color()
 {
     if (M_color.size() > 1) M_color.pop_back();
+    mark_changed();
     return *this;
 }
 
 Object& Object::set_opacity(double opacity)
 {
     M_opacity = opacity;
+    mark_changed();
     return *this;
 }
 
@@ -64,6 +71,7 @@ Object& Object::scale(double amount, const pga3::Trivec& about_point)
     new_center += e123;
     shift(new_center - center + e123);
     M_scale *= amount;
+    transform_changed();
     return *this;
 }
 
@@ -90,6 +98,43 @@ void Object::set_squish(
 {
     M_squish_amount = amount;
     M_squish_axis = axis.normalized();
+    mark_changed();
+}
+
+void Object::invalidate_bounding_box()
+{
+    // The box only changes when the object does
+    mark_changed();
+    for (auto group : M_parent_groups.groups) {
+        group->invalidate_bounding_box();
+    }
+}
+
+void Object::transform_changed()
+{
+    // This doesn't change the original bounding box, so only the groups need
+    // to know about it
+    Object::invalidate_bounding_box();
+}
+
+Object::ParentGroups& Object::ParentGroups::operator=(
+    const ParentGroups&
+) noexcept
+{
+    for (auto group : groups) group->invalidate_bounding_box();
+    ++S_draw_order_version;
+    return *this;
+}
+
+void Object::set_outline_mode(OutlineMode, OutlineJoin, double)
+{
+    // Objects without their own outline have nothing to change
+}
+
+void Object::draw_batched(ShapeBatch& batch)
+{
+    batch.flush();
+    draw(batch.get_camera());
 }
 
 ObjectPtr<Object> Object::copy() const
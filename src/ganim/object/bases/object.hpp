@@ -5,6 +5,9 @@
  * @brief Contains the @ref ganim::Object "Object" class
  */
 
+#include <cstdint>
+
+#include "outline_geometry.hpp"
 #include "transformable.hpp"
 
 #include "ganim/color.hpp"
@@ -14,6 +17,8 @@
 #include "ganim/gl/texture.hpp"
 
 namespace ganim {
+    class Group;
+    class ShapeBatch;
     /** @brief The base class for objects that can be drawn and have some kind
      * of extent
      *
@@ -41,6 +46,17 @@ namespace ganim {
              * position/orientation.
              */
             virtual void draw_outline(const Camera& camera)=0;
+            /** @brief Draw this object as part of a @ref ShapeBatch
+             *
+             * Objects that can be batched add themselves (or their parts) to
+             * the batch.  By default, the batch is flushed and the object is
+             * drawn with @ref draw.
+             */
+            virtual void draw_batched(ShapeBatch& batch);
+            /** @brief Determine whether @ref draw_outline will draw anything.
+             */
+            virtual bool has_outline() const
+                {return get_outline_thickness() != 0.0;}
             /** @brief Set the outline color and thickness to use when drawing
              * the outline of this object
              *
@@ -68,6 +84,21 @@ namespace ganim {
              * the object has changed.
              */
             virtual void invalidate_outline()=0;
+            /** @brief Set how the outline of this object is made.
+             *
+             * See @ref OutlineMode for the differences between the modes.
+             * Objects that can't be outlined analytically ignore this.
+             *
+             * @param mode How the outline is made.
+             * @param join What the corners of analytic outlines look like.
+             * @param miter_limit For miter joins, how long a corner can be,
+             * as a multiple of the outline's thickness, before it is cut off.
+             */
+            virtual void set_outline_mode(
+                OutlineMode mode,
+                OutlineJoin join = OutlineJoin::Round,
+                double miter_limit = 4.0
+            );
             /** @brief Get the outline color. */
             virtual Color get_outline_color() const=0;
             /** @brief Get the outline thickness. */
@@ -79,6 +110,12 @@ namespace ganim {
             /** @brief Used internally for order-independent transparency. */
             gl::Texture* peeling_depth_buffer() const
                 {return M_peeling_depth_buffer;}
+            /** @brief Used internally for order-independent transparency. */
+            virtual void set_weighted_transparency(bool weighted)
+                {M_weighted_transparency = weighted;}
+            /** @brief Used internally for order-independent transparency. */
+            bool weighted_transparency() const
+                {return M_weighted_transparency;}
 
             /** @brief Set the color of this object. */
             virtual Object& set_color(Color color);
@@ -136,7 +173,7 @@ namespace ganim {
              * to zero.  Note that any shifting caused by previous scaling
              * around non-origin points is *not* reset.
              */
-            void reset_scale() {M_scale = 1.0;}
+            void reset_scale() {M_scale = 1.0; transform_changed();}
 
             /** @brief Set how this object should be "squished/stretched"
              *
@@ -191,7 +228,7 @@ namespace ganim {
              * subclasses to use this value to do something interesting.
              */
             virtual void set_draw_fraction(double value)
-                {M_draw_fraction = value;}
+                {M_draw_fraction = value; mark_changed();}
             /** @brief Get how much of the object to draw.
              *
              * This is used for things like the @ref ganim::create "create"
@@ -211,7 +248,14 @@ namespace ganim {
              * in 3D space.
              */
             virtual Object& set_depth_z(double depth_z)
-                {M_depth_z = depth_z; return *this;}
+            {
+                if (M_depth_z != depth_z) {
+                    M_depth_z = depth_z;
+                    ++S_draw_order_version;
+                    mark_changed();
+                }
+                return *this;
+            }
             /** @brief Get what value to add to the z value when writing to the
              * depth buffer
              *
@@ -234,29 +278,44 @@ namespace ganim {
              *
              * Used internally by things like the create animation.
              */
-            virtual void set_creating(bool creating) {M_creating = creating;}
+            virtual void set_creating(bool creating)
+                {M_creating = creating; mark_changed();}
             /** @brief Set whether or not this object is being noise created,
              * and the amount that the noise should affect the creation.
              *
              * Used internally by things like the noise create animation.
              */
             virtual void set_noise_creating(double noise_creating)
-                {M_noise_creating = noise_creating;}
+                {M_noise_creating = noise_creating; mark_changed();}
             /** @brief Set whether or not this object is fixed in frame, i.e. is
              * not affected by the motion of the camera.
              */
             virtual void set_fixed_in_frame(bool fixed_in_frame)
-                {M_fixed_in_frame = fixed_in_frame;}
+            {
+                if (M_fixed_in_frame != fixed_in_frame) {
+                    M_fixed_in_frame = fixed_in_frame;
+                    ++S_draw_order_version;
+                    mark_changed();
+                }
+            }
             /** @brief See whether or not this object is fixed in frame, i.e. is
              * not affected by the motion of the camera.
              */
             bool is_fixed_in_frame() const {return M_fixed_in_frame;}
+            /** @brief Get a number that changes whenever the depth z or the
+             * fixed in frame status of any object changes.
+             *
+             * Scenes use this to know when they need to sort their objects
+             * again.
+             */
+            static std::uint64_t get_draw_order_version()
+                {return S_draw_order_version;}
             /** @brief Set whether or not this object has a fixed orientation,
              * i.e. is always facing the camera no matter what position it's at
              * in 3D space.
              */
             virtual void set_fixed_orientation(bool fixed_orientation)
-                {M_fixed_orientation = fixed_orientation;}
+                {M_fixed_orientation = fixed_orientation; mark_changed();}
             /** @brief See whether or not this object has a fixed orientation,
              * i.e. is always facing the camera no matter what position it's at
              * in 3D space.
@@ -274,6 +333,12 @@ namespace ganim {
              * Used internally by things like the noise create animation.
              */
             double noise_creating() const {return M_noise_creating;}
+            /** @brief See whether anything that this object draws has changed
+             * since @ref Transformable::get_change_version returned a certain
+             * value.
+             */
+            virtual bool changed_since(std::uint64_t version) const
+                {return get_last_change() > version;}
             /** @brief Get the true bounding box of this object
              *
              * This bounding box must be big enough that the entirety of the
@@ -310,6 +375,22 @@ namespace ganim {
              */
             virtual Box get_original_logical_bounding_box() const
                 {return get_original_true_bounding_box();}
+            /** @brief Determine whether groups containing this object can
+             * cache its bounding boxes.
+             *
+             * This should only be true if the object calls @ref
+             * invalidate_bounding_box every time its original bounding boxes
+             * change.  Changes to the transformation of the object are
+             * already handled automatically.
+             */
+            virtual bool has_cacheable_bounding_box() const {return false;}
+            /** @brief Tell any groups containing this object that its bounding
+             * box has changed.
+             *
+             * Subclasses that cache their bounding boxes should override this
+             * to throw away their caches, and then call this version.
+             */
+            virtual void invalidate_bounding_box();
 
             /** @brief Set the x coordinate of the center of this object. */
             void set_x(double x);
@@ -532,10 +613,29 @@ namespace ganim {
             GANIM_TRANSFORMABLE_CHAIN_DECLS(Object);
 
         private:
+            friend class Group;
+            /** @brief The groups that this object is in.
+             *
+             * Copying an object doesn't put the copy in any groups, so this
+             * isn't copied along with everything else.  Assigning to an object
+             * changes its bounding box, so the groups are told about it, and
+             * it can change how the object is sorted when drawing.
+             */
+            class ParentGroups {
+                public:
+                    ParentGroups()=default;
+                    ParentGroups(const ParentGroups&) noexcept {}
+                    ParentGroups& operator=(const ParentGroups&) noexcept;
+                    ~ParentGroups()=default;
+                    std::vector<Group*> groups;
+            };
+
             virtual Object* copy_impl() const override;
             virtual std::pair<pga3::Trivec, pga3::Trivec> get_box()
                 const override final;
+            virtual void transform_changed() override;
 
+            ParentGroups M_parent_groups;
             double M_scale = 1;
             double M_draw_fraction = 1;
             double M_noise_creating = 0.0;
@@ -549,6 +649,9 @@ namespace ganim {
             bool M_fixed_in_frame = false;
             bool M_fixed_orientation = false;
             gl::Texture* M_peeling_depth_buffer = nullptr;
+            bool M_weighted_transparency = false;
+
+            inline static std::uint64_t S_draw_order_version = 0;
     };
 }
 
@@ -0,0 +1,80 @@
+#include "outline_cache.hpp"
+
+using namespace ganim;
+
+std::uint64_t ganim::hash_bytes(
+    std::uint64_t hash,
+    const void* data,
+    std::size_t size
+)
+{
+    auto bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::size_t OutlineCache::KeyHash::operator()(const Key& key) const
+{
+    auto result = hash_value(key.hash, key.pixels_per_unit);
+    return hash_value(result, key.margin_pixels);
+}
+
+OutlineCache& OutlineCache::get()
+{
+    static auto result = OutlineCache();
+    return result;
+}
+
+std::shared_ptr<const OutlineTexture> OutlineCache::find(const Key& key)
+{
+    auto it = M_index.find(key);
+    if (it == M_index.end()) {
+        ++M_misses;
+        return nullptr;
+    }
+    ++M_hits;
+    M_entries.splice(M_entries.begin(), M_entries, it->second);
+    return it->second->second;
+}
+
+void OutlineCache::insert(
+    const Key& key,
+    std::shared_ptr<const OutlineTexture> outline
+)
+{
+    if (auto it = M_index.find(key); it != M_index.end()) {
+        M_memory_usage -= it->second->second->bytes();
+        M_entries.erase(it->second);
+        M_index.erase(it);
+    }
+    M_memory_usage += outline->bytes();
+    M_entries.emplace_front(key, std::move(outline));
+    M_index.emplace(key, M_entries.begin());
+    evict();
+}
+
+void OutlineCache::clear()
+{
+    M_entries.clear();
+    M_index.clear();
+    M_memory_usage = 0;
+}
+
+void OutlineCache::set_memory_budget(std::size_t bytes)
+{
+    M_memory_budget = bytes;
+    evict();
+}
+
+void OutlineCache::evict()
+{
+    while (M_memory_usage > M_memory_budget and M_entries.size() > 1) {
+        auto& [key, outline] = M_entries.back();
+        M_memory_usage -= outline->bytes();
+        M_index.erase(key);
+        M_entries.pop_back();
+    }
+}
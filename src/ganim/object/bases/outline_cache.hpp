@@ -0,0 +1,151 @@
+#ifndef GANIM_OBJECT_OUTLINE_CACHE_HPP
+#define GANIM_OBJECT_OUTLINE_CACHE_HPP
+
+/** @file
+ * @brief The @ref ganim::OutlineCache "OutlineCache" class
+ */
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <unordered_map>
+
+#include "ganim/gl/texture.hpp"
+
+namespace ganim {
+    /** @brief Mix some bytes into a 64-bit FNV-1a hash. */
+    std::uint64_t hash_bytes(
+        std::uint64_t hash,
+        const void* data,
+        std::size_t size
+    );
+    /** @brief Mix a value into a 64-bit FNV-1a hash. */
+    template <typename T> requires(std::is_trivially_copyable_v<T>)
+    std::uint64_t hash_value(std::uint64_t hash, const T& value)
+    {
+        return hash_bytes(hash, &value, sizeof(T));
+    }
+    /** @brief Mix every value in a range into a 64-bit FNV-1a hash. */
+    template <typename T> requires(std::is_trivially_copyable_v<T>)
+    std::uint64_t hash_values(std::uint64_t hash, std::span<const T> values)
+    {
+        return hash_bytes(hash, values.data(), values.size_bytes());
+    }
+    /** @brief The starting value of a 64-bit FNV-1a hash. */
+    constexpr auto hash_start = std::uint64_t(14695981039346656037ULL);
+
+    /** @brief The distance field used to draw an object's outline. */
+    struct OutlineTexture {
+        /** @brief The distance field, in a square `GL_R32F` texture. */
+        gl::Texture texture = 0;
+        /** @brief The side length of the texture, in pixels. */
+        int texture_size = 0;
+        /** @brief The side length of the texture, in the object's own
+         * coordinates.  The texture is centered on the center of the object's
+         * bounding box.
+         */
+        double size = 0;
+        /** @brief How many pixels one unit of the object's coordinates was
+         * when this was made.
+         */
+        double pixels_per_unit = 0;
+        /** @brief How much room there is around the object, in the object's
+         * own coordinates.  Outlines up to a third of this thick fit.
+         */
+        double margin = 0;
+
+        /** @brief The amount of GPU memory that this uses. */
+        std::size_t bytes() const
+            {return std::size_t(texture_size) * texture_size * 4;}
+    };
+
+    /** @brief Shares outline distance fields between objects that look the
+     * same.
+     *
+     * Making an outline means drawing the object to a texture and computing
+     * its distance transform, which is expensive.  Text often has many
+     * copies of the same glyph, so instead of doing this for every copy,
+     * @ref SingleObject looks up its outline here first, using a hash of
+     * everything that affects what the object looks like in its own
+     * coordinates (see @ref SingleObject::get_outline_hash), the size of a
+     * pixel, and the size of the margin rounded up to a power of two pixels.
+     *
+     * The cache only holds on to a limited amount of GPU memory.  When it has
+     * more than that, the outlines that were used the longest time ago are
+     * dropped.  Objects still using a dropped outline keep it until they're
+     * done with it.
+     */
+    class OutlineCache {
+        public:
+            /** @brief What an outline is looked up by. */
+            struct Key {
+                /** @brief The hash of the object's appearance. */
+                std::uint64_t hash = 0;
+                /** @brief How many pixels one unit is. */
+                double pixels_per_unit = 0;
+                /** @brief The margin around the object, in pixels. */
+                int margin_pixels = 0;
+
+                bool operator==(const Key&) const=default;
+            };
+
+            /** @brief Get the cache shared by every object. */
+            static OutlineCache& get();
+
+            /** @brief Find an outline, or return null if there isn't one.
+             *
+             * Finding an outline makes it the most recently used one.
+             */
+            std::shared_ptr<const OutlineTexture> find(const Key& key);
+            /** @brief Add an outline to the cache.
+             *
+             * This drops the least recently used outlines until the cache is
+             * within its memory budget again, although the outline that was
+             * just added is always kept.
+             */
+            void insert(
+                const Key& key,
+                std::shared_ptr<const OutlineTexture> outline
+            );
+            /** @brief Drop every outline. */
+            void clear();
+            /** @brief Set how much GPU memory the cache can use, in bytes.
+             *
+             * The default is 256 MiB.
+             */
+            void set_memory_budget(std::size_t bytes);
+            /** @brief Get how much GPU memory the cache can use, in bytes. */
+            std::size_t get_memory_budget() const {return M_memory_budget;}
+            /** @brief Get how much GPU memory the cache is using, in bytes. */
+            std::size_t get_memory_usage() const {return M_memory_usage;}
+            /** @brief Get the number of outlines in the cache. */
+            std::size_t size() const {return M_entries.size();}
+            /** @brief Get the number of times @ref find found an outline. */
+            std::uint64_t get_hit_count() const {return M_hits;}
+            /** @brief Get the number of times @ref find didn't find an
+             * outline.
+             */
+            std::uint64_t get_miss_count() const {return M_misses;}
+
+        private:
+            struct KeyHash {
+                std::size_t operator()(const Key& key) const;
+            };
+            using Entry = std::pair<Key, std::shared_ptr<const OutlineTexture>>;
+
+            void evict();
+
+            // The most recently used outline is at the front
+            std::list<Entry> M_entries;
+            std::unordered_map<Key, std::list<Entry>::iterator, KeyHash>
+                M_index;
+            std::size_t M_memory_budget = 256 << 20;
+            std::size_t M_memory_usage = 0;
+            std::uint64_t M_hits = 0;
+            std::uint64_t M_misses = 0;
+    };
+}
+
+#endif
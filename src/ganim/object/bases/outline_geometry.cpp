@@ -0,0 +1,193 @@
+#include "outline_geometry.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <map>
+#include <numbers>
+#include <stdexcept>
+#include <utility>
+
+using namespace ganim;
+
+namespace {
+    struct Vec {
+        double x = 0;
+        double y = 0;
+        Vec operator+(Vec other) const {return {x + other.x, y + other.y};}
+        Vec operator-(Vec other) const {return {x - other.x, y - other.y};}
+        Vec operator*(double s) const {return {x * s, y * s};}
+        double dot(Vec other) const {return x * other.x + y * other.y;}
+        double cross(Vec other) const {return x * other.y - y * other.x;}
+        double length() const {return std::hypot(x, y);}
+    };
+    // Round joins use a segment for every this many radians
+    constexpr double round_step = std::numbers::pi / 16;
+
+    class Builder {
+        public:
+            Builder(OutlineGeometry& geometry) : M_geometry(geometry) {}
+
+            unsigned add(Vec point, float z, Vec offset, float distance)
+            {
+                M_geometry.vertices.push_back({
+                    float(point.x), float(point.y), z,
+                    float(offset.x), float(offset.y), distance
+                });
+                return M_geometry.vertices.size() - 1;
+            }
+            void triangle(unsigned a, unsigned b, unsigned c)
+            {
+                M_geometry.indices.insert(M_geometry.indices.end(), {a, b, c});
+            }
+            // A fan of triangles around `center` going from the direction n1
+            // to the direction n2 through `angle` radians
+            void fan(unsigned center, Vec n1, double angle)
+            {
+                const auto& v = M_geometry.vertices[center];
+                const auto point = Vec(v.x, v.y);
+                const auto z = v.z;
+                const auto segments
+                    = std::max(1, int(std::ceil(std::abs(angle) / round_step)));
+                auto previous = add(point, z, n1, 1);
+                for (int i = 1; i <= segments; ++i) {
+                    const auto t = angle * i / segments;
+                    const auto direction = Vec(
+                        n1.x * std::cos(t) - n1.y * std::sin(t),
+                        n1.x * std::sin(t) + n1.y * std::cos(t)
+                    );
+                    auto next = add(point, z, direction, 1);
+                    triangle(center, previous, next);
+                    previous = next;
+                }
+            }
+
+        private:
+            OutlineGeometry& M_geometry;
+    };
+
+    struct BoundaryEdge {
+        Vec normal;
+        unsigned other = 0;
+    };
+}
+
+OutlineGeometry ganim::make_outline_geometry(
+    std::span<const std::array<float, 3>> positions,
+    std::span<const unsigned> indices,
+    OutlineJoin join,
+    double miter_limit
+)
+{
+    auto result = OutlineGeometry();
+    auto builder = Builder(result);
+
+    // Vertices at the same position are welded together so that triangles
+    // that don't share indices are still connected
+    auto welded_ids = std::map<std::pair<float, float>, unsigned>();
+    auto points = std::vector<Vec>();
+    auto weld = std::vector<unsigned>(positions.size());
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        const auto& p = positions[i];
+        auto [it, added] = welded_ids.try_emplace(
+            std::pair(p[0], p[1]), points.size());
+        if (added) {
+            points.emplace_back(p[0], p[1]);
+            builder.add(points.back(), p[2], {}, 0);
+        }
+        weld[i] = it->second;
+    }
+
+    // Each edge is stored with the triangle vertex opposite it, which says
+    // which side of the edge is inside
+    struct EdgeInfo {
+        int count = 0;
+        unsigned opposite = 0;
+    };
+    auto edges = std::map<std::pair<unsigned, unsigned>, EdgeInfo>();
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        auto corners = std::array<unsigned, 3>();
+        for (int j = 0; j < 3; ++j) {
+            const auto index = indices[i + j];
+            if (index >= positions.size()) {
+                throw std::out_of_range(std::format(
+                    "Index {} passed to make_outline_geometry is out of range "
+                    "for {} vertices", index, positions.size()));
+            }
+            corners[j] = weld[index];
+        }
+        const auto [a, b, c] = corners;
+        if ((points[b] - points[a]).cross(points[c] - points[a]) == 0) {
+            continue;
+        }
+        builder.triangle(a, b, c);
+        for (int j = 0; j < 3; ++j) {
+            auto p = corners[j];
+            auto q = corners[(j + 1) % 3];
+            auto& info = edges[std::minmax(p, q)];
+            ++info.count;
+            info.opposite = corners[(j + 2) % 3];
+        }
+    }
+
+    // A band along each edge that is only part of one triangle
+    auto boundary = std::vector<std::vector<BoundaryEdge>>(points.size());
+    for (const auto& [edge, info] : edges) {
+        if (info.count != 1) continue;
+        const auto [a, b] = edge;
+        const auto direction = points[b] - points[a];
+        auto normal = Vec(-direction.y, direction.x)
+            * (1 / direction.length());
+        if (normal.dot(points[info.opposite] - points[a]) > 0) {
+            normal = normal * -1;
+        }
+        const auto za = result.vertices[a].z;
+        const auto zb = result.vertices[b].z;
+        auto outer_a = builder.add(points[a], za, normal, 1);
+        auto outer_b = builder.add(points[b], zb, normal, 1);
+        builder.triangle(a, b, outer_b);
+        builder.triangle(a, outer_b, outer_a);
+        boundary[a].push_back({normal, b});
+        boundary[b].push_back({normal, a});
+    }
+
+    // Joins fill in the gaps between the bands at outside corners
+    for (unsigned v = 0; v < points.size(); ++v) {
+        const auto& edges_here = boundary[v];
+        if (edges_here.empty()) continue;
+        if (edges_here.size() != 2) {
+            // Something unusual like two shapes touching at a corner, so the
+            // corner is just surrounded completely
+            builder.fan(v, edges_here[0].normal, 2 * std::numbers::pi);
+            continue;
+        }
+        const auto n1 = edges_here[0].normal;
+        const auto n2 = edges_here[1].normal;
+        const auto e2 = points[edges_here[1].other] - points[v];
+        // At inside corners and straight lines the bands already overlap
+        if (n1.dot(e2) >= -1e-9 * e2.length()) continue;
+        const auto angle = std::atan2(n1.cross(n2), n1.dot(n2));
+        if (join == OutlineJoin::Round) {
+            builder.fan(v, n1, angle);
+            continue;
+        }
+        const auto& vertex = result.vertices[v];
+        const auto point = Vec(vertex.x, vertex.y);
+        const auto z = vertex.z;
+        const auto cosine = n1.dot(n2);
+        const auto miter = (n1 + n2) * (1 / std::max(1 + cosine, 1e-12));
+        auto outer1 = builder.add(point, z, n1, 1);
+        auto outer2 = builder.add(point, z, n2, 1);
+        if (1 + cosine < 1e-9 or miter.length() > miter_limit) {
+            builder.triangle(v, outer1, outer2);
+        }
+        else {
+            // The distance to the edges is linear, so it is still exact
+            // when interpolated over these triangles
+            auto tip = builder.add(point, z, miter, 1);
+            builder.triangle(v, outer1, tip);
+            builder.triangle(v, tip, outer2);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,92 @@
+#ifndef GANIM_OBJECT_OUTLINE_GEOMETRY_HPP
+#define GANIM_OBJECT_OUTLINE_GEOMETRY_HPP
+
+/** @file
+ * @brief Building analytic outlines from the triangles of a flat shape.
+ */
+
+#include <array>
+#include <span>
+#include <vector>
+
+namespace ganim {
+    /** @brief How an object's outline is made. */
+    enum class OutlineMode {
+        /** @brief Draw the object to a texture and compute its distance
+         * transform.  This works for any object, including ones with
+         * textures, but it is limited by the resolution of the texture.
+         */
+        DistanceField,
+        /** @brief Build the outline directly from the edges of the object's
+         * triangles.  This is always sharp and doesn't use any textures, but
+         * it only works for objects that know their own shape (see @ref
+         * SingleObject::get_outline_geometry).  Other objects use @ref
+         * DistanceField instead.
+         *
+         * Where the outline overlaps itself at inside corners, it is drawn
+         * twice, which shows up when the outline is partially transparent.
+         */
+        Analytic
+    };
+
+    /** @brief What the corners of an analytic outline look like. */
+    enum class OutlineJoin {
+        /** @brief Corners are rounded, which looks the same as @ref
+         * OutlineMode::DistanceField.
+         */
+        Round,
+        /** @brief Corners are sharp, unless they're so sharp that the
+         * point would be longer than the miter limit, in which case they're
+         * cut off.
+         */
+        Miter
+    };
+
+    /** @brief The triangles of an analytic outline.
+     *
+     * The outline doesn't depend on its thickness.  Instead, each vertex has
+     * a direction that it is moved in, which is multiplied by the distance
+     * from the shape to the outside of the outline when it's drawn.
+     */
+    struct OutlineGeometry {
+        struct Vertex {
+            float x = 0; ///< The x coordinate of the point on the shape
+            float y = 0; ///< The y coordinate of the point on the shape
+            float z = 0; ///< The z coordinate of the point on the shape
+            float dx = 0; ///< The x coordinate of the direction to move in
+            float dy = 0; ///< The y coordinate of the direction to move in
+            /** @brief The distance from the moved vertex to the shape, as a
+             * multiple of the outline's distance.  This is zero for vertices
+             * on the shape and one for vertices on the outside.
+             */
+            float distance = 0;
+        };
+        std::vector<Vertex> vertices;
+        std::vector<unsigned> indices;
+    };
+
+    /** @brief Build an analytic outline from a mesh of triangles.
+     *
+     * The outline covers the triangles themselves, a band along every edge
+     * that is only part of one triangle, and a join at every corner of those
+     * edges.  Vertices at the same position are treated as the same vertex,
+     * so the triangles don't need to share indices to be connected.
+     *
+     * @param positions The positions of the vertices.  Only x and y are used
+     * to find the outline.
+     * @param indices Indices into `positions`, three for each triangle.
+     * @param join What the corners look like.
+     * @param miter_limit For miter joins, how long a corner can be, as a
+     * multiple of the outline's distance, before it is cut off.
+     *
+     * @throw std::out_of_range If an index is out of range.
+     */
+    OutlineGeometry make_outline_geometry(
+        std::span<const std::array<float, 3>> positions,
+        std::span<const unsigned> indices,
+        OutlineJoin join = OutlineJoin::Round,
+        double miter_limit = 4.0
+    );
+}
+
+#endif
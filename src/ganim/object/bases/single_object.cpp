@@ -1,7 +1,11 @@
 #include "single_object.hpp"
 
+#include <format>
+#include <stdexcept>
+
 #include "ganim/gl/gl.hpp"
-#include "ganim/gl/framebuffer.hpp"
+#include "ganim/gl/stats.hpp"
+#include "ganim/gl/scratch_pool.hpp"
 #include "ganim/gl/shader.hpp"
 
 #include "ganim/object/shaders.hpp"
@@ -15,7 +19,10 @@ SingleObject::SingleObject(const SingleObject& other)
     : Object(other),
     M_outline_color(other.M_outline_color),
     M_outline_thickness(other.M_outline_thickness),
-    M_always_invalidate_outline(other.M_always_invalidate_outline)
+    M_always_invalidate_outline(other.M_always_invalidate_outline),
+    M_outline_mode(other.M_outline_mode),
+    M_outline_join(other.M_outline_join),
+    M_outline_miter_limit(other.M_outline_miter_limit)
     // The OpenGL stuff gets made whenever it's not there and is needed so we
     // don't have to copy it here
 {}
@@ -24,25 +31,32 @@ void SingleObject::draw_outline(const Camera& camera)
 {
     if (get_scale() == 0) return;
     if (M_outline_thickness == 0.0) return;
-    if (!M_outline_texture or M_always_invalidate_outline) {
-        create_outline(camera);
-    }
 
     auto current_viewport = std::array<int, 4>{0};
     glGetIntegerv(GL_VIEWPORT, current_viewport.data());
     const auto camera_width = camera.get_starting_width();
     const auto gtp = current_viewport[2] / camera_width;
-    const auto thickness = gtp * M_outline_thickness / get_scale();
+    const auto analytic = update_analytic_outline();
+    // The outline only needs to be made again if it doesn't have room for
+    // the current thickness or the pixels changed size
+    if (!analytic and (!M_outline or M_always_invalidate_outline
+            or M_outline->pixels_per_unit != gtp
+            or M_outline->margin < get_outline_margin())) {
+        create_outline(gtp);
+    }
 
     auto features = ShaderFeature::Outline;
+    if (analytic) features |= ShaderFeature::AnalyticOutline;
     if (peeling_depth_buffer()) features |= ShaderFeature::DepthPeeling;
+    if (weighted_transparency()) {
+        features |= ShaderFeature::WeightedTransparency;
+    }
     if (get_squish_amount() != 1.0) features |= ShaderFeature::Squish;
     auto& shader = get_shader(features);
+    ++gl::stats.program_changes;
     glUseProgram(shader);
     if (auto buffer = peeling_depth_buffer()) {
-        glUniform1i(shader.get_uniform("layer_depth_buffer"), 15);
-        glActiveTexture(GL_TEXTURE15);
-        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, *buffer);
+        bind_peeling_depth_buffer(shader, *buffer);
     }
     glUniform2f(shader.get_uniform("camera_scale"),
                 camera.get_x_scale(), camera.get_y_scale());
@@ -69,11 +83,31 @@ void SingleObject::draw_outline(const Camera& camera)
         glUniform1f(shader.get_uniform("squish_amount"), get_squish_amount());
         shader.set_plane_uniform("squish_axis", get_squish_axis());
     }
+    if (analytic) {
+        // The analytic outline is already at the object's scale, so its
+        // thickness is in screen pixels.  It goes half a pixel further than
+        // the thickness to leave room for antialiasing.
+        const auto thickness = gtp * M_outline_thickness;
+        const auto extent_pixels = thickness + 1;
+        glUniform1f(shader.get_uniform("thickness"), thickness);
+        glUniform1f(shader.get_uniform("outline_extent"),
+                    extent_pixels / (gtp * get_scale()));
+        glUniform1f(shader.get_uniform("outline_extent_pixels"),
+                    extent_pixels);
+        glBindVertexArray(M_analytic_vertex_array);
+        ++gl::stats.draw_calls;
+        glDrawElements(GL_TRIANGLES, M_analytic_index_count, GL_UNSIGNED_INT,
+                       nullptr);
+        glBindVertexArray(0);
+        return;
+    }
+    const auto thickness = gtp * M_outline_thickness / get_scale();
     glUniform1f(shader.get_uniform("thickness"), thickness);
     glBindVertexArray(M_outline_vertex_array);
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, M_outline_texture);
+    glBindTexture(GL_TEXTURE_2D, M_outline->texture);
     glUniform1i(shader.get_uniform("distance_transform"), 0);
+    ++gl::stats.draw_calls;
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
     glBindVertexArray(0);
 }
@@ -86,15 +120,34 @@ void SingleObject::set_outline(
 {
     M_outline_color = color;
     M_outline_depth = shift_depth ? -0.001 : 0;
-    if (thickness != M_outline_thickness) {
-        M_outline_thickness = thickness;
-        M_outline_texture = 0;
-    }
+    // If the outline got thicker, draw_outline will notice that there isn't
+    // enough room for it anymore
+    M_outline_thickness = thickness;
+    mark_changed();
 }
 
 void SingleObject::invalidate_outline()
 {
-    M_outline_texture = 0;
+    M_outline.reset();
+    M_analytic_valid = false;
+    mark_changed();
+}
+
+void SingleObject::set_outline_mode(
+    OutlineMode mode,
+    OutlineJoin join,
+    double miter_limit
+)
+{
+    if (miter_limit < 1) {
+        throw std::invalid_argument(std::format(
+            "The miter limit of an outline must be at least 1, not {}.",
+            miter_limit));
+    }
+    M_outline_mode = mode;
+    M_outline_join = join;
+    M_outline_miter_limit = miter_limit;
+    invalidate_outline();
 }
 
 Color SingleObject::get_outline_color() const
@@ -114,8 +167,44 @@ void SingleObject::set_draw_fraction(double value)
     if (different) invalidate_outline();
 }
 
-void SingleObject::create_outline(const Camera& camera)
+std::optional<std::uint64_t> SingleObject::get_outline_hash(double) const
 {
+    return std::nullopt;
+}
+
+std::optional<OutlineGeometry> SingleObject::get_outline_geometry(
+    OutlineJoin,
+    double
+) const
+{
+    return std::nullopt;
+}
+
+double SingleObject::get_outline_margin() const
+{
+    return M_outline_thickness * 3 / std::max(get_scale(), 0.1);
+}
+
+void SingleObject::create_outline(double gtp)
+{
+    // Rounding the margin up to a power of two pixels lets the outline be
+    // shared and reused when the thickness changes a little
+    const auto margin_pixels = std::bit_ceil(static_cast<unsigned>(
+        std::max(std::ceil(get_outline_margin() * gtp), 1.0)));
+    const auto margin = margin_pixels / gtp;
+    auto key = std::optional<OutlineCache::Key>();
+    // Objects that are in the middle of being created look different every
+    // frame, so they aren't worth sharing
+    if (!M_always_invalidate_outline and get_squish_amount() == 1.0
+            and get_draw_fraction() == 1.0 and !is_creating()
+            and noise_creating() == 0.0) {
+        if (auto hash = get_outline_hash(gtp)) {
+            key = OutlineCache::Key{*hash, gtp, int(margin_pixels)};
+        }
+    }
+    auto& cache = OutlineCache::get();
+    auto outline = key ? cache.find(*key) : nullptr;
+
     auto rotor = get_rotor();
     auto scale = get_scale();
     auto opacity = get_opacity();
@@ -141,66 +230,81 @@ void SingleObject::create_outline(const Camera& camera)
                     "an object that seems to have 3D extent.");
         }
     }
-    const auto bigger_width = x2 - x1
-        + M_outline_thickness * 3 / std::max(scale, 0.1);
-    const auto bigger_height = y2 - y1
-        + M_outline_thickness * 3 / std::max(scale, 0.1);
-    const auto size_base = std::max(bigger_width, bigger_height);
-
-    auto current_draw_framebuffer = 0;
-    auto current_read_framebuffer = 0;
-    auto current_viewport = std::array<int, 4>{0};
-    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &current_draw_framebuffer);
-    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &current_read_framebuffer);
-    glGetIntegerv(GL_VIEWPORT, current_viewport.data());
-    const auto camera_width = camera.get_starting_width();
-    const auto gtp = current_viewport[2] / camera_width;
-    const auto texture_size
-        = std::max(std::bit_ceil(static_cast<unsigned>(size_base * gtp)), 8U);
-    const auto size = texture_size / gtp;
-
-    auto framebuffer = gl::Framebuffer();
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-    auto framebuffer_texture = gl::Texture();
-    glBindTexture(GL_TEXTURE_2D, framebuffer_texture);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, texture_size, texture_size, 0,
-                 GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                           framebuffer_texture, 0);
-    auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-    if (status != GL_FRAMEBUFFER_COMPLETE) {
-        throw std::runtime_error("Error: Framebuffer is not complete when "
-                "drawing an outline.");
-    }
-    glViewport(0, 0, texture_size, texture_size);
-    glClearColor(0, 0, 0, 0);
-    glClear(GL_COLOR_BUFFER_BIT);
+    if (!outline) {
+        auto current_draw_framebuffer = 0;
+        auto current_read_framebuffer = 0;
+        auto current_viewport = std::array<int, 4>{0};
+        auto current_scissor = (unsigned char)false;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &current_draw_framebuffer);
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &current_read_framebuffer);
+        glGetIntegerv(GL_VIEWPORT, current_viewport.data());
+        // Scenes only redrawing part of a frame shouldn't cut off the outline
+        glGetBooleanv(GL_SCISSOR_TEST, &current_scissor);
+        glDisable(GL_SCISSOR_TEST);
+
+        const auto size_base = std::max(x2 - x1, y2 - y1) + margin;
+        const auto texture_size = std::max(
+            std::bit_ceil(static_cast<unsigned>(size_base * gtp)), 8U);
+        const auto size = texture_size / gtp;
+
+        auto framebuffer = gl::get_scratch_framebuffer();
+        ++gl::stats.framebuffer_changes;
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        auto framebuffer_texture = gl::get_scratch_texture(
+            texture_size, texture_size, GL_RGBA32F);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, framebuffer_texture, 0);
+        auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            throw std::runtime_error("Error: Framebuffer is not complete when "
+                    "drawing an outline.");
+        }
+        glViewport(0, 0, texture_size, texture_size);
+        glClearColor(0, 0, 0, 0);
+        glClear(GL_COLOR_BUFFER_BIT);
 
-    auto fake_camera = Camera(20, size, -size);
-    fake_camera.shift((x1 + x2)/2*e1 + (y1 + y2)/2*e2);
+        auto fake_camera = Camera(20, size, -size);
+        fake_camera.shift((x1 + x2)/2*e1 + (y1 + y2)/2*e2);
 
-    draw(fake_camera);
+        draw(fake_camera);
 
-    M_outline_texture = distance_transform(
-        alpha_threshold(
-            framebuffer_texture,
-            0.03,
-            texture_size,
+        auto new_outline = std::make_shared<OutlineTexture>();
+        new_outline->texture = distance_transform(
+            alpha_threshold(
+                framebuffer_texture,
+                0.03,
+                texture_size,
+                texture_size
+            ),
             texture_size
-        ),
-        texture_size
-    );
+        );
+        new_outline->texture_size = texture_size;
+        new_outline->size = size;
+        new_outline->pixels_per_unit = gtp;
+        new_outline->margin = margin;
 
-    glBindTexture(GL_TEXTURE_2D, M_outline_texture);
-    glTexParameteri(
-        GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR
-    );
-    glTexParameteri(
-        GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR
-    );
-    glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, new_outline->texture);
+        glTexParameteri(
+            GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR
+        );
+        glTexParameteri(
+            GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR
+        );
+        glGenerateMipmap(GL_TEXTURE_2D);
+        outline = std::move(new_outline);
+        if (key) cache.insert(*key, outline);
+
+        gl::stats.framebuffer_changes += 2;
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, current_draw_framebuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, current_read_framebuffer);
+        glViewport(
+            current_viewport[0], current_viewport[1],
+            current_viewport[2], current_viewport[3]
+        );
+        if (current_scissor) glEnable(GL_SCISSOR_TEST);
+    }
+    M_outline = outline;
+    const auto size = outline->size;
 
     M_outline_vertex_array = gl::VertexArray();
     M_outline_vertex_buffer = gl::Buffer();
@@ -253,13 +357,63 @@ void SingleObject::create_outline(const Camera& camera)
     }
     glBindVertexArray(0);
 
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, current_draw_framebuffer);
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, current_read_framebuffer);
-    glViewport(
-        current_viewport[0], current_viewport[1],
-        current_viewport[2], current_viewport[3]
-    );
     set_opacity(opacity);
     this->scale(scale);
     apply_rotor(rotor);
 }
+
+bool SingleObject::update_analytic_outline()
+{
+    if (M_outline_mode != OutlineMode::Analytic) return false;
+    // Objects that are being created don't look like their triangles, so
+    // they need the distance field
+    if (M_always_invalidate_outline or get_draw_fraction() != 1.0
+            or is_creating() or noise_creating() != 0.0) {
+        return false;
+    }
+    if (M_analytic_valid) return M_analytic_index_count >= 0;
+    M_analytic_valid = true;
+    auto geometry = get_outline_geometry(
+        M_outline_join, M_outline_miter_limit);
+    if (!geometry) {
+        M_analytic_index_count = -1;
+        return false;
+    }
+    // The distance field isn't needed anymore
+    M_outline.reset();
+    M_analytic_index_count = ssize(geometry->indices);
+
+    using Vertex = OutlineGeometry::Vertex;
+    if (!M_analytic_vertex_array) {
+        M_analytic_vertex_array = gl::VertexArray();
+        M_analytic_vertex_buffer = gl::Buffer();
+        M_analytic_element_buffer = gl::Buffer();
+        glBindVertexArray(M_analytic_vertex_array);
+        glBindBuffer(GL_ARRAY_BUFFER, M_analytic_vertex_buffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, M_analytic_element_buffer);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                              reinterpret_cast<void*>(0));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                              reinterpret_cast<void*>(3*sizeof(float)));
+        glEnableVertexAttribArray(1);
+    }
+    else {
+        glBindVertexArray(M_analytic_vertex_array);
+        glBindBuffer(GL_ARRAY_BUFFER, M_analytic_vertex_buffer);
+    }
+    glBufferData(
+        GL_ARRAY_BUFFER,
+        sizeof(Vertex) * geometry->vertices.size(),
+        geometry->vertices.data(),
+        GL_STATIC_DRAW
+    );
+    glBufferData(
+        GL_ELEMENT_ARRAY_BUFFER,
+        sizeof(unsigned) * geometry->indices.size(),
+        geometry->indices.data(),
+        GL_STATIC_DRAW
+    );
+    glBindVertexArray(0);
+    return true;
+}
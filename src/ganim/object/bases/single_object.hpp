@@ -1,7 +1,12 @@
 #ifndef GANIM_SINGLE_OBJECT_HPP
 #define GANIM_SINGLE_OBJECT_HPP
 
+#include <memory>
+#include <optional>
+
 #include "object.hpp"
+#include "outline_cache.hpp"
+#include "outline_geometry.hpp"
 
 #include "ganim/gl/texture.hpp"
 #include "ganim/gl/vertex_array.hpp"
@@ -13,7 +18,11 @@ namespace ganim {
  * in contrast with @ref ganim::Group "Group"s.
  *
  * It actually isn't much.  The main thing it does is define the default outline
- * drawing algorithm.
+ * drawing algorithm.  Outlines are shared between objects that look the same
+ * through the @ref OutlineCache, as long as the object's class implements
+ * @ref get_outline_hash.  Objects whose class implements @ref
+ * get_outline_geometry can also be outlined without any textures by using
+ * @ref OutlineMode::Analytic.
  */
 class SingleObject : public Object {
     public:
@@ -27,28 +36,82 @@ class SingleObject : public Object {
             return Object::is_visible();
         }
         virtual void draw_outline(const Camera& camera) override;
+        virtual bool has_outline() const override
+        {
+            return get_scale() != 0 and M_outline_thickness != 0.0;
+        }
         virtual void set_outline(
             const Color& color,
             double thickness,
             bool shift_depth = false
         ) override;
         virtual void invalidate_outline() override;
+        virtual void set_outline_mode(
+            OutlineMode mode,
+            OutlineJoin join = OutlineJoin::Round,
+            double miter_limit = 4.0
+        ) override;
+        /** @brief Get how the outline of this object is made. */
+        OutlineMode get_outline_mode() const {return M_outline_mode;}
+        /** @brief Get what the corners of analytic outlines look like. */
+        OutlineJoin get_outline_join() const {return M_outline_join;}
+        /** @brief Get the miter limit of analytic outlines. */
+        double get_outline_miter_limit() const {return M_outline_miter_limit;}
         virtual Color get_outline_color() const override;
         virtual double get_outline_thickness() const override;
         virtual void set_draw_fraction(double value) override;
+        /** @brief Get a hash of everything that affects what this object
+         * looks like when drawn without any transformation.
+         *
+         * Objects with the same hash share their outlines.  Where the object
+         * is in its own coordinates shouldn't matter, because the outline is
+         * drawn around the center of its bounding box, but everything else
+         * should, down to about the size of a pixel.  The color of the object
+         * only matters through its alpha.  By default, this returns nothing,
+         * which means that the object's outline isn't shared.
+         *
+         * @param pixels_per_unit How many pixels one unit of the object's
+         * coordinates is.
+         */
+        virtual std::optional<std::uint64_t> get_outline_hash(
+            double pixels_per_unit
+        ) const;
+        /** @brief Get the triangles of this object's analytic outline, in
+         * its own coordinates.
+         *
+         * This is used when the outline mode is @ref OutlineMode::Analytic.
+         * It should describe what the object looks like without any
+         * transformation, usually by passing its triangles to @ref
+         * make_outline_geometry.  By default, this returns nothing, which
+         * means that the object is outlined with a distance field instead.
+         */
+        virtual std::optional<OutlineGeometry> get_outline_geometry(
+            OutlineJoin join,
+            double miter_limit
+        ) const;
 
     private:
-        void create_outline(const Camera& camera);
+        void create_outline(double pixels_per_unit);
+        double get_outline_margin() const;
+        bool update_analytic_outline();
 
         Color M_outline_color;
         double M_outline_thickness = 0;
         double M_outline_depth = 0;
-        // TODO: Share this with other objects that look the same
-        gl::Texture M_outline_texture = 0;
+        std::shared_ptr<const OutlineTexture> M_outline;
         gl::VertexArray M_outline_vertex_array = 0;
         gl::Buffer M_outline_vertex_buffer = 0;
         gl::Buffer M_outline_element_buffer = 0;
         bool M_always_invalidate_outline = 0;
+        OutlineMode M_outline_mode = OutlineMode::DistanceField;
+        OutlineJoin M_outline_join = OutlineJoin::Round;
+        double M_outline_miter_limit = 4.0;
+        gl::VertexArray M_analytic_vertex_array = 0;
+        gl::Buffer M_analytic_vertex_buffer = 0;
+        gl::Buffer M_analytic_element_buffer = 0;
+        // Negative when the object can't be outlined analytically
+        int M_analytic_index_count = 0;
+        bool M_analytic_valid = false;
 };
 
 }
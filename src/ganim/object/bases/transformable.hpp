@@ -5,6 +5,7 @@
  * @brief Contains the @ref ganim::Transformable "Transformable" class.
  */
 
+#include <cstdint>
 #include <memory>
 
 #include "ganim/ga/conversions.hpp"
@@ -136,9 +137,48 @@ class Transformable : public Animatable {
         ) override;
         ObjectPtr<Transformable> copy() const;
 
+        /** @brief Get a number that changes whenever anything about any
+         * object changes that could affect how it's drawn.
+         *
+         * Scenes use this to know when a frame will look exactly the same as
+         * the one before it.  See @ref SceneBase::set_frame_caching.
+         */
+        static std::uint64_t get_change_version() {return S_change_version;}
+        /** @brief Get what @ref get_change_version was right after this
+         * object last changed.
+         */
+        std::uint64_t get_last_change() const {return M_last_change.value;}
+        /** @brief Record that something about this object that affects how
+         * it's drawn has changed.
+         *
+         * Everything in ganim calls this when it needs to, so you only need
+         * to call this yourself if you have an object that changes how it's
+         * drawn without going through ganim's functions.
+         */
+        void mark_changed() {M_last_change.value = ++S_change_version;}
+
     private:
         virtual Transformable* copy_impl() const override;
+        /** @brief Called whenever the rotor of this object changes. */
+        virtual void transform_changed() {}
+        /** @brief When this object last changed.
+         *
+         * Assigning to an object changes it, so assigning to this records a
+         * new change instead of copying the old one.
+         */
+        class LastChange {
+            public:
+                LastChange()=default;
+                LastChange(const LastChange&) noexcept {}
+                LastChange& operator=(const LastChange&) noexcept
+                    {value = ++S_change_version; return *this;}
+                std::uint64_t value = 0;
+        };
+
         pga3::Even M_rotor = 1;
+        LastChange M_last_change;
+
+        inline static std::uint64_t S_change_version = 0;
 };
 
 }
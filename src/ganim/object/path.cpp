@@ -420,6 +420,7 @@ void Path::set_dash(double on_time, double off_time)
 {
     M_dash_on_time = on_time;
     M_dash_off_time = off_time;
+    mark_changed();
 }
 
 ShaderFeature Path::get_shader_flags()
@@ -439,6 +440,28 @@ void Path::set_subclass_uniforms(gl::Shader& shader)
     }
 }
 
+std::optional<std::uint64_t> Path::get_outline_hash(
+    double pixels_per_unit
+) const
+{
+    auto hash = Shape::get_outline_hash(pixels_per_unit);
+    if (!hash or M_dash_on_time == 0 or M_dash_off_time == 0) return hash;
+    *hash = hash_value(*hash, M_dash_on_time);
+    *hash = hash_value(*hash, M_dash_off_time);
+    // The dashes are placed using the time of each vertex
+    for (auto& v : get_vertices()) *hash = hash_value(*hash, v.t);
+    return hash;
+}
+
+std::optional<OutlineGeometry> Path::get_outline_geometry(
+    OutlineJoin join,
+    double miter_limit
+) const
+{
+    if (M_dash_on_time != 0 and M_dash_off_time != 0) return std::nullopt;
+    return Shape::get_outline_geometry(join, miter_limit);
+}
+
 ObjectPtr<Path> Path::copy() const
 {
     return ObjectPtr<Path>::from_new(copy_impl());
@@ -124,6 +124,15 @@ namespace ganim {
             void set_dash(double on_time, double off_time);
             virtual ShaderFeature get_shader_flags() override;
             virtual void set_subclass_uniforms(gl::Shader& shader) override;
+            /** @brief Dashed paths also hash their dashes. */
+            virtual std::optional<std::uint64_t> get_outline_hash(
+                double pixels_per_unit
+            ) const override;
+            /** @brief Dashed paths don't have an analytic outline. */
+            virtual std::optional<OutlineGeometry> get_outline_geometry(
+                OutlineJoin join,
+                double miter_limit
+            ) const override;
 
             ObjectPtr<Path> copy() const;
 
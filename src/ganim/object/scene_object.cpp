@@ -20,11 +20,27 @@ SceneObject::SceneObject(
         +coord_width / 2 * e1 + coord_height / 2 * e2,
         -coord_width / 2 * e1 + coord_height / 2 * e2
     }),
-    M_scene(pixel_width, pixel_height, coord_width, coord_height, fps)
+    // This has to match the scene it's in, which is a preview when the
+    // environment says so.  That scene might have been given a preview
+    // directly instead, so its framerate is copied over by set_fps too.
+    M_scene(pixel_width, pixel_height, coord_width, coord_height, fps,
+            get_preview_options())
 {
     set_texture_vertices({{0, 1}, {1, 1}, {1, 0}, {0, 0}});
     set_texture(M_scene.get_framebuffer_texture());
     add_updater([this]{
+        auto repeated = M_scene.get_repeated_frame_count();
         M_scene.frame_advance();
+        // The texture only changes when the scene draws something new
+        if (M_scene.get_repeated_frame_count() == repeated) {
+            gl::Texture::mark_modified(M_scene.get_framebuffer_texture());
+            mark_changed();
+        }
     }, true);
 }
+
+void SceneObject::set_fps(int fps)
+{
+    TextureShape<PolygonShape>::set_fps(fps);
+    M_scene.set_fps(fps);
+}
@@ -29,11 +29,19 @@ namespace ganim {
             }
 
             SceneBase& get_scene() {return M_scene;}
+            /** @brief Sets the fps of the scene inside of this too.
+             *
+             * The scene inside advances one frame for every frame of the scene
+             * that this is in, so when that scene is a preview with a lower
+             * framerate, the scene inside has to use the same one.
+             */
+            virtual void set_fps(int fps) override;
 
         private:
             class SceneObjectScene : public SceneBase {
                 public:
                     using SceneBase::SceneBase;
+                    using SceneBase::set_fps;
 
                 private:
                     virtual void process_frame() override {}
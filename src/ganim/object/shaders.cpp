@@ -1,7 +1,16 @@
 #include "shaders.hpp"
 
+#include <filesystem>
+#include <fstream>
+#include <string>
 #include <unordered_map>
-#include <sstream>
+#include <format>
+#include <algorithm>
+
+#include <unistd.h>
+
+#include "ganim/gl/context.hpp"
+#include "ganim/gl/gl.hpp"
 
 using namespace ganim;
 
@@ -9,6 +18,208 @@ using enum ShaderFeature;
 
 namespace {
     std::unordered_map<ShaderFeature, gl::Shader> G_shaders;
+    bool G_disk_cache_enabled = true;
+    const auto cache_directory
+        = std::filesystem::path("ganim_files/shader_cache");
+
+    struct ShaderSources {
+        gl::Shader::Source vertex;
+        gl::Shader::Source geometry;
+        gl::Shader::Source fragment;
+    };
+
+    ShaderSources make_sources(ShaderFeature features)
+    {
+        auto vertex = gl::Shader::Source();
+        auto geometry = gl::Shader::Source();
+        auto fragment = gl::Shader::Source();
+        // Instanced drawing reads from a shader storage buffer
+        auto version = (features & Instanced)
+            ? "#version 430 core\n" : "#version 330 core\n";
+        vertex.add_source(version);
+        geometry.add_source(version);
+        fragment.add_source(version);
+
+        if (features & Time) {
+            vertex.add_source("#define TIME\n");
+            geometry.add_source("#define TIME\n");
+            fragment.add_source("#define TIME\n");
+        }
+        if (features & VertexColors) {
+            vertex.add_source("#define VERTEX_COLORS\n");
+            geometry.add_source("#define VERTEX_COLORS\n");
+            fragment.add_source("#define VERTEX_COLORS\n");
+        }
+        if (features & Texture) {
+            vertex.add_source("#define TEXTURE\n");
+            geometry.add_source("#define TEXTURE\n");
+            fragment.add_source("#define TEXTURE\n");
+        }
+        if (features & Vector) {
+            vertex.add_source("#define VECTOR\n");
+            geometry.add_source("#define VECTOR\n");
+            fragment.add_source("#define VECTOR\n");
+        }
+        if (features & Create) {
+            vertex.add_source("#define CREATE\n");
+            geometry.add_source("#define CREATE\n");
+            fragment.add_source("#define CREATE\n");
+        }
+        if (features & NoiseCreate) {
+            vertex.add_source("#define NOISE_CREATE\n");
+            geometry.add_source("#define NOISE_CREATE\n");
+            fragment.add_source("#define NOISE_CREATE\n");
+        }
+        if (features & FaceShading) {
+            vertex.add_source("#define FACE_SHADING\n");
+            geometry.add_source("#define FACE_SHADING\n");
+            fragment.add_source("#define FACE_SHADING\n");
+        }
+        if (features & DepthPeeling) {
+            vertex.add_source("#define DEPTH_PEELING\n");
+            geometry.add_source("#define DEPTH_PEELING\n");
+            fragment.add_source("#define DEPTH_PEELING\n");
+        }
+        if (features & Dash) {
+            vertex.add_source("#define DASH\n");
+            geometry.add_source("#define DASH\n");
+            fragment.add_source("#define DASH\n");
+        }
+        if (features & TextureTransform) {
+            vertex.add_source("#define TEXTURE_TRANSFORM\n");
+            geometry.add_source("#define TEXTURE_TRANSFORM\n");
+            fragment.add_source("#define TEXTURE_TRANSFORM\n");
+        }
+        if (features & Outline) {
+            vertex.add_source("#define OUTLINE\n");
+            geometry.add_source("#define OUTLINE\n");
+            fragment.add_source("#define OUTLINE\n");
+        }
+        if (features & Pixelate) {
+            vertex.add_source("#define PIXELATE\n");
+            geometry.add_source("#define PIXELATE\n");
+            fragment.add_source("#define PIXELATE\n");
+        }
+        if (features & Squish) {
+            vertex.add_source("#define SQUISH\n");
+            geometry.add_source("#define SQUISH\n");
+            fragment.add_source("#define SQUISH\n");
+        }
+        if (features & Instanced) {
+            vertex.add_source("#define INSTANCED\n");
+            geometry.add_source("#define INSTANCED\n");
+            fragment.add_source("#define INSTANCED\n");
+        }
+        if (features & WeightedTransparency) {
+            vertex.add_source("#define WEIGHTED_TRANSPARENCY\n");
+            geometry.add_source("#define WEIGHTED_TRANSPARENCY\n");
+            fragment.add_source("#define WEIGHTED_TRANSPARENCY\n");
+        }
+        if (features & AnalyticOutline) {
+            vertex.add_source("#define ANALYTIC_OUTLINE\n");
+            geometry.add_source("#define ANALYTIC_OUTLINE\n");
+            fragment.add_source("#define ANALYTIC_OUTLINE\n");
+        }
+
+        vertex.add_source(
+#include "ganim/shaders/vertex.glsl"
+        );
+        geometry.add_source(
+#include "ganim/shaders/geometry.glsl"
+        );
+        fragment.add_source(
+#include "ganim/shaders/fragment.glsl"
+        );
+        return {std::move(vertex), std::move(geometry), std::move(fragment)};
+    }
+
+    // FNV-1a, which is used because it has to give the same result every time
+    // the program runs
+    void hash_bytes(std::uint64_t& hash, std::string_view bytes)
+    {
+        for (auto c : bytes) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 0x100000001b3;
+        }
+    }
+
+    const std::string& driver_string()
+    {
+        static auto result = []{
+            // Shaders can be prewarmed before anything else has made the
+            // context, and without one every string would be null
+            gl::ensure_context();
+            auto result = std::string();
+            for (auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION,
+                              GL_SHADING_LANGUAGE_VERSION}) {
+                auto str = glGetString(name);
+                if (str) result += reinterpret_cast<const char*>(str);
+                result += '\n';
+            }
+            return result;
+        }();
+        return result;
+    }
+
+    std::filesystem::path cache_filename(
+        ShaderFeature features,
+        const ShaderSources& sources
+    )
+    {
+        auto hash = std::uint64_t(0xcbf29ce484222325);
+        hash_bytes(hash, std::to_string(static_cast<std::uint64_t>(features)));
+        hash_bytes(hash, driver_string());
+        for (auto source : {&sources.vertex, &sources.geometry,
+                            &sources.fragment}) {
+            for (auto piece : source->source()) hash_bytes(hash, piece);
+            hash_bytes(hash, "\n");
+        }
+        return cache_directory / std::format("{:016x}.bin", hash);
+    }
+
+    gl::Shader load_cached_shader(const std::filesystem::path& filename)
+    {
+        auto file = std::ifstream(filename, std::ios::binary);
+        if (!file) return gl::Shader(gl::Shader::Binary());
+        auto binary = gl::Shader::Binary();
+        file.read(reinterpret_cast<char*>(&binary.format),
+                  sizeof(binary.format));
+        if (file) {
+            binary.data.assign(std::istreambuf_iterator<char>(file),
+                               std::istreambuf_iterator<char>());
+        }
+        return gl::Shader(binary);
+    }
+
+    void save_cached_shader(
+        const std::filesystem::path& filename,
+        const gl::Shader& shader
+    )
+    {
+        auto binary = shader.get_binary();
+        if (binary.data.empty()) return;
+        auto error = std::error_code();
+        std::filesystem::create_directories(cache_directory, error);
+        if (error) return;
+        // Several processes might be rendering at once, so write to a
+        // temporary file first so that nobody reads half of a binary
+        auto temp = filename;
+        temp += std::format(".{}", getpid());
+        {
+            auto file = std::ofstream(temp, std::ios::binary);
+            file.write(reinterpret_cast<const char*>(&binary.format),
+                       sizeof(binary.format));
+            file.write(reinterpret_cast<const char*>(binary.data.data()),
+                       binary.data.size());
+            if (!file) {
+                file.close();
+                std::filesystem::remove(temp, error);
+                return;
+            }
+        }
+        std::filesystem::rename(temp, filename, error);
+        if (error) std::filesystem::remove(temp, error);
+    }
 }
 
 namespace ganim {
@@ -18,104 +229,107 @@ gl::Shader& get_shader(ShaderFeature features)
     auto it = G_shaders.find(features);
     if (it != G_shaders.end()) return it->second;
 
-    auto vertex = gl::Shader::Source();
-    auto geometry = gl::Shader::Source();
-    auto fragment = gl::Shader::Source();
-    vertex.add_source("#version 330 core\n");
-    geometry.add_source("#version 330 core\n");
-    fragment.add_source("#version 330 core\n");
-
     if ((features & NoiseCreate) and (features & Create)) {
         features ^= Create;
     }
-    if (features & Time) {
-        vertex.add_source("#define TIME\n");
-        geometry.add_source("#define TIME\n");
-        fragment.add_source("#define TIME\n");
-    }
-    if (features & VertexColors) {
-        vertex.add_source("#define VERTEX_COLORS\n");
-        geometry.add_source("#define VERTEX_COLORS\n");
-        fragment.add_source("#define VERTEX_COLORS\n");
-    }
-    if (features & Texture) {
-        vertex.add_source("#define TEXTURE\n");
-        geometry.add_source("#define TEXTURE\n");
-        fragment.add_source("#define TEXTURE\n");
+    auto sources = make_sources(features);
+    auto filename = std::filesystem::path();
+    if (G_disk_cache_enabled) {
+        filename = cache_filename(features, sources);
+        auto shader = load_cached_shader(filename);
+        if (shader) {
+            return G_shaders.emplace(features, std::move(shader)).first->second;
+        }
     }
-    if (features & Vector) {
-        vertex.add_source("#define VECTOR\n");
-        geometry.add_source("#define VECTOR\n");
-        fragment.add_source("#define VECTOR\n");
-    }
-    if (features & Create) {
-        vertex.add_source("#define CREATE\n");
-        geometry.add_source("#define CREATE\n");
-        fragment.add_source("#define CREATE\n");
-    }
-    if (features & NoiseCreate) {
-        vertex.add_source("#define NOISE_CREATE\n");
-        geometry.add_source("#define NOISE_CREATE\n");
-        fragment.add_source("#define NOISE_CREATE\n");
-    }
-    if (features & FaceShading) {
-        vertex.add_source("#define FACE_SHADING\n");
-        geometry.add_source("#define FACE_SHADING\n");
-        fragment.add_source("#define FACE_SHADING\n");
-    }
-    if (features & DepthPeeling) {
-        vertex.add_source("#define DEPTH_PEELING\n");
-        geometry.add_source("#define DEPTH_PEELING\n");
-        fragment.add_source("#define DEPTH_PEELING\n");
-    }
-    if (features & Dash) {
-        vertex.add_source("#define DASH\n");
-        geometry.add_source("#define DASH\n");
-        fragment.add_source("#define DASH\n");
-    }
-    if (features & TextureTransform) {
-        vertex.add_source("#define TEXTURE_TRANSFORM\n");
-        geometry.add_source("#define TEXTURE_TRANSFORM\n");
-        fragment.add_source("#define TEXTURE_TRANSFORM\n");
-    }
-    if (features & Outline) {
-        vertex.add_source("#define OUTLINE\n");
-        geometry.add_source("#define OUTLINE\n");
-        fragment.add_source("#define OUTLINE\n");
-    }
-    if (features & Pixelate) {
-        vertex.add_source("#define PIXELATE\n");
-        geometry.add_source("#define PIXELATE\n");
-        fragment.add_source("#define PIXELATE\n");
-    }
-    if (features & Squish) {
-        vertex.add_source("#define SQUISH\n");
-        geometry.add_source("#define SQUISH\n");
-        fragment.add_source("#define SQUISH\n");
+
+    auto shader = (features & FaceShading)
+        ? gl::Shader(sources.vertex, sources.geometry, sources.fragment)
+        : gl::Shader(sources.vertex, sources.fragment);
+    if (G_disk_cache_enabled and shader) {
+        save_cached_shader(filename, shader);
     }
+    return G_shaders.emplace(features, std::move(shader)).first->second;
+}
 
-    vertex.add_source(
-#include "ganim/shaders/vertex.glsl"
-    );
-    geometry.add_source(
-#include "ganim/shaders/geometry.glsl"
-    );
-    fragment.add_source(
-#include "ganim/shaders/fragment.glsl"
-    );
+void bind_peeling_depth_buffer(
+    const gl::Shader& shader,
+    const gl::Texture& buffer
+)
+{
+    glUniform1i(shader.get_uniform("layer_depth_buffer"), 15);
+    glActiveTexture(GL_TEXTURE15);
+    glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, buffer);
+    auto samples = GLint(0);
+    glGetTexLevelParameteriv(
+        GL_TEXTURE_2D_MULTISAMPLE, 0, GL_TEXTURE_SAMPLES, &samples);
+    glUniform1i(shader.get_uniform("layer_samples"), samples);
+}
 
-    if (features & FaceShading) {
-        return G_shaders.emplace(
-            features,
-            gl::Shader(vertex, geometry, fragment)
-        ).first->second;
+std::vector<ShaderFeature> get_reachable_shader_features()
+{
+    auto result = std::vector<ShaderFeature>();
+    // Adds every combination of the optional features to each base
+    auto add_combinations = [&](
+        std::initializer_list<ShaderFeature> bases,
+        std::initializer_list<ShaderFeature> optional
+    ) {
+        auto optional_vector = std::vector(optional);
+        auto count = std::uint64_t(1) << optional_vector.size();
+        for (auto base : bases) {
+            for (auto mask = std::uint64_t(0); mask < count; ++mask) {
+                auto features = base;
+                for (int i = 0; i < ssize(optional_vector); ++i) {
+                    if (mask & (std::uint64_t(1) << i)) {
+                        features |= optional_vector[i];
+                    }
+                }
+                result.push_back(features);
+            }
+        }
+    };
+    auto shape = Time | VertexColors;
+    // Depth peeling and weighted transparency are never used together
+    for (auto oit : {DepthPeeling, WeightedTransparency}) {
+        for (auto create : {ShaderFeature(), Create, NoiseCreate}) {
+            add_combinations(
+                {shape | create, shape | Texture | create,
+                 shape | Dash | create},
+                {oit, FaceShading, Pixelate, Squish}
+            );
+            add_combinations(
+                {Time | Vector | create},
+                {oit, FaceShading, Squish}
+            );
+        }
+        for (auto create : {ShaderFeature(), Create, NoiseCreate}) {
+            add_combinations(
+                {shape | Instanced | create,
+                 shape | Texture | Instanced | create},
+                {oit}
+            );
+        }
+        add_combinations({Outline, Outline | AnalyticOutline}, {oit, Squish});
+        add_combinations({TextureTransform}, {oit});
     }
-    else {
-        return G_shaders.emplace(
-            features,
-            gl::Shader(vertex, fragment)
-        ).first->second;
+    // The combinations without either were added twice above
+    std::ranges::sort(result, std::less{}, [](ShaderFeature features) {
+        return static_cast<std::uint64_t>(features);
+    });
+    auto duplicates = std::ranges::unique(result);
+    result.erase(duplicates.begin(), duplicates.end());
+    return result;
+}
+
+void prewarm_shaders()
+{
+    for (auto features : get_reachable_shader_features()) {
+        get_shader(features);
     }
 }
 
+void set_shader_disk_cache(bool enabled)
+{
+    G_disk_cache_enabled = enabled;
+}
+
 }
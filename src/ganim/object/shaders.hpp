@@ -1,7 +1,10 @@
 #ifndef GANIM_OBJECT_SHADERS_HPP
 #define GANIM_OBJECT_SHADERS_HPP
 
+#include <vector>
+
 #include "ganim/gl/shader.hpp"
+#include "ganim/gl/texture.hpp"
 
 namespace ganim {
     /** @brief A bitmask enum type that can represent various features that you
@@ -20,7 +23,10 @@ namespace ganim {
         TextureTransform = 1 << 9,
         Outline = 1 << 10,
         Pixelate = 1 << 11,
-        Squish = 1 << 12
+        Squish = 1 << 12,
+        Instanced = 1 << 13,
+        WeightedTransparency = 1 << 14,
+        AnalyticOutline = 1 << 15
     };
     constexpr bool operator&(ShaderFeature f1, ShaderFeature f2)
     {
@@ -48,8 +54,41 @@ namespace ganim {
      * To use this, make a set of features using @ref ShaderFeature using
      * bitwise operations, then call this function with it.  The returned shader
      * will have all of those features.
+     *
+     * Each set of features is only compiled once per process.  Linked programs
+     * are also saved in `ganim_files/shader_cache/`, keyed by the features,
+     * the shader source, and the OpenGL driver, so that later runs can load
+     * them instead of compiling them again.
      */
     gl::Shader& get_shader(ShaderFeature features);
+
+    /** @brief Bind the depth buffer that a shader with @ref
+     * ShaderFeature::DepthPeeling peels against.
+     *
+     * The shader must already be in use.  The buffer is bound to texture unit
+     * 15, and its sample count is passed along so that it can be any
+     * multisampled depth texture.
+     */
+    void bind_peeling_depth_buffer(
+        const gl::Shader& shader,
+        const gl::Texture& buffer
+    );
+
+    /** @brief Get every set of features that ganim's objects can ask for. */
+    std::vector<ShaderFeature> get_reachable_shader_features();
+
+    /** @brief Load or compile every shader that ganim's objects can use.
+     *
+     * Call this at startup to avoid pauses partway through rendering the
+     * first time each shader is needed.  The first time this runs it can be
+     * slow, but afterwards the shaders will be loaded from the disk cache.
+     */
+    void prewarm_shaders();
+
+    /** @brief Set whether linked shaders are saved to and loaded from the
+     * disk.  This is enabled by default.
+     */
+    void set_shader_disk_cache(bool enabled);
 }
 
 #endif
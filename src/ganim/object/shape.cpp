@@ -1,14 +1,47 @@
 #include "shape.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <format>
 #include <ranges>
+#include <stdexcept>
 
 #include "ganim/gl/gl.hpp"
+#include "ganim/gl/stats.hpp"
 #include "ganim/ga/exp.hpp"
 #include "ganim/rate_functions.hpp"
+#include "ganim/util/lerp.hpp"
 #include "shaders.hpp"
+#include "shape_batch.hpp"
 
 using namespace ganim;
 
+namespace {
+    // Vertices are made entirely of floats, so an array of them can be treated
+    // as one big array of floats
+    static_assert(sizeof(Shape::Vertex) == 8 * sizeof(float));
+    std::span<float> vertex_floats(std::vector<Shape::Vertex>& vertices)
+    {
+        return {reinterpret_cast<float*>(vertices.data()), 8 * vertices.size()};
+    }
+    std::span<const float> vertex_floats(
+        const std::vector<Shape::Vertex>& vertices
+    )
+    {
+        return {
+            reinterpret_cast<const float*>(vertices.data()),
+            8 * vertices.size()
+        };
+    }
+    // Flat shapes don't need the shading that shows the faces of 3D ones
+    bool needs_shading(const std::vector<Shape::Vertex>& vertices)
+    {
+        return std::ranges::any_of(vertices,
+                [&](auto& v) {return v.z != vertices[0].z;});
+    }
+}
+
 Shape::Shape(
     std::vector<Vertex> vertices,
     std::vector<unsigned> indices
@@ -22,20 +55,57 @@ void Shape::set_vertices(
     std::vector<unsigned> indices
 )
 {
+    // Only the buffer contents need to change if the sizes are the same
+    if (M_opengl_valid and vertices.size() == M_vertices.size()
+            and indices.size() == M_indices.size()) {
+        if (indices != M_indices) M_indices_dirty = true;
+        mark_vertices_dirty(0, vertices.size());
+    }
+    else M_opengl_valid = false;
     M_vertices = std::move(vertices);
     M_indices = std::move(indices);
     if (!M_vertices.empty()) {
         reset_draw_fractions();
-        M_do_shading = false;
-        for (auto& v : M_vertices) {
-            if (v.z != M_vertices[0].z) {
-                M_do_shading = true;
-                break;
-            }
-        }
+        M_do_shading = needs_shading(M_vertices);
+    }
+    M_changed_after_construction = true;
+    invalidate_bounding_box();
+}
+
+void Shape::update_vertices(
+    std::size_t first,
+    std::span<const Vertex> vertices
+)
+{
+    if (first > M_vertices.size()
+            or vertices.size() > M_vertices.size() - first) {
+        throw std::out_of_range(std::format(
+            "Attempted to update vertices {} to {} of a shape with only {} "
+            "vertices.",
+            first, first + vertices.size(), M_vertices.size()
+        ));
     }
-    M_opengl_valid = false;
+    if (vertices.empty()) return;
+    std::ranges::copy(vertices, M_vertices.begin() + first);
+    reset_draw_fractions();
+    // The update might have made the shape flat again
+    M_do_shading = needs_shading(M_vertices);
+    mark_vertices_dirty(first, vertices.size());
     M_changed_after_construction = true;
+    invalidate_bounding_box();
+}
+
+void Shape::mark_vertices_dirty(std::size_t first, std::size_t count)
+{
+    if (count == 0) return;
+    if (M_dirty_begin == M_dirty_end) {
+        M_dirty_begin = first;
+        M_dirty_end = first + count;
+    }
+    else {
+        M_dirty_begin = std::min(M_dirty_begin, first);
+        M_dirty_end = std::max(M_dirty_end, first + count);
+    }
 }
 
 void Shape::reset_draw_fractions()
@@ -55,7 +125,9 @@ Shape::Shape(const Shape& other)
     M_min_draw_fraction(other.M_min_draw_fraction),
     M_max_draw_fraction(other.M_max_draw_fraction),
     M_opengl_valid(false), // This will make the OpenGL things get remade
-    M_do_shading(other.M_do_shading)
+    M_do_shading(other.M_do_shading),
+    M_original_box(other.M_original_box),
+    M_original_box_valid(other.M_original_box_valid)
 {}
 
 void Shape::draw(const Camera& camera)
@@ -69,19 +141,74 @@ void Shape::draw(const Camera& camera)
         buffer_indices();
         glBindVertexArray(0);
         M_opengl_valid = true;
+        M_dirty_begin = M_dirty_end = 0;
+        M_indices_dirty = false;
+    }
+    else if (M_dirty_begin != M_dirty_end or M_indices_dirty) {
+        glBindVertexArray(M_vertex_array);
+        if (M_dirty_begin != M_dirty_end) {
+            glBindBuffer(GL_ARRAY_BUFFER, M_vertex_buffer);
+            // The first time a shape changes after being drawn, move it to a
+            // buffer that the driver expects to be changed often
+            if (!M_dynamic_vertices) {
+                M_dynamic_vertices = true;
+                buffer_vertices();
+            }
+            else {
+                buffer_vertex_range(M_dirty_begin, M_dirty_end - M_dirty_begin);
+            }
+        }
+        if (M_indices_dirty) {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, M_element_buffer);
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0,
+                            sizeof(unsigned)*M_indices.size(),
+                            M_indices.data());
+        }
+        glBindVertexArray(0);
+        M_dirty_begin = M_dirty_end = 0;
+        M_indices_dirty = false;
     }
     auto& shader = ganim::get_shader(get_shader_flags());
+    ++gl::stats.program_changes;
     glUseProgram(shader);
     set_subclass_uniforms(shader);
     if (auto buffer = peeling_depth_buffer()) {
-        glUniform1i(shader.get_uniform("layer_depth_buffer"), 15);
-        glActiveTexture(GL_TEXTURE15);
-        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, *buffer);
+        bind_peeling_depth_buffer(shader, *buffer);
     }
     glUniform2f(shader.get_uniform("camera_scale"),
                 camera.get_x_scale(), camera.get_y_scale());
     auto view = ~camera.get_rotor();
     shader.set_rotor_uniform("view", view);
+    shader.set_rotor_uniform("model", get_model_rotor(view));
+    auto color = get_color();
+    color.a *= get_opacity();
+    glUniform4f(shader.get_uniform("object_color"),
+            color.r / 255.0, color.g / 255.0,
+            color.b / 255.0, color.a / 255.0);
+    glUniform1f(shader.get_uniform("scale"), get_scale());
+    glUniform1f(shader.get_uniform("depth_z"), get_depth_z());
+    if (is_creating() or noise_creating()) {
+        auto [this_t, noise_scale] = get_creation_parameters();
+        glUniform1f(shader.get_uniform("this_t"), this_t);
+        if (!is_creating()) {
+            glUniform1f(shader.get_uniform("noise_scale"), noise_scale);
+        }
+    }
+    if (M_pixelate_size) {
+        glUniform1i(shader.get_uniform("pixel_size"), M_pixelate_size);
+    }
+    if (get_squish_amount() != 1.0) {
+        glUniform1f(shader.get_uniform("squish_amount"), get_squish_amount());
+        shader.set_plane_uniform("squish_axis", get_squish_axis());
+    }
+    glBindVertexArray(M_vertex_array);
+    ++gl::stats.draw_calls;
+    glDrawElements(GL_TRIANGLES, M_indices.size(), GL_UNSIGNED_INT, nullptr);
+    glBindVertexArray(0);
+}
+
+pga3::Even Shape::get_model_rotor(const pga3::Even& view) const
+{
     auto model = get_rotor();
     if (is_fixed_orientation()) {
         using namespace pga3;
@@ -92,18 +219,15 @@ void Shape::draw(const Camera& camera)
             view.blade_project<e23>() * e23;
         model = ~view_euclidean * model;
     }
-    shader.set_rotor_uniform("model", model);
-    auto color = get_color();
-    color.a *= get_opacity();
-    glUniform4f(shader.get_uniform("object_color"),
-            color.r / 255.0, color.g / 255.0,
-            color.b / 255.0, color.a / 255.0);
-    glUniform1f(shader.get_uniform("scale"), get_scale());
-    glUniform1f(shader.get_uniform("depth_z"), get_depth_z());
+    return model;
+}
+
+std::pair<float, float> Shape::get_creation_parameters() const
+{
     if (is_creating()) {
         auto actual_draw_fraction = M_min_draw_fraction
             + (M_max_draw_fraction - M_min_draw_fraction) * get_draw_fraction();
-        glUniform1f(shader.get_uniform("this_t"), actual_draw_fraction);
+        return {actual_draw_fraction, 0.0f};
     }
     else if (auto noise = noise_creating()) {
         auto actual_noise = noise * (M_max_draw_fraction - M_min_draw_fraction);
@@ -111,19 +235,31 @@ void Shape::draw(const Camera& camera)
         auto actual_max = M_max_draw_fraction + actual_noise;
         auto actual_draw_fraction = actual_min
             + (actual_max - actual_min) * get_draw_fraction();
-        glUniform1f(shader.get_uniform("this_t"), actual_draw_fraction);
-        glUniform1f(shader.get_uniform("noise_scale"), actual_noise);
-    }
-    if (M_pixelate_size) {
-        glUniform1i(shader.get_uniform("pixel_size"), M_pixelate_size);
+        return {actual_draw_fraction, actual_noise};
     }
-    if (get_squish_amount() != 1.0) {
-        glUniform1f(shader.get_uniform("squish_amount"), get_squish_amount());
-        shader.set_plane_uniform("squish_axis", get_squish_axis());
+    return {0.0f, 0.0f};
+}
+
+bool Shape::is_batchable()
+{
+    using enum ShaderFeature;
+    // Bigger shapes than this are already cheap enough to draw on their own
+    // that copying them into the batch isn't worth it
+    constexpr auto max_batch_vertices = 4096;
+    constexpr auto batchable_features =
+        Time | VertexColors | Texture | Create | NoiseCreate | DepthPeeling |
+        WeightedTransparency;
+    if (M_vertices.empty() or ssize(M_vertices) > max_batch_vertices) {
+        return false;
     }
-    glBindVertexArray(M_vertex_array);
-    glDrawElements(GL_TRIANGLES, M_indices.size(), GL_UNSIGNED_INT, nullptr);
-    glBindVertexArray(0);
+    return (get_shader_flags() | batchable_features) == batchable_features;
+}
+
+void Shape::draw_batched(ShapeBatch& batch)
+{
+    if (M_vertices.empty()) return;
+    if (is_batchable()) batch.add(*this);
+    else SingleObject::draw_batched(batch);
 }
 
 void Shape::interpolate(
@@ -148,21 +284,15 @@ void Shape::interpolate(
     if (M_vertices.size() != end2->M_vertices.size()) error();
     if (start2->M_changed_after_construction or
             end2->M_changed_after_construction) {
-        for (int i = 0; i < ssize(M_vertices); ++i) {
-            auto& v1 = start2->M_vertices[i];
-            auto& v2 = M_vertices[i];
-            auto& v3 = end2->M_vertices[i];
-            v2.x = (1 - t)*v1.x + t*v3.x;
-            v2.y = (1 - t)*v1.y + t*v3.y;
-            v2.z = (1 - t)*v1.z + t*v3.z;
-            v2.t = (1 - t)*v1.t + t*v3.t;
-            v2.r = (1 - t)*v1.r + t*v3.r;
-            v2.g = (1 - t)*v1.g + t*v3.g;
-            v2.b = (1 - t)*v1.b + t*v3.b;
-            v2.a = (1 - t)*v1.a + t*v3.a;
-        }
-        M_opengl_valid = false;
+        lerp_floats(
+            vertex_floats(start2->M_vertices),
+            vertex_floats(end2->M_vertices),
+            vertex_floats(M_vertices),
+            static_cast<float>(t)
+        );
+        mark_vertices_dirty(0, M_vertices.size());
         M_changed_after_construction = true;
+        invalidate_bounding_box();
     }
     if (start2->M_do_shading) M_do_shading = true;
 }
@@ -182,11 +312,79 @@ void Shape::pixelate(int pixel_size)
     M_pixelate_size = pixel_size;
 }
 
+std::optional<std::uint64_t> Shape::get_outline_hash(
+    double pixels_per_unit
+) const
+{
+    if (M_vertices.empty()) return std::nullopt;
+    auto [x1, x2] = std::ranges::minmax(M_vertices | std::views::transform(
+        [](auto& v) {return v.x;}));
+    auto [y1, y2] = std::ranges::minmax(M_vertices | std::views::transform(
+        [](auto& v) {return v.y;}));
+    const auto cx = (double(x1) + x2) / 2;
+    const auto cy = (double(y1) + y2) / 2;
+    // Positions only need to match to a fraction of a pixel, and they're
+    // relative to the center so that copies in different places match
+    const auto precision = pixels_per_unit * 64;
+    auto hash = hash_value(hash_start, M_vertices.size());
+    for (auto& v : M_vertices) {
+        auto quantized = std::array<std::int64_t, 4>{
+            std::llround((v.x - cx) * precision),
+            std::llround((v.y - cy) * precision),
+            std::llround(v.z * precision),
+            std::llround(v.a * 255)
+        };
+        hash = hash_value(hash, quantized);
+    }
+    hash = hash_values(hash, std::span(M_indices));
+    return hash_value(hash, M_pixelate_size);
+}
+
+std::optional<OutlineGeometry> Shape::get_outline_geometry(
+    OutlineJoin join,
+    double miter_limit
+) const
+{
+    if (M_pixelate_size != 0) return std::nullopt;
+    auto positions = std::vector<std::array<float, 3>>();
+    positions.reserve(M_vertices.size());
+    for (auto& v : M_vertices) positions.push_back({v.x, v.y, v.z});
+    if (!M_vertices.empty()) {
+        const auto [x1, x2] = std::ranges::minmax(
+            M_vertices | std::views::transform([](auto& v) {return v.x;}));
+        const auto [y1, y2] = std::ranges::minmax(
+            M_vertices | std::views::transform([](auto& v) {return v.y;}));
+        const auto [z1, z2] = std::ranges::minmax(
+            M_vertices | std::views::transform([](auto& v) {return v.z;}));
+        if (z2 - z1 > std::max(x2 - x1, y2 - y1) * 1e-10) {
+            throw std::runtime_error("An outline was attempted to be drawn on "
+                    "an object that seems to have 3D extent.");
+        }
+    }
+    // This matches the threshold used for distance fields
+    auto indices = std::vector<unsigned>();
+    indices.reserve(M_indices.size());
+    for (std::size_t i = 0; i + 2 < M_indices.size(); i += 3) {
+        auto visible = false;
+        for (int j = 0; j < 3; ++j) {
+            const auto index = M_indices[i + j];
+            if (index < M_vertices.size() and M_vertices[index].a >= 0.03) {
+                visible = true;
+            }
+        }
+        if (visible) {
+            indices.insert(indices.end(),
+                    M_indices.begin() + i, M_indices.begin() + i + 3);
+        }
+    }
+    return make_outline_geometry(positions, indices, join, miter_limit);
+}
+
 void Shape::buffer_vertices()
 {
     glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex)*M_vertices.size(),
                  M_vertices.empty() ? nullptr : M_vertices.data(),
-                 GL_STATIC_DRAW);
+                 vertex_buffer_usage());
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
                           reinterpret_cast<void*>(0));
     glEnableVertexAttribArray(0);
@@ -198,6 +396,17 @@ void Shape::buffer_vertices()
     glEnableVertexAttribArray(2);
 }
 
+void Shape::buffer_vertex_range(std::size_t first, std::size_t count)
+{
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(Vertex)*first,
+                    sizeof(Vertex)*count, &M_vertices[first]);
+}
+
+unsigned Shape::vertex_buffer_usage() const
+{
+    return M_dynamic_vertices ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
+}
+
 void Shape::buffer_indices()
 {
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned)*M_indices.size(),
@@ -209,6 +418,7 @@ ShaderFeature Shape::get_shader_flags()
     using enum ShaderFeature;
     auto flags = Time | VertexColors;
     if (peeling_depth_buffer()) flags |= DepthPeeling;
+    if (weighted_transparency()) flags |= WeightedTransparency;
     if (is_creating()) flags |= Create;
     else if (noise_creating()) flags |= NoiseCreate;
     if (M_do_shading) flags |= FaceShading;
@@ -217,32 +427,37 @@ ShaderFeature Shape::get_shader_flags()
     return flags;
 }
 
+void Shape::invalidate_bounding_box()
+{
+    M_original_box_valid = false;
+    SingleObject::invalidate_bounding_box();
+}
+
 Box Shape::get_original_true_bounding_box() const
+{
+    if (M_original_box_valid) return M_original_box;
+    M_original_box = compute_original_box();
+    M_original_box_valid = true;
+    return M_original_box;
+}
+
+Box Shape::compute_original_box() const
 {
     if (M_vertices.empty()) return Box();
-    // TODO: Use caching to be more efficient
+    auto min = std::array{M_vertices[0].x, M_vertices[0].y, M_vertices[0].z};
+    auto max = min;
+    for (auto& v : M_vertices) {
+        min[0] = std::min(min[0], v.x);
+        min[1] = std::min(min[1], v.y);
+        min[2] = std::min(min[2], v.z);
+        max[0] = std::max(max[0], v.x);
+        max[1] = std::max(max[1], v.y);
+        max[2] = std::max(max[2], v.z);
+    }
     using namespace vga3;
-    auto convert_point = [&](const Vertex& p) {
-        return p.x*e1 + p.y*e2 + p.z*e3;
-    };
-    auto transformed_points = M_vertices | std::views::transform(convert_point);
-    auto xs = transformed_points
-        | std::views::transform(&vga3::Vec::blade_project<e1>);
-    auto ys = transformed_points
-        | std::views::transform(&vga3::Vec::blade_project<e2>);
-    auto zs = transformed_points
-        | std::views::transform(&vga3::Vec::blade_project<e3>);
     return Box(
-        vga3::Vec{
-            *std::ranges::min_element(xs),
-            *std::ranges::min_element(ys),
-            *std::ranges::min_element(zs)
-        },
-        vga3::Vec{
-            *std::ranges::max_element(xs),
-            *std::ranges::max_element(ys),
-            *std::ranges::max_element(zs)
-        }
+        double(min[0])*e1 + double(min[1])*e2 + double(min[2])*e3,
+        double(max[0])*e1 + double(max[1])*e2 + double(max[2])*e3
     );
 }
 
@@ -5,6 +5,8 @@
  * @brief Contains the @ref ganim::Shape "Shape" class
  */
 
+#include <span>
+#include <utility>
 #include <vector>
 
 #include "bases/single_object.hpp"
@@ -15,6 +17,7 @@
 #include "ganim/object/shaders.hpp"
 
 namespace ganim {
+    struct TextureVertex;
     /** @brief Represents any object that can be thought of as a shape
      *
      * This is a low-level object that can represent practically any shape of
@@ -64,11 +67,31 @@ namespace ganim {
             Shape& operator=(Shape&&) noexcept=default;
             /** @brief Reset the vertices of this shape.  The parameters are
              * identical to the parameters of the constructor.
+             *
+             * If the number of vertices and indices doesn't change, the
+             * existing OpenGL buffers are reused, and the indices are only
+             * sent to OpenGL again if they are different.
              */
             void set_vertices(
                 std::vector<Vertex> vertices,
                 std::vector<unsigned> indices
             );
+            /** @brief Overwrite some of the vertices of this shape.
+             *
+             * Only the vertices that were changed are sent to OpenGL the next
+             * time this shape is drawn, so this is much cheaper than @ref
+             * set_vertices when only part of a large shape changes.
+             *
+             * @param first The index of the first vertex to overwrite.
+             * @param vertices The new values of the vertices.
+             *
+             * @throws std::out_of_range If the vertices would go past the end
+             * of this shape's vertices.
+             */
+            void update_vertices(
+                std::size_t first,
+                std::span<const Vertex> vertices
+            );
             /** @brief Set whether or not 3D lighting calculations should be
              * done.
              */
@@ -98,7 +121,34 @@ namespace ganim {
              * need to set.
              */
             virtual void set_subclass_uniforms(gl::Shader&) {}
+            /** @brief Determine whether this shape can be drawn as part of a
+             * @ref ShapeBatch.
+             *
+             * By default, this is true for reasonably small shapes that only
+             * use features that can be drawn instanced: vertex colors,
+             * textures, creation, and depth peeling.  Subclasses that set extra
+             * uniforms in @ref set_subclass_uniforms without adding a feature
+             * that already disables batching must override this to return
+             * false.
+             */
+            virtual bool is_batchable();
+            /** @brief Get the texture to bind when drawing this shape in a
+             * batch, or zero if it doesn't have one.
+             */
+            virtual unsigned get_batch_texture() const {return 0;}
+            /** @brief Get the texture coordinates to use when drawing this
+             * shape in a batch, or `nullptr` if it doesn't have a texture.
+             */
+            virtual const std::vector<TextureVertex>*
+                get_batch_texture_vertices() const {return nullptr;}
+            virtual void draw_batched(ShapeBatch& batch) override;
             virtual Box get_original_true_bounding_box() const override;
+            /** @brief Shapes cache their bounding box, which is updated
+             * whenever their vertices change.
+             */
+            virtual bool has_cacheable_bounding_box() const override
+                {return true;}
+            virtual void invalidate_bounding_box() override;
 
             /** @brief Interpolates two shapes.
              *
@@ -110,13 +160,40 @@ namespace ganim {
                 const Animatable& end,
                 double t
             ) override;
+            /** @brief Shapes are hashed by their vertices and indices,
+             * relative to the center of their bounding box.
+             */
+            virtual std::optional<std::uint64_t> get_outline_hash(
+                double pixels_per_unit
+            ) const override;
+            /** @brief Shapes are outlined analytically using their triangles.
+             *
+             * Triangles whose vertices are all almost transparent are left
+             * out, the same as with distance fields.  Pixelated shapes don't
+             * have an analytic outline.
+             *
+             * @throw std::runtime_error If the shape isn't flat.
+             */
+            virtual std::optional<OutlineGeometry> get_outline_geometry(
+                OutlineJoin join,
+                double miter_limit
+            ) const override;
             ObjectPtr<Shape> copy() const;
             void pixelate(int pixel_size);
 
             GANIM_OBJECT_CHAIN_DECLS(Shape)
 
         private:
+            friend class ShapeBatch;
             virtual Shape* copy_impl() const override;
+            /** @brief Get the rotor to use for the model transformation, taking
+             * fixed orientation into account.
+             */
+            pga3::Even get_model_rotor(const pga3::Even& view) const;
+            /** @brief Get the values of `this_t` and `noise_scale` to use when
+             * this shape is being created.
+             */
+            std::pair<float, float> get_creation_parameters() const;
             /** @brief Sends the vertex data to OpenGL.  It's virtual to allow
              * subclasses to change how this happens.  When the function is
              * called, this shape's vertex array will be bound, and this shape's
@@ -129,8 +206,32 @@ namespace ganim {
              * element buffer will be bound to `GL_ELEMENT_ARRAY_BUFFER`.
              */
             virtual void buffer_indices();
+            /** @brief Sends part of the vertex data to OpenGL after the
+             * vertex buffer has already been filled by @ref buffer_vertices.
+             * When the function is called, this shape's vertex buffer will be
+             * bound to `GL_ARRAY_BUFFER`.  The default implementation assumes
+             * that the vertices are at the start of the buffer, which is what
+             * @ref TextureShape does as well.
+             *
+             * @param first The index of the first vertex to send.
+             * @param count The number of vertices to send.
+             */
+            virtual void buffer_vertex_range(
+                std::size_t first,
+                std::size_t count
+            );
+            /** @brief Get the usage hint to pass to `glBufferData` for the
+             * vertex buffer.
+             *
+             * Shapes start out as `GL_STATIC_DRAW` and switch to
+             * `GL_DYNAMIC_DRAW` once their vertices are updated after being
+             * drawn.
+             */
+            unsigned vertex_buffer_usage() const;
+            void mark_vertices_dirty(std::size_t first, std::size_t count);
 
             void reset_draw_fractions();
+            Box compute_original_box() const;
 
             std::vector<Vertex> M_vertices;
             std::vector<unsigned> M_indices;
@@ -140,9 +241,17 @@ namespace ganim {
             gl::Buffer M_vertex_buffer;
             gl::Buffer M_element_buffer;
             bool M_opengl_valid = false;
+            // The range of vertices that has changed since they were last sent
+            // to OpenGL.  This is only used when M_opengl_valid is true.
+            std::size_t M_dirty_begin = 0;
+            std::size_t M_dirty_end = 0;
+            bool M_indices_dirty = false;
+            bool M_dynamic_vertices = false;
             bool M_changed_after_construction = false;
             bool M_do_shading = false;
             int M_pixelate_size = 0;
+            mutable Box M_original_box;
+            mutable bool M_original_box_valid = false;
     };
     /** @brief Make a Shape in an ObjectPtr.
      *
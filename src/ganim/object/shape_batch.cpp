@@ -0,0 +1,224 @@
+#include "shape_batch.hpp"
+
+#include "ganim/gl/gl.hpp"
+#include "ganim/gl/stats.hpp"
+#include "ganim/gl/buffer.hpp"
+#include "ganim/gl/vertex_array.hpp"
+
+#include "shape.hpp"
+#include "texture_shape.hpp"
+
+using namespace ganim;
+
+namespace {
+    // This must match ObjectData in vertex.glsl, using std430 layout
+    struct ObjectData {
+        float model[8];
+        float color[4];
+        float scale;
+        float depth_z;
+        float this_t;
+        float noise_scale;
+    };
+    static_assert(sizeof(ObjectData) == 64);
+
+    // Keeping the size of one draw reasonable keeps the copies cache-friendly
+    // and the buffers a size the driver can handle easily
+    constexpr auto max_batch_vertices = 1 << 16;
+
+    // Only one batch is ever drawn at a time, so they can all share these
+    struct BatchBuffers {
+        gl::VertexArray vertex_array;
+        gl::Buffer vertex_buffer;
+        gl::Buffer texture_buffer;
+        gl::Buffer index_buffer;
+        gl::Buffer element_buffer;
+        gl::Buffer object_buffer;
+        std::vector<Shape::Vertex> vertices;
+        std::vector<TextureVertex> texture_vertices;
+        std::vector<unsigned> object_indices;
+        std::vector<unsigned> elements;
+        std::vector<ObjectData> objects;
+
+        BatchBuffers()
+        {
+            glBindVertexArray(vertex_array);
+            glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
+                    sizeof(Shape::Vertex), reinterpret_cast<void*>(0));
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE,
+                    sizeof(Shape::Vertex),
+                    reinterpret_cast<void*>(3*sizeof(float)));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE,
+                    sizeof(Shape::Vertex),
+                    reinterpret_cast<void*>(4*sizeof(float)));
+            glEnableVertexAttribArray(2);
+            glBindBuffer(GL_ARRAY_BUFFER, texture_buffer);
+            glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE,
+                    sizeof(TextureVertex), reinterpret_cast<void*>(0));
+            glBindBuffer(GL_ARRAY_BUFFER, index_buffer);
+            glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, sizeof(unsigned),
+                    reinterpret_cast<void*>(0));
+            glEnableVertexAttribArray(4);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer);
+            glBindVertexArray(0);
+        }
+    };
+    BatchBuffers& batch_buffers()
+    {
+        static auto result = BatchBuffers();
+        return result;
+    }
+
+    // Replaces the whole contents of a buffer.  Passing the data to
+    // glBufferData lets the driver give us new storage instead of waiting for
+    // the previous draw using this buffer to finish.
+    template <typename T>
+    void upload(unsigned target, unsigned buffer, const std::vector<T>& data)
+    {
+        glBindBuffer(target, buffer);
+        glBufferData(target, sizeof(T) * data.size(), data.data(),
+                     GL_STREAM_DRAW);
+    }
+}
+
+ShapeBatch::~ShapeBatch()
+{
+    flush();
+}
+
+void ShapeBatch::draw(Object& object)
+{
+    if (object.has_outline()) {
+        flush();
+        object.draw_outline(M_camera);
+    }
+    object.draw_batched(*this);
+}
+
+void ShapeBatch::add(Shape& shape)
+{
+    auto flags = shape.get_shader_flags();
+    auto texture = shape.get_batch_texture();
+    auto peeling_depth_buffer = shape.peeling_depth_buffer();
+    auto vertex_count = static_cast<int>(shape.get_vertices().size());
+    if (!M_shapes.empty() and (
+            flags != M_flags or
+            texture != M_texture or
+            peeling_depth_buffer != M_peeling_depth_buffer or
+            M_vertex_count + vertex_count > max_batch_vertices)) {
+        flush();
+    }
+    M_flags = flags;
+    M_texture = texture;
+    M_peeling_depth_buffer = peeling_depth_buffer;
+    M_vertex_count += vertex_count;
+    M_shapes.push_back(&shape);
+}
+
+void ShapeBatch::flush()
+{
+    if (M_shapes.empty()) return;
+    if (M_shapes.size() == 1) {
+        // Nothing to gain by batching, so use the normal path.  The depth
+        // peeling buffer might have been reset since the shape was added.
+        auto& shape = *M_shapes[0];
+        auto old_buffer = shape.peeling_depth_buffer();
+        shape.set_peeling_depth_buffer(M_peeling_depth_buffer);
+        shape.draw(M_camera);
+        shape.set_peeling_depth_buffer(old_buffer);
+    }
+    else draw_instanced();
+    M_shapes.clear();
+    M_vertex_count = 0;
+}
+
+void ShapeBatch::draw_instanced()
+{
+    using namespace pga3;
+    auto& buffers = batch_buffers();
+    buffers.vertices.clear();
+    buffers.texture_vertices.clear();
+    buffers.object_indices.clear();
+    buffers.elements.clear();
+    buffers.objects.clear();
+    const bool textured = M_flags & ShaderFeature::Texture;
+    const auto view = ~M_camera.get_rotor();
+
+    for (auto shape : M_shapes) {
+        const auto object_index = static_cast<unsigned>(buffers.objects.size());
+        const auto first_vertex = static_cast<unsigned>(buffers.vertices.size());
+        const auto& vertices = shape->get_vertices();
+        buffers.vertices.insert(
+                buffers.vertices.end(), vertices.begin(), vertices.end());
+        buffers.object_indices.insert(
+                buffers.object_indices.end(), vertices.size(), object_index);
+        if (textured) {
+            const auto& texture_vertices = *shape->get_batch_texture_vertices();
+            buffers.texture_vertices.insert(buffers.texture_vertices.end(),
+                    texture_vertices.begin(), texture_vertices.end());
+        }
+        for (auto index : shape->get_indices()) {
+            buffers.elements.push_back(first_vertex + index);
+        }
+
+        auto model = shape->get_model_rotor(view);
+        auto color = shape->get_color();
+        color.a *= shape->get_opacity();
+        auto [this_t, noise_scale] = shape->get_creation_parameters();
+        buffers.objects.push_back({
+            {
+                static_cast<float>(model.blade_project<e>()),
+                static_cast<float>(model.blade_project<e23>()),
+                static_cast<float>(model.blade_project<e31>()),
+                static_cast<float>(model.blade_project<e12>()),
+                static_cast<float>(model.blade_project<e01>()),
+                static_cast<float>(model.blade_project<e02>()),
+                static_cast<float>(model.blade_project<e03>()),
+                static_cast<float>(model.blade_project<e0123>())
+            },
+            {
+                color.r / 255.0f, color.g / 255.0f,
+                color.b / 255.0f, color.a / 255.0f
+            },
+            static_cast<float>(shape->get_scale()),
+            static_cast<float>(shape->get_depth_z()),
+            this_t,
+            noise_scale
+        });
+    }
+
+    auto& shader = get_shader(M_flags | ShaderFeature::Instanced);
+    ++gl::stats.program_changes;
+    glUseProgram(shader);
+    if (textured) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, M_texture);
+        glUniform1i(shader.get_uniform("in_texture"), 0);
+    }
+    if (M_peeling_depth_buffer) {
+        bind_peeling_depth_buffer(shader, *M_peeling_depth_buffer);
+    }
+    glUniform2f(shader.get_uniform("camera_scale"),
+                M_camera.get_x_scale(), M_camera.get_y_scale());
+    shader.set_rotor_uniform("view", view);
+
+    glBindVertexArray(buffers.vertex_array);
+    upload(GL_ARRAY_BUFFER, buffers.vertex_buffer, buffers.vertices);
+    upload(GL_ARRAY_BUFFER, buffers.index_buffer, buffers.object_indices);
+    if (textured) {
+        upload(GL_ARRAY_BUFFER, buffers.texture_buffer,
+               buffers.texture_vertices);
+        glEnableVertexAttribArray(3);
+    }
+    else glDisableVertexAttribArray(3);
+    upload(GL_ELEMENT_ARRAY_BUFFER, buffers.element_buffer, buffers.elements);
+    upload(GL_SHADER_STORAGE_BUFFER, buffers.object_buffer, buffers.objects);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffers.object_buffer);
+    ++gl::stats.draw_calls;
+    glDrawElements(GL_TRIANGLES, buffers.elements.size(), GL_UNSIGNED_INT,
+                   nullptr);
+    glBindVertexArray(0);
+}
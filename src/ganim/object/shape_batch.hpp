@@ -0,0 +1,78 @@
+#ifndef GANIM_OBJECT_SHAPE_BATCH_HPP
+#define GANIM_OBJECT_SHAPE_BATCH_HPP
+
+/** @file
+ * @brief Contains the @ref ganim::ShapeBatch "ShapeBatch" class
+ */
+
+#include <vector>
+
+#include "ganim/object/shaders.hpp"
+
+namespace ganim {
+    class Camera;
+    class Object;
+    class Shape;
+    namespace gl {class Texture;}
+
+    /** @brief Collects shapes that can be drawn with a single draw call.
+     *
+     * Drawing a lot of small shapes one at a time spends most of its time
+     * binding shaders and setting uniforms.  Instead, you can @ref add shapes
+     * to a batch, and consecutive shapes that use the same shader, texture,
+     * and depth peeling layer will all be drawn at once using @ref
+     * ShaderFeature::Instanced, with the per-object uniforms moved into a
+     * shader storage buffer.  Shapes are always drawn in the order they were
+     * added, so this doesn't affect how transparent objects blend.
+     *
+     * Anything that isn't a batchable shape will flush the batch before it is
+     * drawn, so you can pass every object through @ref draw and it will be
+     * drawn exactly like it would be without batching.  Note that nothing is
+     * guaranteed to be drawn until @ref flush is called.
+     */
+    class ShapeBatch {
+        public:
+            /** @brief Constructor
+             *
+             * @param camera The camera that everything in the batch will be
+             * drawn with.  It must outlive this batch.
+             */
+            explicit ShapeBatch(const Camera& camera) : M_camera(camera) {}
+            ShapeBatch(const ShapeBatch&)=delete;
+            ShapeBatch& operator=(const ShapeBatch&)=delete;
+            /** @brief Draws anything that is still waiting to be drawn. */
+            ~ShapeBatch();
+            /** @brief Draw an object and its outline through this batch.
+             *
+             * This is a replacement for calling `draw_outline` and then
+             * `draw` on the object.  The batch is flushed before any outline
+             * is drawn, so outlines still end up behind everything drawn
+             * after them.
+             */
+            void draw(Object& object);
+            /** @brief Add a shape to the batch.
+             *
+             * The shape must be batchable (see @ref Shape::is_batchable).  If
+             * it can't be merged with the shapes that are already waiting, the
+             * batch is flushed first.  The shape must not be modified or
+             * destroyed until the batch is flushed.
+             */
+            void add(Shape& shape);
+            /** @brief Draw everything that is waiting to be drawn. */
+            void flush();
+            /** @brief Get the camera that this batch draws with. */
+            const Camera& get_camera() const {return M_camera;}
+
+        private:
+            void draw_instanced();
+
+            const Camera& M_camera;
+            std::vector<Shape*> M_shapes;
+            ShaderFeature M_flags = ShaderFeature::Time;
+            unsigned M_texture = 0;
+            gl::Texture* M_peeling_depth_buffer = nullptr;
+            int M_vertex_count = 0;
+    };
+}
+
+#endif
@@ -76,6 +76,7 @@ namespace ganim {
             void set_texture(unsigned texture)
             {
                 M_texture = texture;
+                this->mark_changed();
             }
             virtual void draw(const Camera& camera) override
             {
@@ -92,6 +93,53 @@ namespace ganim {
             {
                 texture_shape_helper::set_uniforms(shader);
             }
+            /** @brief Textured shapes also hash their texture and texture
+             * coordinates.
+             *
+             * The texture's contents aren't hashed, only its id and its
+             * generation (see @ref gl::Texture::get_generation).  When a
+             * texture is drawn to after a shape using it is outlined, the
+             * texture needs to be marked with @ref gl::Texture::mark_modified
+             * so that the old outline isn't shared, and the shape needs to
+             * call @ref invalidate_outline, like it would without sharing.
+             * @ref SceneObject and @ref Video mark their textures
+             * themselves.
+             */
+            virtual std::optional<std::uint64_t> get_outline_hash(
+                double pixels_per_unit
+            ) const override
+            {
+                auto hash = T::get_outline_hash(pixels_per_unit);
+                if (!hash) return hash;
+                *hash = hash_value(*hash, M_texture);
+                *hash = hash_value(
+                    *hash, gl::Texture::get_generation(M_texture));
+                return hash_values(*hash, std::span(M_texture_vertices));
+            }
+            /** @brief The shape of a textured shape depends on its texture,
+             * so it doesn't have an analytic outline.
+             */
+            virtual std::optional<OutlineGeometry> get_outline_geometry(
+                OutlineJoin,
+                double
+            ) const override
+            {
+                return std::nullopt;
+            }
+            virtual bool is_batchable() override
+            {
+                return M_texture_vertices.size() == this->get_vertices().size()
+                    and T::is_batchable();
+            }
+            virtual unsigned get_batch_texture() const override
+            {
+                return M_texture;
+            }
+            virtual const std::vector<TextureVertex>*
+                get_batch_texture_vertices() const override
+            {
+                return &M_texture_vertices;
+            }
 
             ObjectPtr<TextureShape> copy() const
             {
@@ -4,6 +4,7 @@
 #include "ganim/math.hpp"
 
 #include "ganim/gl/gl.hpp"
+#include "ganim/gl/stats.hpp"
 
 #include "shaders.hpp"
 
@@ -217,6 +218,7 @@ void Vector::lock_orientation(bool lock)
 
 Vector& Vector::vector_scale(double scale)
 {
+    mark_changed();
     if (M_manual_transform or M_animating) {
         M_vector_scale *= scale;
         return *this;
@@ -271,11 +273,10 @@ Box Vector::get_original_true_bounding_box() const
 void Vector::draw(const Camera& camera)
 {
     auto& shader = *get_shader();
+    ++gl::stats.program_changes;
     glUseProgram(shader);
     if (auto buffer = peeling_depth_buffer()) {
-        glUniform1i(shader.get_uniform("layer_depth_buffer"), 15);
-        glActiveTexture(GL_TEXTURE15);
-        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, *buffer);
+        bind_peeling_depth_buffer(shader, *buffer);
     }
     glUniform2f(shader.get_uniform("camera_scale"),
                 camera.get_x_scale(), camera.get_y_scale());
@@ -333,9 +334,11 @@ void Vector::draw(const Camera& camera)
 
     glBindVertexArray(M_vertex_array);
     if (M_3d) {
+        ++gl::stats.draw_calls;
         glDrawElements(GL_TRIANGLES, index_size_3d, GL_UNSIGNED_INT, nullptr);
     }
     else {
+        ++gl::stats.draw_calls;
         glDrawElements(GL_TRIANGLES, index_size_2d, GL_UNSIGNED_INT, nullptr);
     }
     glBindVertexArray(0);
@@ -346,6 +349,7 @@ gl::Shader* Vector::get_shader()
     using enum ShaderFeature;
     auto flags = Time | Vector;
     if (peeling_depth_buffer()) flags |= DepthPeeling;
+    if (weighted_transparency()) flags |= WeightedTransparency;
     if (M_do_shading) flags |= FaceShading;
     if (is_creating()) flags |= Create;
     else if (noise_creating()) flags |= NoiseCreate;
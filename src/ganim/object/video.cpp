@@ -158,6 +158,8 @@ void Video::update()
         GL_RGB, GL_UNSIGNED_BYTE, data
     );
     glGenerateMipmap(GL_TEXTURE_2D);
+    gl::Texture::mark_modified(M_impl->texture);
+    mark_changed();
 }
 
 bool Video::send_packet()
@@ -1,3 +1,7 @@
 #include "ganim/scene/camera.hpp"
 #include "ganim/scene/base.hpp"
 #include "ganim/scene/scene.hpp"
+#include "ganim/scene/chunked_render.hpp"
+#include "ganim/scene/preview.hpp"
+#include "ganim/scene/profiler.hpp"
+#include "ganim/scene/render_window.hpp"
@@ -1,47 +1,29 @@
 #include "base.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 #include <cmath>
+#include <cstdlib>
+#include <filesystem>
 #include <format>
+#include <limits>
+#include <optional>
 #include <ranges>
-#include <SFML/Window.hpp>
+#include <span>
 
 #include "ganim/gl/gl.hpp"
+#include "ganim/gl/stats.hpp"
+
+#include "ganim/util/box.hpp"
+
+#include "ganim/scene/chunked_render.hpp"
 
 #include "ganim/object/image.hpp"
+#include "ganim/object/shape_batch.hpp"
 
 using namespace ganim;
 
-// I may need to do something else later, but for now this should work to get a
-// valid context
 namespace {
-    auto settings = sf::ContextSettings(24, 0, 4, 4, 3, sf::ContextSettings::Debug);
-    auto context = sf::Context(settings, {1, 1});
-    void debug_callback(
-        GLenum source,
-        GLenum type,
-        GLuint id,
-        GLenum severity,
-        GLsizei length,
-        const GLchar* message,
-        const void*
-    )
-    {
-        if (severity == GL_DEBUG_SEVERITY_NOTIFICATION) return;
-        throw std::runtime_error(std::format(
-            "OpenGL Error:\n"
-            "Source: {}\n"
-            "Type: {}\n"
-            "ID: {}\n"
-            "Severity: {}\n"
-            "Message: {}\n",
-            source, type, id, severity, std::string_view(message, length)));
-    }
-    auto stupid = []{
-        glDebugMessageCallback(debug_callback, nullptr);
-        return 1;
-    }();
-
     auto layer_vertices = std::array{
          1.0f,  1.0f,
         -1.0f,  1.0f,
@@ -52,10 +34,7 @@ namespace {
         0U, 1U, 3U,
         0U, 3U, 2U
     };
-    auto layer_shader = []{
-        auto vertex = gl::Shader::Source();
-        auto fragment = gl::Shader::Source();
-        vertex.add_source(R"(
+    constexpr auto layer_vertex_source = R"(
 #version 330 core
 
 layout (location = 0) in vec2 in_pos;
@@ -64,26 +43,220 @@ void main()
 {
     gl_Position = vec4(in_pos.xy, 1, 1);
 }
-        )");
-        fragment.add_source(R"(
+    )";
+    gl::Shader& layer_shader()
+    {
+        static auto result = []{
+            auto vertex = gl::Shader::Source();
+            auto fragment = gl::Shader::Source();
+            vertex.add_source(layer_vertex_source);
+            fragment.add_source(R"(
 #version 330 core
 
 out vec4 color;
 
 uniform sampler2DMS texture;
+uniform int samples;
 
 void main()
 {
     ivec2 pos = ivec2(round(gl_FragCoord.x - 0.5), round(gl_FragCoord.y - 0.5));
     color = vec4(0);
-    for (int i = 0; i < 4; ++i) {
+    for (int i = 0; i < samples; ++i) {
         color += texelFetch(texture, pos, i);
     }
-    color /= 4;
+    color /= samples;
 }
-        )");
-        return gl::Shader(vertex, fragment);
-    }();
+            )");
+            return gl::Shader(vertex, fragment);
+        }();
+        return result;
+    }
+
+    gl::Shader& weighted_transparency_shader()
+    {
+        static auto result = []{
+            auto vertex = gl::Shader::Source();
+            auto fragment = gl::Shader::Source();
+            vertex.add_source(layer_vertex_source);
+            fragment.add_source(R"(
+#version 330 core
+
+out vec4 color;
+
+uniform sampler2DMS accumulation;
+uniform sampler2DMS revealage;
+uniform int samples;
+
+void main()
+{
+    ivec2 pos = ivec2(round(gl_FragCoord.x - 0.5), round(gl_FragCoord.y - 0.5));
+    vec4 total = vec4(0);
+    float reveal = 0;
+    for (int i = 0; i < samples; ++i) {
+        total += texelFetch(accumulation, pos, i);
+        reveal += texelFetch(revealage, pos, i).r;
+    }
+    total /= samples;
+    reveal /= samples;
+    if (reveal >= 1) discard;
+    // This is blended using the revealage as the alpha, so what's behind is
+    // only visible as much as the transparent objects let it through
+    color = vec4(total.rgb / max(total.a, 1e-5), reveal);
+}
+            )");
+            return gl::Shader(vertex, fragment);
+        }();
+        return result;
+    }
+
+    // This is the simple version of FXAA that only looks at the four diagonal
+    // neighbors of each pixel to find the direction of the edge through it
+    gl::Shader& fxaa_shader()
+    {
+        static auto result = []{
+            auto vertex = gl::Shader::Source();
+            auto fragment = gl::Shader::Source();
+            vertex.add_source(layer_vertex_source);
+            fragment.add_source(R"(
+#version 330 core
+
+out vec4 color;
+
+uniform sampler2D image;
+uniform vec2 inverse_size;
+
+const vec3 luma = vec3(0.299, 0.587, 0.114);
+
+void main()
+{
+    vec2 pos = gl_FragCoord.xy * inverse_size;
+    vec4 middle = texture(image, pos);
+    vec2 offset = inverse_size;
+    float luma_nw = dot(texture(image, pos + vec2(-1, 1)*offset).rgb, luma);
+    float luma_ne = dot(texture(image, pos + vec2(1, 1)*offset).rgb, luma);
+    float luma_sw = dot(texture(image, pos + vec2(-1, -1)*offset).rgb, luma);
+    float luma_se = dot(texture(image, pos + vec2(1, -1)*offset).rgb, luma);
+    float luma_m = dot(middle.rgb, luma);
+    float luma_min = min(
+        luma_m, min(min(luma_nw, luma_ne), min(luma_sw, luma_se)));
+    float luma_max = max(
+        luma_m, max(max(luma_nw, luma_ne), max(luma_sw, luma_se)));
+
+    vec2 dir = vec2(
+        (luma_sw + luma_se) - (luma_nw + luma_ne),
+        (luma_nw + luma_sw) - (luma_ne + luma_se)
+    );
+    float reduce = max(
+        (luma_nw + luma_ne + luma_sw + luma_se) * (0.25 / 8.0),
+        1.0 / 128.0
+    );
+    float scale = 1.0 / (min(abs(dir.x), abs(dir.y)) + reduce);
+    dir = clamp(dir * scale, vec2(-8), vec2(8)) * inverse_size;
+
+    vec4 near = 0.5 * (
+        texture(image, pos + dir * (1.0/3.0 - 0.5)) +
+        texture(image, pos + dir * (2.0/3.0 - 0.5))
+    );
+    vec4 far = near * 0.5 + 0.25 * (
+        texture(image, pos - dir * 0.5) +
+        texture(image, pos + dir * 0.5)
+    );
+    float luma_far = dot(far.rgb, luma);
+    // Going too far along the edge can cross into something else
+    color = (luma_far < luma_min || luma_far > luma_max) ? near : far;
+}
+            )");
+            return gl::Shader(vertex, fragment);
+        }();
+        return result;
+    }
+
+    GLenum internal_format(FramebufferFormat format)
+    {
+        switch (format) {
+            case FramebufferFormat::RGBA32F: return GL_RGBA32F;
+            case FramebufferFormat::RGBA16F: return GL_RGBA16F;
+            case FramebufferFormat::RGBA8: return GL_RGBA8;
+            case FramebufferFormat::RGB10_A2: return GL_RGB10_A2;
+        }
+        throw std::invalid_argument("Invalid framebuffer format");
+    }
+
+    void allocate_multisample(
+        const gl::Texture& texture,
+        int samples,
+        GLenum format,
+        int width,
+        int height
+    )
+    {
+        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, texture);
+        glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, samples, format,
+                                width, height, GL_TRUE);
+    }
+
+    void check_framebuffer(const char* name)
+    {
+        auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            throw std::runtime_error(
+                    std::format("Error: {} is not complete.", name));
+        }
+    }
+
+    void make_layer_quad(
+        gl::VertexArray& vertex_array,
+        gl::Buffer& vertex_buffer,
+        gl::Buffer& element_buffer
+    )
+    {
+        glBindVertexArray(vertex_array);
+        glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(layer_vertices),
+                     layer_vertices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float)*2,
+                              reinterpret_cast<void*>(0));
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(layer_indices),
+                     layer_indices.data(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
+    }
+
+    // How far past the edges of objects to redraw when only redrawing part of
+    // the frame.  This covers antialiasing and FXAA.
+    constexpr int damage_margin = 4;
+
+    // Every worker of a chunked render writes its own trace, so they don't
+    // overwrite each other
+    std::string trace_filename_from_environment(std::string value)
+    {
+        if (value == "1") return "";
+        auto chunks = get_chunk_assignment();
+        if (!chunks) return value;
+        auto path = std::filesystem::path(value);
+        auto filename = std::format("{}.worker{}{}", path.stem().string(),
+                                    chunks->worker, path.extension().string());
+        return (path.parent_path() / filename).string();
+    }
+
+    // Objects that are drawn normally when using weighted transparency.  A
+    // group that is drawn together, like a polyhedron, can have transparent
+    // pieces even when the group itself is opaque, so it's only opaque when
+    // all of them are.
+    bool is_opaque(const Object& object)
+    {
+        if (object.get_opacity() < 1.0 or object.get_color().a != 255) {
+            return false;
+        }
+        if (auto group = dynamic_cast<const Group*>(&object)) {
+            return std::ranges::all_of(*group, [](auto& subobject) {
+                return !subobject->is_visible() or is_opaque(*subobject);
+            });
+        }
+        return true;
+    }
 }
 
 SceneBase::SceneBase(
@@ -91,14 +264,21 @@ SceneBase::SceneBase(
     int pixel_height,
     double coord_width,
     double coord_height,
-    int fps
+    int fps,
+    std::optional<PreviewOptions> preview
 )
-:   M_pixel_width(pixel_width),
-    M_pixel_height(pixel_height),
-    M_fps(fps),
+:   M_pixel_width(preview ? preview->scale_pixels(pixel_width) : pixel_width),
+    M_pixel_height(
+        preview ? preview->scale_pixels(pixel_height) : pixel_height),
+    M_fps(preview ? preview->scale_fps(fps) : fps),
+    M_preview(preview.has_value()),
     M_camera(ObjectPtr<Camera>(20, coord_width, coord_height)),
-    M_static_camera(20, coord_width, coord_height)
+    M_static_camera(20, coord_width, coord_height),
+    M_registry(std::make_unique<ObjectRegistry>(M_fps))
 {
+    if (auto env = std::getenv("GANIM_PROFILE")) {
+        enable_profiling(trace_filename_from_environment(env));
+    }
     add(M_camera);
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
@@ -106,101 +286,190 @@ SceneBase::SceneBase(
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glDepthFunc(GL_LEQUAL);
 
-    glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, M_framebuffer_texture);
-    glTexImage2DMultisample(
-        GL_TEXTURE_2D_MULTISAMPLE, 4, GL_RGBA32F, pixel_width, pixel_height,
-        GL_TRUE
-    );
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (M_preview) {
+        M_framebuffer_format = FramebufferFormat::RGBA8;
+        M_samples = 1;
+    }
+    allocate_framebuffers();
+}
+
+void SceneBase::set_framebuffer_format(FramebufferFormat format, int samples)
+{
+    auto max_color_samples = GLint(0);
+    auto max_depth_samples = GLint(0);
+    glGetIntegerv(GL_MAX_COLOR_TEXTURE_SAMPLES, &max_color_samples);
+    glGetIntegerv(GL_MAX_DEPTH_TEXTURE_SAMPLES, &max_depth_samples);
+    const auto max_samples = std::min(max_color_samples, max_depth_samples);
+    if (samples < 1 or samples > max_samples) {
+        throw std::invalid_argument(std::format(
+            "Invalid number of samples {} passed to "
+            "SceneBase::set_framebuffer_format.  It must be between 1 and {}.",
+            samples, max_samples
+        ));
+    }
+    M_framebuffer_format = format;
+    M_samples = M_preview ? 1 : samples;
+    M_frame_cache_valid = false;
+    allocate_framebuffers();
+}
+
+void SceneBase::allocate_framebuffers()
+{
+    const auto format = internal_format(M_framebuffer_format);
+    allocate_multisample(M_framebuffer_texture, M_samples, format,
+                         M_pixel_width, M_pixel_height);
+    allocate_multisample(M_depth_buffer, M_samples, GL_DEPTH_COMPONENT,
+                         M_pixel_width, M_pixel_height);
+    ++gl::stats.framebuffer_changes;
     glBindFramebuffer(GL_FRAMEBUFFER, M_framebuffer);
     glFramebufferTexture2D(
         GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE,
         M_framebuffer_texture, 0
     );
-    auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-    if (status != GL_FRAMEBUFFER_COMPLETE) {
-        throw std::runtime_error("Error: Framebuffer is not complete.");
-    }
-
-    glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, M_depth_buffer);
-    glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, 4, GL_DEPTH_COMPONENT,
-                 pixel_width, pixel_height, GL_TRUE);
     glFramebufferTexture2D(
         GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D_MULTISAMPLE,
         M_depth_buffer, 0
     );
+    check_framebuffer("Framebuffer");
 
     glBindTexture(GL_TEXTURE_2D, M_downsampled_framebuffer_texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, pixel_width, pixel_height, 0,
+    glTexImage2D(GL_TEXTURE_2D, 0, format, M_pixel_width, M_pixel_height, 0,
                  GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    ++gl::stats.framebuffer_changes;
     glBindFramebuffer(GL_FRAMEBUFFER, M_downsampled_framebuffer);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
                            M_downsampled_framebuffer_texture, 0);
-    status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-    if (status != GL_FRAMEBUFFER_COMPLETE) {
-        throw std::runtime_error(
-                "Error: Downsampled framebuffer is not complete.");
+    check_framebuffer("Downsampled framebuffer");
+
+    if (M_samples == 1) {
+        if (!M_fxaa) {
+            M_fxaa = std::make_unique<FXAABuffers>();
+            make_layer_quad(M_fxaa->vertex_array, M_fxaa->vertex_buffer,
+                            M_fxaa->element_buffer);
+        }
+        glBindTexture(GL_TEXTURE_2D, M_fxaa->texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, M_pixel_width, M_pixel_height,
+                     0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        // FXAA relies on linear filtering to blend across edges
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        ++gl::stats.framebuffer_changes;
+        glBindFramebuffer(GL_FRAMEBUFFER, M_fxaa->framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, M_fxaa->texture, 0);
+        check_framebuffer("FXAA framebuffer");
     }
+    else {
+        M_fxaa.reset();
+    }
+
+    for (auto& layer : M_depth_layers) allocate_depth_layer(layer);
+    if (M_weighted_transparency) allocate_weighted_transparency();
 }
 
 SceneBase::~SceneBase()
 {
     // Some updaters hold ObjectPtrs to the object they're updating, meaning
     // that there will be a memory leak unless we break these loops here.
-    for (auto& object : M_animatables) {
+    if (!M_registry) return;
+    for (auto& object : M_registry->get_animatables()) {
         object->clear_all_updaters();
     }
 }
 
 void SceneBase::frame_advance()
 {
-    clean_up();
-    update();
+    auto profiler = M_profiler.get();
+    if (profiler) profiler->begin_frame(M_frame_count);
+    auto frame_scope = Profiler::Scope(profiler, "frame");
     {
-        auto objects_copy = M_animatables;
-        for (auto& object : objects_copy) {
-            object->update();
+        auto scope = Profiler::Scope(profiler, "clean_up");
+        clean_up();
+    }
+    {
+        auto scope = Profiler::Scope(profiler, "updaters");
+        update();
+        // Anything added while updating shouldn't be updated until the next
+        // frame.  Nothing is removed until clean_up, so indices stay valid.
+        auto& animatables = M_registry->get_animatables();
+        const auto count = animatables.size();
+        for (std::size_t i = 0; i < count; ++i) {
+            animatables[i].get()->update();
         }
     }
-    clean_up();
-    auto drawables = M_objects;
-    std::ranges::stable_sort(
-        drawables,
-        std::less{},
-        [&](auto& obj) {return obj->get_depth_z();}
-    );
-    if (M_animating) {
+    {
+        auto scope = Profiler::Scope(profiler, "clean_up");
+        clean_up();
+    }
+    {
+        auto scope = Profiler::Scope(profiler, "sort");
+        update_draw_list();
+    }
+    const auto output = M_animating and in_render_window(M_frame_count);
+    const auto drawing = output and draws_frame(M_frame_count);
+    const auto unchanged = drawing and frame_unchanged();
+    auto damage = std::optional<PixelRect>();
+    if (drawing and !unchanged and M_partial_redraws) {
+        auto scope = Profiler::Scope(profiler, "damage");
+        damage = find_damage();
+    }
+    if (unchanged or (damage and damage->empty())) {
+        auto scope = Profiler::Scope(profiler, "repeat frame");
+        ++M_repeated_frames;
+        ++gl::stats.framebuffer_changes;
+        glBindFramebuffer(GL_FRAMEBUFFER, M_downsampled_framebuffer);
+        repeat_frame();
+    }
+    else if (drawing) {
+        const auto world_objects = std::span(M_draw_list)
+                                 .first(M_fixed_draw_list_begin);
+        const auto fixed_objects = std::span(M_draw_list)
+                                 .subspan(M_fixed_draw_list_begin);
         glViewport(0, 0, M_pixel_width, M_pixel_height);
+        if (damage) {
+            // Everything else is still in the framebuffers from last time
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(damage->x1, damage->y1,
+                      damage->x2 - damage->x1, damage->y2 - damage->y1);
+        }
         if (!M_depth_layers.empty()) {
             glDisable(GL_BLEND);
             for (int i = 0; i < ssize(M_depth_layers); ++i) {
+                // Only make the name when it's used, since this happens
+                // every frame
+                auto scope = Profiler::Scope(profiler,
+                        profiler ? std::format("depth layer {}", i) : "", true);
                 auto& l = M_depth_layers[i];
+                ++gl::stats.framebuffer_changes;
                 glBindFramebuffer(GL_FRAMEBUFFER, l.framebuffer);
                 glClearColor(0, 0, 0, 0);
                 glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-                for (auto object : drawables) {
+                auto batch = ShapeBatch(*M_camera);
+                for (auto object : world_objects) {
                     if (object->is_visible()) {
-                        if (!object->is_fixed_in_frame()) {
-                            if (i == 0) {
-                                object->set_peeling_depth_buffer(nullptr);
-                            }
-                            else {
-                                object->set_peeling_depth_buffer(
-                                    &M_depth_layers[i-1].depth_buffer
-                                );
-                            }
-                            object->draw_outline(*M_camera);
-                            object->draw(*M_camera);
+                        if (i == 0) {
                             object->set_peeling_depth_buffer(nullptr);
                         }
+                        else {
+                            object->set_peeling_depth_buffer(
+                                &M_depth_layers[i-1].depth_buffer
+                            );
+                        }
+                        batch.draw(*object);
+                        object->set_peeling_depth_buffer(nullptr);
                     }
                 }
+                batch.flush();
             }
             glEnable(GL_BLEND);
         }
+        auto world_scope = std::optional<Profiler::Scope>();
+        world_scope.emplace(profiler, "draw world", true);
+        ++gl::stats.framebuffer_changes;
         glBindFramebuffer(GL_FRAMEBUFFER, M_framebuffer);
         glClearColor(
             M_background_color.r / 255.0,
@@ -217,45 +486,101 @@ void SceneBase::frame_advance()
             for (auto& layer : std::views::reverse(M_depth_layers)) {
                 glActiveTexture(GL_TEXTURE0);
                 glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, layer.texture);
-                glUseProgram(layer_shader);
+                ++gl::stats.program_changes;
+                glUseProgram(layer_shader());
+                glUniform1i(layer_shader().get_uniform("samples"), M_samples);
                 glBindVertexArray(layer.vertex_array);
+                ++gl::stats.draw_calls;
                 glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
                 glBindVertexArray(0);
                 glClear(GL_DEPTH_BUFFER_BIT);
             }
         }
+        else if (M_weighted_transparency) {
+            draw_weighted_transparency(world_objects);
+        }
         else {
-            for (auto object : drawables) {
+            auto batch = ShapeBatch(*M_camera);
+            for (auto object : world_objects) {
                 object->set_peeling_depth_buffer(nullptr);
-                if (object->is_visible()) {
-                    if (!object->is_fixed_in_frame()) {
-                        object->draw_outline(*M_camera);
-                        object->draw(*M_camera);
-                    }
-                }
+                if (object->is_visible()) batch.draw(*object);
             }
+            batch.flush();
         }
-        glClear(GL_DEPTH_BUFFER_BIT);
-        for (auto object : drawables) {
-            if (object->is_visible()) {
-                if (object->is_fixed_in_frame()) {
-                    object->draw_outline(M_static_camera);
-                    object->draw(M_static_camera);
-                }
+        world_scope.reset();
+        {
+            auto scope = Profiler::Scope(profiler, "draw fixed", true);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            auto fixed_batch = ShapeBatch(M_static_camera);
+            for (auto object : fixed_objects) {
+                if (object->is_visible()) fixed_batch.draw(*object);
             }
+            fixed_batch.flush();
         }
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, M_downsampled_framebuffer);
-        glBlitFramebuffer(
-            0, 0, M_pixel_width, M_pixel_height,
-            0, 0, M_pixel_width, M_pixel_height,
-            GL_COLOR_BUFFER_BIT, GL_NEAREST
-        );
-        glBindFramebuffer(GL_FRAMEBUFFER, M_downsampled_framebuffer);
-        process_frame();
+        {
+            auto scope = Profiler::Scope(profiler, "downsample", true);
+            ++gl::stats.framebuffer_changes;
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, M_fxaa
+                    ? M_fxaa->framebuffer
+                    : M_downsampled_framebuffer);
+            glBlitFramebuffer(
+                0, 0, M_pixel_width, M_pixel_height,
+                0, 0, M_pixel_width, M_pixel_height,
+                GL_COLOR_BUFFER_BIT, GL_NEAREST
+            );
+            if (M_fxaa) draw_fxaa();
+            ++gl::stats.framebuffer_changes;
+            glBindFramebuffer(GL_FRAMEBUFFER, M_downsampled_framebuffer);
+        }
+        glDisable(GL_SCISSOR_TEST);
+        auto scope = Profiler::Scope(profiler, "process frame");
+        if (damage) {
+            process_partial_frame(damage->y1, damage->y2 - damage->y1);
+        }
+        else {
+            process_frame();
+            if (M_partial_redraws) update_object_rects();
+        }
+        // Drawing can change objects, such as when outlines are made, so
+        // this has to be checked afterwards
+        M_cached_change_version = Transformable::get_change_version();
+        M_cached_objects_version = M_registry->get_objects_version();
+        M_frame_cache_valid = true;
     }
+    if (output) ++M_output_frame_count;
     ++M_frame_count;
 }
 
+void SceneBase::update_draw_list()
+{
+    const auto objects_version = M_registry->get_objects_version();
+    const auto draw_order_version = Object::get_draw_order_version();
+    if (M_draw_list_valid and
+            objects_version == M_draw_list_objects_version and
+            draw_order_version == M_draw_list_order_version) {
+        return;
+    }
+    M_draw_list_valid = true;
+    M_draw_list_objects_version = objects_version;
+    M_draw_list_order_version = draw_order_version;
+    // Everything in the draw list is kept alive by the registry until the
+    // next clean_up, which always happens before this is called again
+    M_draw_list.clear();
+    for (auto& object : M_registry->get_objects()) {
+        M_draw_list.push_back(object.get());
+    }
+    std::ranges::stable_sort(
+        M_draw_list,
+        std::less{},
+        [](auto obj) {return obj->get_depth_z();}
+    );
+    auto fixed = std::ranges::stable_partition(
+        M_draw_list,
+        [](auto obj) {return !obj->is_fixed_in_frame();}
+    );
+    M_fixed_draw_list_begin = fixed.begin() - M_draw_list.begin();
+}
+
 void SceneBase::frame_advance(int amount)
 {
     if (amount < 0) {
@@ -286,6 +611,21 @@ double SceneBase::get_time() const
     return double(M_frame_count) / M_fps;
 }
 
+void SceneBase::set_fps(int fps)
+{
+    if (fps <= 0) {
+        throw std::invalid_argument(std::format(
+            "The fps of a scene must be positive, not {}.", fps));
+    }
+    M_fps = fps;
+    M_registry->set_fps(fps);
+}
+
+int SceneBase::get_output_frame_count() const
+{
+    return M_output_frame_count;
+}
+
 void SceneBase::stop_animating()
 {
     M_animating = false;
@@ -296,159 +636,358 @@ void SceneBase::start_animating()
     M_animating = true;
 }
 
-void SceneBase::add_animatable_base(ObjectPtr<Animatable> object)
+void SceneBase::set_render_window(std::optional<RenderWindow> window)
 {
-    if (std::ranges::find(M_animatables, object) == M_animatables.end()) {
-        object->set_fps(M_fps);
-        M_animatables.emplace_back(object);
+    if (window and (window->start < 0 or window->end < window->start)) {
+        throw std::invalid_argument(std::format(
+            "Invalid render window from {} to {} passed to "
+            "SceneBase::set_render_window",
+            window->start, window->end
+        ));
     }
+    M_render_window = window;
+}
+
+bool SceneBase::in_render_window(int frame) const
+{
+    return !M_render_window or M_render_window->contains(frame, M_fps);
 }
 
-void SceneBase::add_object_base(ObjectPtr<Object> object)
+bool SceneBase::draws_frame(int) const
 {
-    auto anim = ObjectPtr<Animatable>(object);
-    if (std::ranges::find(M_animatables, anim) == M_animatables.end()) {
-        if (std::ranges::find(M_objects, object) == M_objects.end()) {
-            M_objects.emplace_back(object);
+    return true;
+}
+
+void SceneBase::repeat_frame()
+{
+    process_frame();
+}
+
+void SceneBase::process_partial_frame(int, int)
+{
+    process_frame();
+}
+
+bool SceneBase::frame_unchanged() const
+{
+    return M_frame_caching and M_frame_cache_valid
+        and M_cached_change_version == Transformable::get_change_version()
+        and M_cached_objects_version == M_registry->get_objects_version();
+}
+
+void SceneBase::set_frame_caching(bool enabled)
+{
+    M_frame_caching = enabled;
+    M_frame_cache_valid = false;
+    if (!enabled) M_partial_redraws = false;
+}
+
+void SceneBase::set_partial_redraws(bool enabled)
+{
+    if (enabled) M_frame_caching = true;
+    M_partial_redraws = enabled;
+    M_frame_cache_valid = false;
+    M_object_rects.clear();
+}
+
+SceneBase::PixelRect SceneBase::PixelRect::united(
+    const PixelRect& other
+) const
+{
+    if (empty()) return other;
+    if (other.empty()) return *this;
+    return {
+        std::min(x1, other.x1),
+        std::min(y1, other.y1),
+        std::max(x2, other.x2),
+        std::max(y2, other.y2)
+    };
+}
+
+SceneBase::PixelRect SceneBase::get_pixel_rect(const Object& object) const
+{
+    if (!object.is_visible()) return {};
+    const auto screen = PixelRect{0, 0, M_pixel_width, M_pixel_height};
+    // These are turned to face the camera when they're drawn, which their
+    // bounding boxes don't know about
+    if (object.is_fixed_orientation()) return screen;
+    const auto& camera = object.is_fixed_in_frame()
+        ? M_static_camera : *M_camera;
+    using namespace pga3;
+    const auto box = transform_box(
+            object.get_true_bounding_box(), ~camera.get_rotor());
+    const auto p1 = box.get_inner_lower_left().undual();
+    const auto p2 = box.get_outer_upper_right().undual();
+    const auto outline = object.get_outline_thickness();
+    const auto z2 = p2.blade_project<e3>() + outline;
+    // Anything reaching behind the camera can't be projected
+    if (z2 >= -1e-6) return screen;
+
+    // This is the same projection as in vertex.glsl, including its y flip
+    auto left = std::numeric_limits<double>::infinity();
+    auto right = -left;
+    auto bottom = left;
+    auto top = -left;
+    for (auto x : {p1.blade_project<e1>() - outline,
+                   p2.blade_project<e1>() + outline}) {
+        for (auto y : {p1.blade_project<e2>() - outline,
+                       p2.blade_project<e2>() + outline}) {
+            for (auto z : {p1.blade_project<e3>() - outline, z2}) {
+                const auto ndc_x = x * camera.get_x_scale() / -z;
+                const auto ndc_y = y * camera.get_y_scale() / z;
+                left = std::min(left, ndc_x);
+                right = std::max(right, ndc_x);
+                bottom = std::min(bottom, ndc_y);
+                top = std::max(top, ndc_y);
+            }
         }
     }
+    auto to_pixel = [](double ndc, int size) {
+        return (ndc + 1) / 2 * size;
+    };
+    auto result = PixelRect{
+        static_cast<int>(std::floor(to_pixel(left, M_pixel_width)))
+            - damage_margin,
+        static_cast<int>(std::floor(to_pixel(bottom, M_pixel_height)))
+            - damage_margin,
+        static_cast<int>(std::ceil(to_pixel(right, M_pixel_width)))
+            + damage_margin,
+        static_cast<int>(std::ceil(to_pixel(top, M_pixel_height)))
+            + damage_margin
+    };
+    result.x1 = std::clamp(result.x1, 0, M_pixel_width);
+    result.y1 = std::clamp(result.y1, 0, M_pixel_height);
+    result.x2 = std::clamp(result.x2, 0, M_pixel_width);
+    result.y2 = std::clamp(result.y2, 0, M_pixel_height);
+    return result;
 }
 
-void SceneBase::add_group_base(ObjectPtr<Group> object, bool together)
+std::optional<SceneBase::PixelRect> SceneBase::find_damage()
 {
-    for (auto& group : M_groups) {
-        if (group.first == object) return;
+    if (!M_frame_cache_valid) return std::nullopt;
+    if (M_cached_objects_version != M_registry->get_objects_version()) {
+        return std::nullopt;
     }
-    M_groups.emplace_back(object, together);
-    if (!together) add_object_base(object);
-    add_animatable_base(object);
-    together |= object->drawing_together();
-    add_group_subobjects(object, together);
+    // Moving the camera moves everything
+    if (M_camera->get_last_change() > M_cached_change_version) {
+        return std::nullopt;
+    }
+    auto damage = PixelRect();
+    for (auto object : M_draw_list) {
+        if (!object->changed_since(M_cached_change_version)) continue;
+        auto& rect = M_object_rects[object];
+        const auto new_rect = get_pixel_rect(*object);
+        damage = damage.united(rect).united(new_rect);
+        rect = new_rect;
+    }
+    if (2 * damage.area() > long(M_pixel_width) * M_pixel_height) {
+        return std::nullopt;
+    }
+    return damage;
 }
 
-void SceneBase::add_group_subobjects(ObjectPtr<Group>& object, bool together)
+void SceneBase::update_object_rects()
 {
-    for (auto& obj : object->take_new_subobjects()) {
-        auto group = obj.dynamic_pointer_cast<Group>();
-        if (group.get()) {
-            add_group_base(group, together);
-        }
-        else {
-            if (!together) add_object_base(obj);
-            add_animatable_base(obj);
-        }
+    M_object_rects.clear();
+    for (auto object : M_draw_list) {
+        M_object_rects[object] = get_pixel_rect(*object);
     }
 }
 
 void SceneBase::add_animatable(ObjectPtr<Animatable> object)
 {
-    add_animatable_base(object);
-    auto p1 = object.dynamic_pointer_cast<Group>();
-    if (p1.get()) {
-        add_group(p1);
-        return;
-    }
-    auto p2 = object.dynamic_pointer_cast<Object>();
-    if (p2.get()) {
-        add_object(p2);
-    }
+    M_registry->add_animatable(std::move(object));
 }
 
 void SceneBase::add_object(ObjectPtr<Object> object)
 {
-    auto p = object.dynamic_pointer_cast<Group>();
-    if (p.get()) {
-        add_group(p);
-        return;
-    }
-    add_object_base(object);
-    add_animatable_base(object);
+    M_registry->add_object(std::move(object));
 }
 
 void SceneBase::add_group(ObjectPtr<Group> object)
 {
-    add_group_base(object, false);
+    M_registry->add_object(std::move(object));
 }
 
 void SceneBase::clean_up()
 {
-    auto groups_copy = M_groups;
-    for (auto& [group, together] : groups_copy) {
-        add_group_subobjects(group, together);
-    }
-    groups_copy.clear();
-    bool something_happened = false;
-    for (auto it = M_groups.begin(); it != M_groups.end(); ) {
-        if (it->first.use_count() == 3) {
-            it = M_groups.erase(it);
-            something_happened = true;
-        }
-        else ++it;
-    }
-    for (auto it = M_objects.begin(); it != M_objects.end(); ) {
-        if (it->use_count() == 2) {
-            it = M_objects.erase(it);
-            something_happened = true;
-        }
-        else ++it;
-    }
-    for (auto it = M_animatables.begin(); it != M_animatables.end(); ) {
-        if (it->use_count() == 1) {
-            it = M_animatables.erase(it);
-            something_happened = true;
-        }
-        else ++it;
-    }
-    if (something_happened) clean_up();
+    M_registry->clean_up();
+}
+
+void SceneBase::enable_profiling(std::string trace_filename)
+{
+    M_profiler = std::make_unique<Profiler>(std::move(trace_filename));
 }
 
 void SceneBase::set_transparency_layers(int layers)
 {
+    if (M_preview) return;
     auto old_size = M_depth_layers.size();
     M_depth_layers.resize(layers);
+    M_frame_cache_valid = false;
     for (int i = old_size; i < layers; ++i) {
         auto& l = M_depth_layers[i];
-        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, l.texture);
-        glTexImage2DMultisample(
-            GL_TEXTURE_2D_MULTISAMPLE, 4, GL_RGBA32F,
-            M_pixel_width, M_pixel_height, GL_TRUE
-        );
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glBindFramebuffer(GL_FRAMEBUFFER, l.framebuffer);
-        glFramebufferTexture2D(
-            GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE,
-            l.texture, 0
-        );
+        allocate_depth_layer(l);
+        make_layer_quad(l.vertex_array, l.vertex_buffer, l.element_buffer);
+    }
+    if (layers > 0) M_weighted_transparency.reset();
+}
 
-        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, l.depth_buffer);
-        glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, 4,
-            GL_DEPTH_COMPONENT, M_pixel_width, M_pixel_height, GL_TRUE);
-        glFramebufferTexture2D(
-            GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D_MULTISAMPLE,
-            l.depth_buffer, 0
-        );
+void SceneBase::allocate_depth_layer(DepthLayer& layer)
+{
+    allocate_multisample(layer.texture, M_samples,
+                         internal_format(M_framebuffer_format),
+                         M_pixel_width, M_pixel_height);
+    allocate_multisample(layer.depth_buffer, M_samples, GL_DEPTH_COMPONENT,
+                         M_pixel_width, M_pixel_height);
+    ++gl::stats.framebuffer_changes;
+    glBindFramebuffer(GL_FRAMEBUFFER, layer.framebuffer);
+    glFramebufferTexture2D(
+        GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE,
+        layer.texture, 0
+    );
+    glFramebufferTexture2D(
+        GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D_MULTISAMPLE,
+        layer.depth_buffer, 0
+    );
+    check_framebuffer("Framebuffer");
+}
 
-        auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-        if (status != GL_FRAMEBUFFER_COMPLETE) {
-            throw std::runtime_error("Error: Framebuffer is not complete.");
+void SceneBase::set_weighted_transparency(bool enabled)
+{
+    M_frame_cache_valid = false;
+    if (!enabled) {
+        M_weighted_transparency.reset();
+        return;
+    }
+    if (M_weighted_transparency) return;
+    set_transparency_layers(0);
+    M_weighted_transparency = std::make_unique<WeightedTransparencyBuffers>();
+    auto& w = *M_weighted_transparency;
+    make_layer_quad(w.vertex_array, w.vertex_buffer, w.element_buffer);
+    allocate_weighted_transparency();
+}
+
+void SceneBase::allocate_weighted_transparency()
+{
+    auto& w = *M_weighted_transparency;
+    allocate_multisample(w.accumulation, M_samples, GL_RGBA16F,
+                         M_pixel_width, M_pixel_height);
+    allocate_multisample(w.revealage, M_samples, GL_R16F,
+                         M_pixel_width, M_pixel_height);
+    ++gl::stats.framebuffer_changes;
+    glBindFramebuffer(GL_FRAMEBUFFER, w.framebuffer);
+    glFramebufferTexture2D(
+        GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE,
+        w.accumulation, 0
+    );
+    glFramebufferTexture2D(
+        GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D_MULTISAMPLE,
+        w.revealage, 0
+    );
+    // Sharing the depth buffer lets the opaque objects hide the transparent
+    // ones behind them
+    glFramebufferTexture2D(
+        GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D_MULTISAMPLE,
+        M_depth_buffer, 0
+    );
+    auto draw_buffers = std::array<GLenum, 2>{
+        GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1
+    };
+    glDrawBuffers(draw_buffers.size(), draw_buffers.data());
+    check_framebuffer("Weighted transparency framebuffer");
+}
+
+void SceneBase::draw_weighted_transparency(std::span<Object* const> objects)
+{
+    auto& w = *M_weighted_transparency;
+    // The opaque objects are drawn normally first so that they fill in the
+    // depth buffer
+    {
+        auto batch = ShapeBatch(*M_camera);
+        for (auto object : objects) {
+            object->set_peeling_depth_buffer(nullptr);
+            if (object->is_visible() and is_opaque(*object)) {
+                batch.draw(*object);
+            }
         }
+    }
 
-        glBindVertexArray(l.vertex_array);
-        glBindBuffer(GL_ARRAY_BUFFER, l.vertex_buffer);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(layer_vertices),
-                     layer_vertices.data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float)*2,
-                              reinterpret_cast<void*>(0));
-        glEnableVertexAttribArray(0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, l.element_buffer);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(layer_indices),
-                     layer_indices.data(), GL_STATIC_DRAW);
-        glBindVertexArray(0);
+    ++gl::stats.framebuffer_changes;
+    glBindFramebuffer(GL_FRAMEBUFFER, w.framebuffer);
+    auto clear_accumulation = std::array{0.0f, 0.0f, 0.0f, 0.0f};
+    auto clear_revealage = std::array{1.0f, 1.0f, 1.0f, 1.0f};
+    glClearBufferfv(GL_COLOR, 0, clear_accumulation.data());
+    glClearBufferfv(GL_COLOR, 1, clear_revealage.data());
+    glDepthMask(GL_FALSE);
+    glBlendFunci(0, GL_ONE, GL_ONE);
+    glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+    // The transparent objects can be drawn in any order.  The flag is only
+    // cleared after the batch is flushed, since shapes are drawn then.
+    {
+        auto batch = ShapeBatch(*M_camera);
+        for (auto object : objects) {
+            if (object->is_visible() and !is_opaque(*object)) {
+                object->set_weighted_transparency(true);
+                batch.draw(*object);
+            }
+        }
+    }
+    for (auto object : objects) {
+        if (object->weighted_transparency()) {
+            object->set_weighted_transparency(false);
+        }
     }
+    glDepthMask(GL_TRUE);
+
+    ++gl::stats.framebuffer_changes;
+    glBindFramebuffer(GL_FRAMEBUFFER, M_framebuffer);
+    glDisable(GL_DEPTH_TEST);
+    glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+    auto& shader = weighted_transparency_shader();
+    ++gl::stats.program_changes;
+    glUseProgram(shader);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, w.accumulation);
+    glUniform1i(shader.get_uniform("accumulation"), 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, w.revealage);
+    glUniform1i(shader.get_uniform("revealage"), 1);
+    glUniform1i(shader.get_uniform("samples"), M_samples);
+    glBindVertexArray(w.vertex_array);
+    ++gl::stats.draw_calls;
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void SceneBase::draw_fxaa()
+{
+    ++gl::stats.framebuffer_changes;
+    glBindFramebuffer(GL_FRAMEBUFFER, M_downsampled_framebuffer);
+    // Every pixel is replaced, including its alpha
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    auto& shader = fxaa_shader();
+    ++gl::stats.program_changes;
+    glUseProgram(shader);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, M_fxaa->texture);
+    glUniform1i(shader.get_uniform("image"), 0);
+    glUniform2f(shader.get_uniform("inverse_size"),
+                1.0f / M_pixel_width, 1.0f / M_pixel_height);
+    glBindVertexArray(M_fxaa->vertex_array);
+    ++gl::stats.draw_calls;
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+    glBindVertexArray(0);
+    glEnable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
 }
 
 void SceneBase::set_background_image(const std::string& filename)
 {
     M_background_object = std::make_unique<Image>(filename);
+    M_frame_cache_valid = false;
 }
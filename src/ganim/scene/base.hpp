@@ -5,6 +5,10 @@
  * @brief The @ref ganim::SceneBase "SceneBase" class
  */
 
+#include <memory>
+#include <optional>
+#include <span>
+#include <unordered_map>
 #include <vector>
 
 #include "ganim/color.hpp"
@@ -14,10 +18,34 @@
 #include "ganim/gl/vertex_array.hpp"
 
 #include "camera.hpp"
+#include "object_registry.hpp"
+#include "preview.hpp"
+#include "profiler.hpp"
+#include "render_window.hpp"
 
 #include "ganim/object/bases/group.hpp"
 
 namespace ganim {
+    /** @brief The format of the color buffers that a scene draws into.
+     *
+     * See @ref SceneBase::set_framebuffer_format.
+     */
+    enum class FramebufferFormat {
+        /** @brief 32-bit floats for each channel.  This is the default. */
+        RGBA32F,
+        /** @brief 16-bit floats for each channel */
+        RGBA16F,
+        /** @brief 8-bit normalized integers for each channel */
+        RGBA8,
+        /** @brief 10-bit normalized integers for each color channel and two
+         * bits of alpha.
+         *
+         * The alpha channel can only be 0, 1/3, 2/3, or 1, so only use this
+         * when the background is opaque.
+         */
+        RGB10_A2
+    };
+
     /** @brief The base class for scenes, which contains most of the scene logic
      *
      * This class has all of the scene logic except for what to actually do with
@@ -41,13 +69,18 @@ namespace ganim {
              * @param coord_height The height, in coordinate units, of this
              * scene.
              * @param fps The framerate, in frames per second, of this scene.
+             * @param preview If this is set, the scene is drawn as a quick
+             * preview.  The pixel size and framerate are scaled down as
+             * described in @ref PreviewOptions, there is only one sample per
+             * pixel, and transparency layers are ignored.
              */
             SceneBase(
                 int pixel_width,
                 int pixel_height,
                 double coord_width,
                 double coord_height,
-                int fps
+                int fps,
+                std::optional<PreviewOptions> preview = std::nullopt
             );
             virtual ~SceneBase();
             SceneBase(SceneBase&&) noexcept=default;
@@ -85,6 +118,16 @@ namespace ganim {
              * the scene.
              */
             double get_time() const;
+            /** @brief Get the number of frames that have been output since
+             * the start of the scene.
+             *
+             * This is like @ref get_frame_count, except that frames skipped
+             * with @ref stop_animating or outside of the render window aren't
+             * counted.  Frames that a subclass skips with @ref draws_frame
+             * are still counted, so this is where the current frame is in the
+             * output of a full render.
+             */
+            int get_output_frame_count() const;
             /** @brief Stop animating the scene
              *
              * This is used to save on rendering time when you only want to see
@@ -97,14 +140,32 @@ namespace ganim {
              * This is used to reverse a call to @ref stop_animating
              */
             void start_animating();
+            /** @brief Get the part of the scene that is drawn, if any. */
+            const std::optional<RenderWindow>& get_render_window() const
+                {return M_render_window;}
+            /** @brief Get whether a frame is inside of the render window.
+             *
+             * This is always true if there is no render window.
+             */
+            bool in_render_window(int frame) const;
 
             /** @brief Get the width, in pixels, of this scene. */
             constexpr int pixel_width() const {return M_pixel_width;}
             /** @brief Get the height, in pixels, of this scene. */
             constexpr int pixel_height() const {return M_pixel_height;}
+            /** @brief Get the framerate of this scene.
+             *
+             * For previews, this is the reduced framerate.
+             */
+            constexpr int get_fps() const {return M_fps;}
+            /** @brief Get whether this scene is drawn as a preview. */
+            constexpr bool is_preview() const {return M_preview;}
             /** @brief Set the background color of this scene. */
             constexpr void set_background_color(const Color& color)
-                {M_background_color = color;}
+            {
+                M_background_color = color;
+                M_frame_cache_valid = false;
+            }
             /** @brief Set how many layers of transparency to draw.
              *
              * By default, ganim won't do anything to try to draw transparent
@@ -113,14 +174,132 @@ namespace ganim {
              * objects, call this function with the maximum number of
              * overlapping transparent objects.  Note that the use of this
              * feature is pretty expensive, so it should be avoided when
-             * possible.
+             * possible.  See @ref set_weighted_transparency for a cheaper
+             * alternative.  Using any layers turns weighted transparency off.
+             *
+             * Previews don't draw transparency layers, so this does nothing
+             * in them.
              */
             void set_transparency_layers(int layers);
+            /** @brief Set whether to draw transparent objects using weighted
+             * blended order-independent transparency.
+             *
+             * This draws every opaque object normally, and then draws every
+             * transparent object once into a pair of buffers that are
+             * combined at the end, so it costs about as much as drawing the
+             * scene once.  Unlike @ref set_transparency_layers, the result is
+             * only an approximation: overlapping transparent objects are
+             * blended by how close they are instead of being sorted exactly.
+             *
+             * An object counts as transparent when its opacity or the alpha
+             * of its color is less than one.  Turning this on sets the number
+             * of transparency layers to zero.
+             */
+            void set_weighted_transparency(bool enabled);
+            /** @brief Set the format and number of samples of every buffer
+             * that the scene draws into.
+             *
+             * By default, scenes draw into @ref FramebufferFormat::RGBA32F
+             * buffers with four samples per pixel, which is far more precision
+             * than the final 8-bit video needs.  Smaller formats use less
+             * memory and make resolving and reading back each frame faster,
+             * which matters most at high resolutions.  This applies to the
+             * main buffer, the downsampled buffer, and every transparency
+             * layer.  The buffers used for weighted transparency always use
+             * 16-bit floats, but they use the same number of samples.
+             *
+             * If there is only one sample per pixel, the edges of objects are
+             * smoothed with FXAA instead of multisampling.  This is much
+             * cheaper, but thin lines and small text won't look as good.
+             * Previews always use one sample per pixel.
+             *
+             * @param format The format of the color buffers.
+             * @param samples The number of samples per pixel.
+             *
+             * @throws std::invalid_argument If the number of samples is less
+             * than one or more than the OpenGL implementation supports.
+             */
+            void set_framebuffer_format(
+                FramebufferFormat format,
+                int samples = 4
+            );
+            /** @brief Get the format of the scene's color buffers */
+            FramebufferFormat get_framebuffer_format() const
+                {return M_framebuffer_format;}
+            /** @brief Get the number of samples per pixel the scene draws */
+            int get_samples() const {return M_samples;}
+            /** @brief Set whether to skip drawing frames that would look
+             * exactly the same as the previous one.
+             *
+             * Scenes often spend a lot of time holding still, where every
+             * frame is the same.  When this is enabled, the scene keeps track
+             * of whether anything that could affect what it looks like has
+             * changed since the last frame it drew (see @ref
+             * Transformable::get_change_version).  If nothing has, the frame
+             * isn't drawn, and the subclass is told to reuse the previous
+             * one, which for @ref Scene means that the previous frame is sent
+             * to the video again without reading it back from the GPU.
+             *
+             * This is disabled by default because objects that change how
+             * they're drawn without going through ganim's functions need to
+             * call @ref Transformable::mark_changed themselves.
+             */
+            void set_frame_caching(bool enabled);
+            /** @brief Set whether to only redraw the part of each frame that
+             * changed.
+             *
+             * When only a few small objects change, most of the frame is the
+             * same as the one before it.  With this enabled, the scene finds
+             * the rectangle on the screen covering where every changed object
+             * was in the previous frame and where it is now, and only that
+             * rectangle is drawn again.  @ref Scene then only reads back the
+             * rows of the frame in that rectangle.  The whole frame is still
+             * drawn when the camera moves, when objects are added or removed,
+             * or when the rectangle would cover more than half of the screen.
+             *
+             * This relies on the same change tracking as @ref
+             * set_frame_caching, so enabling this enables frame caching as
+             * well.
+             */
+            void set_partial_redraws(bool enabled);
+            /** @brief Get the number of frames that reused the previous frame
+             * instead of being drawn.
+             *
+             * See @ref set_frame_caching.
+             */
+            int get_repeated_frame_count() const {return M_repeated_frames;}
 
 
             /** @brief Set an image to be drawn in the background of the scene
              */
             void set_background_image(const std::string& filename);
+            /** @brief Start recording how long each stage of every frame
+             * takes.
+             *
+             * This records the CPU time spent on updating, cleaning up,
+             * sorting, each drawing pass, and whatever the subclass does with
+             * the frame, along with the GPU time spent on each drawing pass
+             * and the number of draw calls and state changes.  When the scene
+             * is destroyed, a summary is printed to standard error.  See @ref
+             * Profiler for more details.
+             *
+             * Profiling can also be enabled without changing any code by
+             * setting the environment variable `GANIM_PROFILE`.  If it is set
+             * to anything other than "1", it is used as the trace filename.
+             * Workers started by @ref render_chunked put their index before
+             * the extension, so worker 2 writes "trace.json" to
+             * "trace.worker2.json".
+             *
+             * @param trace_filename If this isn't empty, a Chrome trace of
+             * every frame is written to this file when the scene is destroyed.
+             */
+            void enable_profiling(std::string trace_filename = "");
+            /** @brief Get the profiler, or null if profiling isn't enabled.
+             *
+             * You can use this to record your own stages with @ref
+             * Profiler::Scope.
+             */
+            Profiler* get_profiler() {return M_profiler.get();}
             /** @brief Add an object to a scene
              *
              * Note that unlike in manim, this does not make the object visible!
@@ -160,13 +339,45 @@ namespace ganim {
             unsigned get_framebuffer_texture() const
                 {return M_downsampled_framebuffer_texture;}
 
-            auto begin() {return M_objects.begin();}
-            auto end() {return M_objects.end();}
-            auto begin() const {return M_objects.begin();}
-            auto end() const {return M_objects.end();}
-            auto cbegin() const {return M_objects.cbegin();}
-            auto cend() const {return M_objects.cend();}
-            int size() const {return static_cast<int>(M_objects.size());}
+            auto begin() const {return M_registry->get_objects().begin();}
+            auto end() const {return M_registry->get_objects().end();}
+            auto cbegin() const {return M_registry->get_objects().cbegin();}
+            auto cend() const {return M_registry->get_objects().cend();}
+            int size() const
+                {return static_cast<int>(M_registry->get_objects().size());}
+
+        protected:
+            /** @brief Only draw the frames in part of the scene.
+             *
+             * This is like calling @ref stop_animating and @ref
+             * start_animating at the edges of the window, except that it
+             * doesn't need any changes to the code that makes the scene.
+             * Times are measured using this scene's framerate.  Both of these
+             * apply, so frames inside of the window still aren't drawn while
+             * the scene isn't animating.
+             *
+             * This is protected because a subclass might need to know the
+             * window before the scene starts, like @ref Scene does to name
+             * and number its output, so subclasses decide when it can be
+             * changed.  @ref Scene only takes it in its constructor.
+             *
+             * @param window The frames to draw, or nothing to draw every
+             * frame.
+             *
+             * @throws std::invalid_argument If the window starts before the
+             * start of the scene or ends before it starts.
+             */
+            void set_render_window(std::optional<RenderWindow> window);
+            /** @brief Change the framerate of the scene and everything in it.
+             *
+             * This is protected for the same reason as @ref
+             * set_render_window.  It is used by scenes inside of other scenes
+             * (see @ref SceneObject), which have to run at the same framerate
+             * as the scene that they're in.
+             *
+             * @throws std::invalid_argument If the fps isn't positive.
+             */
+            void set_fps(int fps);
 
         private:
             /** @brief Used for subclasses to process the frames.
@@ -175,12 +386,56 @@ namespace ganim {
              * active.
              */
             virtual void process_frame()=0;
+            /** @brief Used for subclasses to skip drawing some frames.
+             *
+             * Frames for which this returns false are updated like normal but
+             * aren't drawn, the same as when using @ref stop_animating.  By
+             * default every frame is drawn.
+             */
+            virtual bool draws_frame(int frame) const;
+            /** @brief Used for subclasses to process a frame that is exactly
+             * the same as the previous one.
+             *
+             * This is only called when frame caching is enabled (see @ref
+             * set_frame_caching).  When it is called, the scene's framebuffer
+             * will be active, and it will still have the previous frame in
+             * it.  By default, this calls @ref process_frame.
+             */
+            virtual void repeat_frame();
+            /** @brief Used for subclasses to process a frame where only some
+             * rows changed.
+             *
+             * This is only called when partial redraws are enabled (see @ref
+             * set_partial_redraws).  Every row outside of the given ones is
+             * the same as in the previous frame.  When this is called, the
+             * scene's framebuffer will be active.  By default, this calls
+             * @ref process_frame.
+             *
+             * @param y The first row that changed, counting from the bottom.
+             * @param height The number of rows that changed.
+             */
+            virtual void process_partial_frame(int y, int height);
+            bool frame_unchanged() const;
+
+            // A rectangle of pixels, not including the upper bounds
+            struct PixelRect {
+                int x1 = 0;
+                int y1 = 0;
+                int x2 = 0;
+                int y2 = 0;
+                bool empty() const {return x1 >= x2 or y1 >= y2;}
+                long area() const
+                    {return empty() ? 0 : long(x2 - x1) * (y2 - y1);}
+                PixelRect united(const PixelRect& other) const;
+            };
+            PixelRect get_pixel_rect(const Object& object) const;
+            std::optional<PixelRect> find_damage();
+            void update_object_rects();
             void draw_objects();
+            void update_draw_list();
+            void draw_weighted_transparency(std::span<Object* const> objects);
+            void draw_fxaa();
 
-            void add_animatable_base(ObjectPtr<Animatable> object);
-            void add_object_base(ObjectPtr<Object> object);
-            void add_group_base(ObjectPtr<Group> object, bool together);
-            void add_group_subobjects(ObjectPtr<Group>& object, bool together);
             void add_animatable(ObjectPtr<Animatable> object);
             void add_object(ObjectPtr<Object> object);
             void add_group(ObjectPtr<Group> object);
@@ -191,19 +446,41 @@ namespace ganim {
             gl::Texture M_framebuffer_texture;
             gl::Texture M_downsampled_framebuffer_texture;
             gl::Texture M_depth_buffer;
+            FramebufferFormat M_framebuffer_format = FramebufferFormat::RGBA32F;
+            int M_samples = 4;
             int M_pixel_width = 0;
             int M_pixel_height = 0;
             int M_fps;
             int M_frame_count = 0;
+            int M_output_frame_count = 0;
+            bool M_preview = false;
             Color M_background_color;
             ObjectPtr<Camera> M_camera;
             Camera M_static_camera;
-            std::vector<ObjectPtr<Animatable>> M_animatables;
-            std::vector<ObjectPtr<Object>> M_objects;
-            std::vector<std::pair<ObjectPtr<Group>, bool>> M_groups;
+            // This is a pointer because groups hold pointers to it
+            std::unique_ptr<ObjectRegistry> M_registry;
+            // The drawn objects sorted by depth z, with the ones that are
+            // fixed in frame at the end.  This is only sorted again when
+            // something that affects the order changes.
+            std::vector<Object*> M_draw_list;
+            std::size_t M_fixed_draw_list_begin = 0;
+            std::uint64_t M_draw_list_objects_version = 0;
+            std::uint64_t M_draw_list_order_version = 0;
+            bool M_draw_list_valid = false;
+            std::unique_ptr<Profiler> M_profiler;
+            // What the last frame that was drawn depended on
+            std::uint64_t M_cached_change_version = 0;
+            std::uint64_t M_cached_objects_version = 0;
+            int M_repeated_frames = 0;
+            bool M_frame_caching = false;
+            bool M_frame_cache_valid = false;
+            bool M_partial_redraws = false;
+            // Where each drawn object was in the last frame that was drawn
+            std::unordered_map<const Object*, PixelRect> M_object_rects;
             std::unique_ptr<Object> M_background_object;
             gl::Texture M_background_texture = 0;
             bool M_animating = true;
+            std::optional<RenderWindow> M_render_window;
 
             struct DepthLayer {
                 gl::Framebuffer framebuffer;
@@ -214,6 +491,32 @@ namespace ganim {
                 gl::Buffer element_buffer;
             };
             std::vector<DepthLayer> M_depth_layers;
+            void allocate_framebuffers();
+            void allocate_depth_layer(DepthLayer& layer);
+
+            struct WeightedTransparencyBuffers {
+                gl::Framebuffer framebuffer;
+                gl::Texture accumulation;
+                gl::Texture revealage;
+                gl::VertexArray vertex_array;
+                gl::Buffer vertex_buffer;
+                gl::Buffer element_buffer;
+            };
+            std::unique_ptr<WeightedTransparencyBuffers>
+                M_weighted_transparency;
+            void allocate_weighted_transparency();
+
+            // Only used when there is one sample per pixel.  The frame is
+            // resolved into this, and then FXAA is used to draw it into the
+            // downsampled framebuffer.
+            struct FXAABuffers {
+                gl::Framebuffer framebuffer;
+                gl::Texture texture;
+                gl::VertexArray vertex_array;
+                gl::Buffer vertex_buffer;
+                gl::Buffer element_buffer;
+            };
+            std::unique_ptr<FXAABuffers> M_fxaa;
     };
 }
 
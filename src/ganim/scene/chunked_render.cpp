@@ -0,0 +1,184 @@
+#include "chunked_render.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+using namespace ganim;
+
+namespace {
+    const auto chunk_directory = std::filesystem::path("ganim_files/chunks");
+
+    std::filesystem::path manifest_filename(int worker)
+    {
+        return chunk_directory / std::format("worker_{}.txt", worker);
+    }
+
+    std::optional<int> get_int_env(const char* name)
+    {
+        auto value = std::getenv(name);
+        if (!value) return std::nullopt;
+        return std::stoi(value);
+    }
+}
+
+std::optional<ChunkAssignment> ganim::get_chunk_assignment()
+{
+    auto worker = get_int_env("GANIM_RENDER_WORKER");
+    if (!worker) return std::nullopt;
+    auto result = ChunkAssignment();
+    result.worker = *worker;
+    result.workers = get_int_env("GANIM_RENDER_WORKERS").value_or(1);
+    result.chunk_frames
+        = get_int_env("GANIM_RENDER_CHUNK_FRAMES").value_or(1);
+    return result;
+}
+
+std::string ganim::get_chunk_filename(const std::string& output, int chunk)
+{
+    auto path = std::filesystem::path(output);
+    auto name = path.stem().string();
+    std::ranges::replace_if(name, [](char c) {
+        return !std::isalnum(static_cast<unsigned char>(c)) and
+               c != '-' and c != '_';
+    }, '_');
+    // Outputs with the same name in different directories need different
+    // chunk files.  Every worker is the same program, so they all agree on
+    // the hash.
+    auto full_path = std::filesystem::absolute(path).lexically_normal();
+    auto hash = std::hash<std::string>()(full_path.string());
+    auto filename = std::format(
+        "{}.{:016x}.{}{}", name, hash, chunk, path.extension().string());
+    return (chunk_directory / filename).string();
+}
+
+void ganim::record_finished_chunk(
+    const ChunkAssignment& assignment,
+    const std::string& output,
+    int chunk,
+    int fps,
+    int start_frame
+)
+{
+    auto file = std::ofstream(
+        manifest_filename(assignment.worker), std::ios::app);
+    file << chunk << '\t' << fps << '\t' << start_frame << '\t' << output
+         << '\n';
+    if (!file) {
+        throw std::runtime_error(std::format(
+            "Unable to record chunk {} of {}", chunk, output));
+    }
+}
+
+std::map<std::string, ChunkedOutput> ganim::read_finished_chunks(
+    int workers
+)
+{
+    auto result = std::map<std::string, ChunkedOutput>();
+    for (int i = 0; i < workers; ++i) {
+        auto file = std::ifstream(manifest_filename(i));
+        auto chunk = 0;
+        auto fps = 0;
+        auto start_frame = 0;
+        auto filename = std::string();
+        while (file >> chunk >> fps >> start_frame) {
+            file.ignore();
+            std::getline(file, filename);
+            auto& output = result[filename];
+            output.fps = fps;
+            output.segments.emplace_back(
+                get_chunk_filename(filename, chunk), start_frame);
+        }
+    }
+    for (auto& [filename, output] : result) {
+        std::ranges::sort(output.segments, {}, &VideoSegment::start_frame);
+    }
+    return result;
+}
+
+bool ganim::render_chunked(
+    int argc,
+    char* argv[],
+    ChunkedRenderOptions options
+)
+{
+    if (get_chunk_assignment()) return false;
+    if (argc < 1) {
+        throw std::invalid_argument("No arguments passed to render_chunked");
+    }
+    if (options.chunk_frames < 1) {
+        throw std::invalid_argument(
+            "The chunk size passed to render_chunked must be positive");
+    }
+    auto workers = options.workers;
+    if (workers <= 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::filesystem::create_directories(chunk_directory);
+    for (int i = 0; i < workers; ++i) {
+        std::filesystem::remove(manifest_filename(i));
+    }
+
+    auto base_environment = std::vector<std::string>();
+    for (auto env = environ; *env; ++env) {
+        base_environment.emplace_back(*env);
+    }
+    auto pids = std::vector<pid_t>();
+    for (int i = 0; i < workers; ++i) {
+        auto environment = base_environment;
+        environment.push_back(std::format("GANIM_RENDER_WORKER={}", i));
+        environment.push_back(
+                std::format("GANIM_RENDER_WORKERS={}", workers));
+        environment.push_back(std::format(
+            "GANIM_RENDER_CHUNK_FRAMES={}", options.chunk_frames));
+        auto envp = std::vector<char*>();
+        for (auto& env : environment) envp.push_back(env.data());
+        envp.push_back(nullptr);
+        // The worker has to be a brand new process rather than just a fork so
+        // that it can get its own OpenGL context.
+        auto pid = pid_t();
+        auto error = posix_spawn(
+            &pid, "/proc/self/exe", nullptr, nullptr, argv, envp.data());
+        if (error) {
+            for (auto p : pids) waitpid(p, nullptr, 0);
+            throw std::runtime_error(std::format(
+                "Unable to start render worker {}", i));
+        }
+        pids.push_back(pid);
+    }
+    auto failed = 0;
+    for (auto pid : pids) {
+        auto status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) or WEXITSTATUS(status) != 0) ++failed;
+    }
+    if (failed) {
+        throw std::runtime_error(std::format(
+            "{} of {} render workers failed", failed, workers));
+    }
+
+    auto outputs = read_finished_chunks(workers);
+    for (int i = 0; i < workers; ++i) {
+        std::filesystem::remove(manifest_filename(i));
+    }
+    for (auto& [filename, output] : outputs) {
+        concatenate_videos(output.segments, filename, output.fps);
+        for (auto& segment : output.segments) {
+            std::filesystem::remove(segment.filename);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,147 @@
+#ifndef GANIM_SCENE_CHUNKED_RENDER_HPP
+#define GANIM_SCENE_CHUNKED_RENDER_HPP
+
+/** @file
+ * @brief Functions for rendering scenes in parallel in several processes.
+ */
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ganim/video_writer/concatenate.hpp"
+
+namespace ganim {
+    /** @brief Settings for @ref render_chunked. */
+    struct ChunkedRenderOptions {
+        /** @brief The number of worker processes to use.  If this is zero,
+         * one worker is used for every core.
+         */
+        int workers = 0;
+        /** @brief The number of frames in each chunk. */
+        int chunk_frames = 600;
+    };
+
+    /** @brief Render every scene in this program across several worker
+     * processes.
+     *
+     * The timeline of each @ref Scene is split into chunks of frames, and the
+     * chunks are dealt out to the workers in turn.  Each worker is a fresh copy
+     * of this program with its own OpenGL context.  It runs all of the scene
+     * logic, but it only draws and encodes the frames in its own chunks,
+     * skipping the rest the same way that @ref SceneBase::stop_animating does.
+     * Each chunk is written to its own file in `ganim_files/chunks/`, and once
+     * every worker is done the chunks are joined into the real output files
+     * without being re-encoded.
+     *
+     * To use it, call this at the very start of `main`, and return right away
+     * if it returns true:
+     *
+     * ```cpp
+     * int main(int argc, char* argv[])
+     * {
+     *     if (ganim::render_chunked(argc, argv)) return 0;
+     *     // Make and render the scenes like normal
+     * }
+     * ```
+     *
+     * Because every worker runs the whole program, the program must do the
+     * same thing every time it is run.  In particular, it can't read anything
+     * from standard input.
+     *
+     * @param argc The `argc` passed to `main`.
+     * @param argv The `argv` passed to `main`.
+     * @param options The settings for splitting up the render.
+     * @return True in the original process, once all of the output files have
+     * been written.  False in a worker process, which should then render its
+     * scenes like normal.
+     * @throw std::runtime_error If a worker fails or the chunks can't be
+     * joined.
+     */
+    bool render_chunked(
+        int argc,
+        char* argv[],
+        ChunkedRenderOptions options = {}
+    );
+
+    /** @brief Which chunks this process is rendering, if it is a worker
+     * started by @ref render_chunked.
+     */
+    struct ChunkAssignment {
+        /** @brief The index of this worker. */
+        int worker = 0;
+        /** @brief The total number of workers. */
+        int workers = 1;
+        /** @brief The number of frames in each chunk. */
+        int chunk_frames = 1;
+
+        /** @brief Get the chunk that a frame is in. */
+        constexpr int chunk_of(int frame) const
+            {return frame / chunk_frames;}
+        /** @brief Whether this worker renders the chunk a frame is in. */
+        constexpr bool owns_frame(int frame) const
+            {return chunk_of(frame) % workers == worker;}
+    };
+
+    /** @brief Get what chunks this process should render.
+     *
+     * @return The chunk assignment if this process is a worker started by
+     * @ref render_chunked, and nothing otherwise.
+     */
+    std::optional<ChunkAssignment> get_chunk_assignment();
+
+    /** @brief Get the filename that a chunk of an output file is written to
+     * by a worker.
+     *
+     * The filename includes a hash of the full path of the output, so
+     * outputs with the same name in different directories don't share chunk
+     * files.
+     */
+    std::string get_chunk_filename(const std::string& output, int chunk);
+
+    /** @brief Tell the original process that a worker finished a chunk.
+     *
+     * This is used by @ref Scene, so you shouldn't need to call it yourself.
+     *
+     * @param assignment The chunks this worker is rendering.
+     * @param output The file that the chunk is part of.
+     * @param chunk The index of the chunk.
+     * @param fps The framerate of the chunk.
+     * @param start_frame The frame in the output file that the chunk starts
+     * on.  This is different from where the chunk starts in the scene when
+     * frames before it weren't written, either because of @ref
+     * SceneBase::stop_animating or because the scene has a @ref
+     * RenderWindow.  See @ref SceneBase::get_output_frame_count.
+     */
+    void record_finished_chunk(
+        const ChunkAssignment& assignment,
+        const std::string& output,
+        int chunk,
+        int fps,
+        int start_frame
+    );
+
+    /** @brief The chunks of one output file that the workers finished. */
+    struct ChunkedOutput {
+        /** @brief The framerate of the output. */
+        int fps = 0;
+        /** @brief The file of each chunk, sorted by where it starts in the
+         * output.
+         */
+        std::vector<VideoSegment> segments;
+    };
+
+    /** @brief Read every chunk that was recorded with @ref
+     * record_finished_chunk.
+     *
+     * This is used by @ref render_chunked once the workers are done, so you
+     * shouldn't need to call it yourself.
+     *
+     * @param workers The number of workers.
+     * @return The chunks of each output file, keyed by its filename.
+     */
+    std::map<std::string, ChunkedOutput> read_finished_chunks(int workers);
+}
+
+#endif
@@ -0,0 +1,132 @@
+#include "object_registry.hpp"
+
+#include <algorithm>
+
+using namespace ganim;
+
+ObjectRegistry::~ObjectRegistry()
+{
+    for (auto& [object, entry] : M_entries) {
+        if (entry.group) entry.group->remove_observer(*this);
+    }
+}
+
+void ObjectRegistry::add_animatable(ObjectPtr<Animatable> object)
+{
+    add(std::move(object), false, false);
+}
+
+void ObjectRegistry::add_object(ObjectPtr<Object> object)
+{
+    add(std::move(object), true, false);
+}
+
+void ObjectRegistry::set_fps(int fps)
+{
+    M_fps = fps;
+    for (auto& object : M_animatables) object->set_fps(fps);
+}
+
+void ObjectRegistry::add(
+    ObjectPtr<Animatable> object,
+    bool drawn,
+    bool together
+)
+{
+    auto [it, inserted] = M_entries.try_emplace(object.get());
+    auto& entry = it->second;
+    if (inserted) {
+        object->set_fps(M_fps);
+        M_animatables.push_back(object);
+        M_animatable_entries.push_back(&entry);
+        if (drawn and !together) {
+            entry.drawn = true;
+            entry.object_index = M_objects.size();
+            M_objects.push_back(object.dynamic_pointer_cast<Object>());
+            ++M_objects_version;
+        }
+    }
+    if (entry.group) return;
+    auto group = dynamic_cast<Group*>(object.get());
+    if (!group) return;
+    entry.group = group;
+    entry.together = together;
+    group->add_observer(*this);
+    together |= group->drawing_together();
+    for (auto& subobject : *group) {
+        add(subobject, true, together);
+    }
+}
+
+void ObjectRegistry::subobject_added(
+    Group& group,
+    const ObjectPtr<Object>& object
+)
+{
+    M_pending.emplace_back(&group, object);
+}
+
+void ObjectRegistry::subobject_removed(Group& group, Object& object)
+{
+    auto it = std::ranges::find_if(M_pending, [&](auto& pending) {
+        return pending.first == &group and pending.second.get() == &object;
+    });
+    if (it != M_pending.end()) M_pending.erase(it);
+}
+
+void ObjectRegistry::clean_up()
+{
+    auto pending = std::move(M_pending);
+    M_pending.clear();
+    for (auto& [group, object] : pending) {
+        // The group might have been forgotten about since this was added
+        auto it = M_entries.find(group);
+        if (it == M_entries.end()) continue;
+        auto together = it->second.together or group->drawing_together();
+        add(std::move(object), true, together);
+    }
+    pending.clear();
+    while (sweep()) {}
+}
+
+bool ObjectRegistry::sweep()
+{
+    bool removed = false;
+    for (std::size_t i = 0; i < M_animatables.size(); ++i) {
+        auto& object = M_animatables[i];
+        auto& entry = *M_animatable_entries[i];
+        // The only references left are the ones in this registry
+        if (object.use_count() != 1 + entry.drawn) continue;
+        if (entry.drawn) {
+            M_objects[entry.object_index].reset();
+            ++M_objects_version;
+        }
+        if (entry.group) entry.group->remove_observer(*this);
+        M_entries.erase(object.get());
+        // This can destroy other objects, so it needs to happen last.  Any
+        // of their subobjects later in the list will be found in this same
+        // pass.
+        object.reset();
+        removed = true;
+    }
+    if (!removed) return false;
+
+    auto live = std::size_t(0);
+    for (std::size_t i = 0; i < M_animatables.size(); ++i) {
+        if (!M_animatables[i].get()) continue;
+        if (live != i) {
+            M_animatables[live] = std::move(M_animatables[i]);
+            M_animatable_entries[live] = M_animatable_entries[i];
+        }
+        ++live;
+    }
+    M_animatables.erase(M_animatables.begin() + live, M_animatables.end());
+    M_animatable_entries.resize(live);
+    std::erase_if(M_objects, [](auto& obj) {return !obj.get();});
+    for (std::size_t i = 0; i < M_objects.size(); ++i) {
+        M_entries.at(M_objects[i].get()).object_index = i;
+    }
+    // Destroying an object can drop the last reference to something that
+    // was checked earlier in the pass
+    return true;
+}
@@ -0,0 +1,106 @@
+#ifndef GANIM_SCENE_OBJECT_REGISTRY_HPP
+#define GANIM_SCENE_OBJECT_REGISTRY_HPP
+
+/** @file
+ * @brief The @ref ganim::ObjectRegistry "ObjectRegistry" class
+ */
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "ganim/object/bases/group.hpp"
+
+namespace ganim {
+    /** @brief Keeps track of which objects are in a scene.
+     *
+     * This is the bookkeeping part of @ref SceneBase.  It remembers every
+     * animatable that was added, along with which of them should be drawn,
+     * and it watches every group that was added so that objects added to the
+     * group later are added as well.
+     *
+     * Scenes don't keep objects alive, so @ref clean_up drops every object
+     * that nobody else is referencing anymore.  This is a single pass over
+     * the objects that only looks at reference counts, and everything else
+     * that it does only depends on the number of objects that were added or
+     * removed since the last time it was called.
+     *
+     * Because groups hold pointers to the registry, it can't be copied or
+     * moved.
+     */
+    class ObjectRegistry : private GroupObserver {
+        public:
+            /** @brief Constructor
+             *
+             * @param fps The fps that every added object will be set to.
+             */
+            explicit ObjectRegistry(int fps) : M_fps(fps) {}
+            ObjectRegistry(const ObjectRegistry&)=delete;
+            ObjectRegistry& operator=(const ObjectRegistry&)=delete;
+            ~ObjectRegistry();
+
+            /** @brief Add something that is updated but never drawn.
+             *
+             * If it's a group, its subobjects will still be drawn.
+             */
+            void add_animatable(ObjectPtr<Animatable> object);
+            /** @brief Add an object that is both updated and drawn */
+            void add_object(ObjectPtr<Object> object);
+            /** @brief Add any objects that were added to groups since the last
+             * call, and forget about everything that isn't referenced
+             * anywhere else.
+             */
+            void clean_up();
+            /** @brief Change the fps of every object, including ones that are
+             * added later.
+             */
+            void set_fps(int fps);
+
+            /** @brief Get everything that should be updated, in the order
+             * they were added.
+             */
+            const std::vector<ObjectPtr<Animatable>>& get_animatables() const
+                {return M_animatables;}
+            /** @brief Get everything that should be drawn, in the order they
+             * were added.
+             */
+            const std::vector<ObjectPtr<Object>>& get_objects() const
+                {return M_objects;}
+            /** @brief Get a number that changes whenever the objects that
+             * should be drawn change.
+             */
+            std::uint64_t get_objects_version() const
+                {return M_objects_version;}
+
+        private:
+            struct Entry {
+                // Only meaningful when drawn is true
+                std::size_t object_index = 0;
+                Group* group = nullptr;
+                bool drawn = false;
+                // Whether this is inside a group that draws its subobjects
+                // itself
+                bool together = false;
+            };
+
+            void add(ObjectPtr<Animatable> object, bool drawn, bool together);
+            bool sweep();
+            virtual void subobject_added(
+                Group& group,
+                const ObjectPtr<Object>& object
+            ) override;
+            virtual void subobject_removed(Group& group, Object& object)
+                override;
+
+            std::unordered_map<const Animatable*, Entry> M_entries;
+            std::vector<ObjectPtr<Animatable>> M_animatables;
+            // Parallel to M_animatables so that sweeping doesn't need to hash
+            std::vector<Entry*> M_animatable_entries;
+            std::vector<ObjectPtr<Object>> M_objects;
+            std::vector<std::pair<Group*, ObjectPtr<Object>>> M_pending;
+            std::uint64_t M_objects_version = 0;
+            int M_fps;
+    };
+}
+
+#endif
@@ -0,0 +1,65 @@
+#include "preview.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <format>
+#include <stdexcept>
+#include <string>
+
+using namespace ganim;
+
+int PreviewOptions::scale_pixels(int pixels) const
+{
+    if (!(resolution_scale > 0)) {
+        throw std::invalid_argument(std::format(
+            "Invalid preview resolution scale {}.  It must be positive.",
+            resolution_scale
+        ));
+    }
+    auto half = static_cast<int>(std::round(pixels * resolution_scale / 2));
+    return std::max(half, 1) * 2;
+}
+
+int PreviewOptions::scale_fps(int fps) const
+{
+    if (fps_divisor < 1) {
+        throw std::invalid_argument(std::format(
+            "Invalid preview fps divisor {}.  It must be positive.",
+            fps_divisor
+        ));
+    }
+    auto divisor = fps_divisor;
+    while (fps % divisor != 0) --divisor;
+    return fps / divisor;
+}
+
+std::optional<PreviewOptions> ganim::get_preview_options()
+{
+    auto env = std::getenv("GANIM_PREVIEW");
+    if (!env) return std::nullopt;
+    auto value = std::string(env);
+    auto result = PreviewOptions();
+    if (value == "1") return result;
+    try {
+        auto comma = value.find(',');
+        auto pos = std::size_t(0);
+        result.resolution_scale = std::stod(value.substr(0, comma), &pos);
+        if (pos != comma and pos != value.size()) {
+            throw std::invalid_argument("");
+        }
+        if (comma != std::string::npos) {
+            auto divisor = value.substr(comma + 1);
+            result.fps_divisor = std::stoi(divisor, &pos);
+            if (pos != divisor.size()) throw std::invalid_argument("");
+        }
+    }
+    catch (const std::logic_error&) {
+        throw std::runtime_error(std::format(
+            "Unable to parse GANIM_PREVIEW value \"{}\".  It should be \"1\" "
+            "or a resolution scale optionally followed by a comma and an fps "
+            "divisor.", value
+        ));
+    }
+    return result;
+}
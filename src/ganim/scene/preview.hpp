@@ -0,0 +1,65 @@
+#ifndef GANIM_SCENE_PREVIEW_HPP
+#define GANIM_SCENE_PREVIEW_HPP
+
+/** @file
+ * @brief Settings for rendering quick previews of scenes.
+ */
+
+#include <optional>
+
+namespace ganim {
+    /** @brief Settings for rendering a quick, low quality version of a scene.
+     *
+     * A preview draws the same thing as the real scene, just with fewer pixels
+     * and fewer frames.  The coordinate size of the scene doesn't change, so
+     * everything ends up in the same place relative to the frame.  The scene
+     * runs at a lower frame rate, and every object added to it is told the
+     * lower frame rate through @ref Animatable::set_fps, so animations and
+     * @ref SceneBase::wait take the same amount of time as they normally
+     * would.  Code that counts frames itself, such as calls to @ref
+     * SceneBase::frame_advance with a number of frames, will run faster.
+     *
+     * Previews also turn off multisampling and depth peeling, and videos are
+     * encoded with the fastest preset.
+     */
+    struct PreviewOptions {
+        /** @brief What to multiply the width and height in pixels by. */
+        double resolution_scale = 0.5;
+        /** @brief What to divide the frame rate by.
+         *
+         * If this doesn't divide the frame rate evenly, the largest number
+         * below it that does is used instead, so that every animation still
+         * takes a whole number of frames.
+         */
+        int fps_divisor = 2;
+
+        /** @brief Get the size in pixels of one side of a preview.
+         *
+         * This is rounded to an even number because most video pixel
+         * formats need it.
+         *
+         * @throws std::invalid_argument If the resolution scale isn't
+         * positive.
+         */
+        int scale_pixels(int pixels) const;
+        /** @brief Get the frame rate of a preview.
+         *
+         * @throws std::invalid_argument If the fps divisor isn't positive.
+         */
+        int scale_fps(int fps) const;
+    };
+
+    /** @brief Get the preview settings from the environment.
+     *
+     * Previews are enabled by setting the environment variable
+     * `GANIM_PREVIEW`.  If it's "1", the default settings are used.
+     * Otherwise, it's the resolution scale, optionally followed by a comma
+     * and the fps divisor, like "0.25,4".
+     *
+     * @return The settings, or nothing if `GANIM_PREVIEW` isn't set.
+     * @throws std::runtime_error If `GANIM_PREVIEW` can't be parsed.
+     */
+    std::optional<PreviewOptions> get_preview_options();
+}
+
+#endif
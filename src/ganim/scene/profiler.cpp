@@ -0,0 +1,210 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "ganim/gl/gl.hpp"
+#include "ganim/gl/context.hpp"
+
+using namespace ganim;
+
+namespace {
+    std::string escape_json(std::string_view str)
+    {
+        auto result = std::string();
+        for (auto c : str) {
+            if (c == '"' or c == '\\') result += '\\';
+            result += c;
+        }
+        return result;
+    }
+
+    std::string stats_json(const gl::Stats& stats)
+    {
+        return std::format(
+            R"("draw_calls":{},"program_changes":{},"framebuffer_changes":{})",
+            stats.draw_calls, stats.program_changes,
+            stats.framebuffer_changes
+        );
+    }
+}
+
+Profiler::Scope::Scope(Profiler* profiler, std::string_view name, bool gpu)
+:   M_profiler(profiler)
+{
+    if (M_profiler) M_event = M_profiler->begin_event(name, gpu);
+}
+
+Profiler::Scope::~Scope()
+{
+    if (M_profiler) M_profiler->end_event(M_event);
+}
+
+Profiler::Profiler(std::string trace_filename)
+:   M_trace_filename(std::move(trace_filename)),
+    M_start(std::chrono::steady_clock::now())
+{
+    gl::ensure_context();
+}
+
+Profiler::~Profiler()
+{
+    try {
+        if (!M_trace_filename.empty()) write_trace(M_trace_filename);
+        std::cerr << summary();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Unable to write profile: " << e.what() << "\n";
+    }
+    collect_gpu_times(true);
+}
+
+void Profiler::begin_frame(int frame)
+{
+    M_frame = frame;
+    collect_gpu_times(false);
+}
+
+double Profiler::now() const
+{
+    return std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - M_start).count();
+}
+
+std::size_t Profiler::begin_event(std::string_view name, bool gpu)
+{
+    auto& event = M_events.emplace_back();
+    event.name = name;
+    event.frame = M_frame;
+    event.stats = gl::stats;
+    if (gpu and !M_query_active) {
+        glGenQueries(1, &event.query);
+        glBeginQuery(GL_TIME_ELAPSED, event.query);
+        M_query_active = true;
+    }
+    // Take the time last so that the setup above isn't counted
+    event.start = now();
+    return M_events.size() - 1;
+}
+
+void Profiler::end_event(std::size_t index)
+{
+    auto& event = M_events[index];
+    event.cpu_time = now() - event.start;
+    event.stats = gl::stats - event.stats;
+    if (event.query) {
+        glEndQuery(GL_TIME_ELAPSED);
+        M_query_active = false;
+        M_pending_queries.push_back(index);
+    }
+}
+
+void Profiler::collect_gpu_times(bool wait)
+{
+    std::erase_if(M_pending_queries, [&](std::size_t index) {
+        auto& event = M_events[index];
+        if (!wait) {
+            auto available = GLuint(0);
+            glGetQueryObjectuiv(
+                event.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) return false;
+        }
+        auto nanoseconds = GLuint64(0);
+        glGetQueryObjectui64v(event.query, GL_QUERY_RESULT, &nanoseconds);
+        glDeleteQueries(1, &event.query);
+        event.query = 0;
+        event.gpu_time = nanoseconds / 1000.0;
+        return true;
+    });
+}
+
+std::string Profiler::summary()
+{
+    collect_gpu_times(true);
+    struct Totals {
+        int count = 0;
+        double cpu_time = 0;
+        double cpu_max = 0;
+        int gpu_count = 0;
+        double gpu_time = 0;
+        gl::Stats stats;
+    };
+    // Keep the stages in the order they first happened
+    auto names = std::vector<std::string_view>();
+    auto totals = std::unordered_map<std::string_view, Totals>();
+    for (auto& event : M_events) {
+        auto [it, inserted] = totals.try_emplace(event.name);
+        if (inserted) names.push_back(event.name);
+        auto& total = it->second;
+        ++total.count;
+        total.cpu_time += event.cpu_time;
+        total.cpu_max = std::max(total.cpu_max, event.cpu_time);
+        if (event.gpu_time >= 0) {
+            ++total.gpu_count;
+            total.gpu_time += event.gpu_time;
+        }
+        total.stats.draw_calls += event.stats.draw_calls;
+        total.stats.program_changes += event.stats.program_changes;
+        total.stats.framebuffer_changes += event.stats.framebuffer_changes;
+    }
+
+    auto result = std::format(
+        "{:<20}{:>8}{:>12}{:>12}{:>12}{:>12}{:>10}{:>10}{:>10}\n",
+        "Stage", "Count", "Total ms", "Mean ms", "Max ms", "GPU ms",
+        "Draws", "Programs", "FBOs"
+    );
+    for (auto name : names) {
+        auto& total = totals[name];
+        auto gpu = total.gpu_count
+            ? std::format("{:.3f}", total.gpu_time / total.gpu_count / 1000)
+            : std::string("-");
+        result += std::format(
+            "{:<20}{:>8}{:>12.3f}{:>12.3f}{:>12.3f}{:>12}{:>10.1f}{:>10.1f}"
+            "{:>10.1f}\n",
+            name, total.count, total.cpu_time / 1000,
+            total.cpu_time / total.count / 1000, total.cpu_max / 1000, gpu,
+            static_cast<double>(total.stats.draw_calls) / total.count,
+            static_cast<double>(total.stats.program_changes) / total.count,
+            static_cast<double>(total.stats.framebuffer_changes) / total.count
+        );
+    }
+    return result;
+}
+
+void Profiler::write_trace(const std::string& filename)
+{
+    collect_gpu_times(true);
+    auto file = std::ofstream(filename);
+    file << "{\"traceEvents\":[\n"
+         << R"({"name":"thread_name","ph":"M","pid":1,"tid":1,)"
+         << R"("args":{"name":"CPU"}},)" << "\n"
+         << R"({"name":"thread_name","ph":"M","pid":1,"tid":2,)"
+         << R"("args":{"name":"GPU"}})";
+    for (auto& event : M_events) {
+        auto name = escape_json(event.name);
+        file << std::format(
+            ",\n"
+            R"({{"name":"{}","cat":"cpu","ph":"X","ts":{:.3f},"dur":{:.3f},)"
+            R"("pid":1,"tid":1,"args":{{"frame":{},{}}}}})",
+            name, event.start, event.cpu_time, event.frame,
+            stats_json(event.stats)
+        );
+        if (event.gpu_time >= 0) {
+            file << std::format(
+                ",\n"
+                R"({{"name":"{}","cat":"gpu","ph":"X","ts":{:.3f},)"
+                R"("dur":{:.3f},"pid":1,"tid":2,"args":{{"frame":{}}}}})",
+                name, event.start, event.gpu_time, event.frame
+            );
+        }
+    }
+    file << "],\n\"displayTimeUnit\":\"ms\"}\n";
+    if (!file) {
+        throw std::runtime_error(std::format(
+            "Unable to write profiling trace to {}", filename));
+    }
+}
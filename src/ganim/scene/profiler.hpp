@@ -0,0 +1,116 @@
+#ifndef GANIM_SCENE_PROFILER_HPP
+#define GANIM_SCENE_PROFILER_HPP
+
+/** @file
+ * @brief The @ref ganim::Profiler "Profiler" class
+ */
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ganim/gl/stats.hpp"
+
+namespace ganim {
+    /** @brief Records how long each stage of rendering a scene takes.
+     *
+     * Stages are recorded with @ref Scope objects.  Each one records the CPU
+     * time it was alive for and the number of draw calls and state changes
+     * made during it (see @ref gl::stats).  Scopes can also record how long
+     * the GPU spent on the commands sent during them using `GL_TIME_ELAPSED`
+     * queries.  These queries can't overlap, so if a GPU scope is started
+     * while another one is active, only its CPU time is recorded.
+     *
+     * GPU times are read back lazily, so recording them doesn't make the CPU
+     * wait for the GPU until the profiler is destroyed.
+     *
+     * You usually don't make one of these yourself.  Instead, use @ref
+     * SceneBase::enable_profiling.
+     */
+    class Profiler {
+        public:
+            /** @brief Records one stage for as long as it is alive. */
+            class Scope {
+                public:
+                    /** @brief Start recording a stage.
+                     *
+                     * @param profiler The profiler to record to.  If this is
+                     * null, nothing happens, so you don't need to check if
+                     * profiling is enabled first.
+                     * @param name The name of the stage.
+                     * @param gpu Whether to also record GPU time.
+                     */
+                    Scope(
+                        Profiler* profiler,
+                        std::string_view name,
+                        bool gpu = false
+                    );
+                    ~Scope();
+                    Scope(const Scope&)=delete;
+                    Scope& operator=(const Scope&)=delete;
+
+                private:
+                    Profiler* M_profiler;
+                    std::size_t M_event = 0;
+            };
+
+            /** @brief Constructor
+             *
+             * @param trace_filename The file to write a Chrome trace to when
+             * this is destroyed.  If this is empty, no trace is written.
+             */
+            explicit Profiler(std::string trace_filename = "");
+            Profiler(const Profiler&)=delete;
+            Profiler& operator=(const Profiler&)=delete;
+            /** @brief Writes the trace file and prints @ref summary to
+             * standard error.
+             */
+            ~Profiler();
+
+            /** @brief Set the frame number that new stages belong to.
+             *
+             * This also reads back any GPU times that are ready.
+             */
+            void begin_frame(int frame);
+            /** @brief Get a table of the time spent in each stage.
+             *
+             * This waits for every GPU time to be available.
+             */
+            std::string summary();
+            /** @brief Write everything recorded so far as a Chrome trace.
+             *
+             * The file can be opened in `chrome://tracing` or Perfetto.  The
+             * GPU has no clock that lines up with the CPU's, so GPU stages are
+             * shown starting when their commands were sent.
+             *
+             * @throws std::runtime_error If the file can't be opened.
+             */
+            void write_trace(const std::string& filename);
+
+        private:
+            struct Event {
+                std::string name;
+                int frame = 0;
+                double start = 0;
+                double cpu_time = 0;
+                double gpu_time = -1;
+                unsigned query = 0;
+                gl::Stats stats;
+            };
+
+            std::size_t begin_event(std::string_view name, bool gpu);
+            void end_event(std::size_t index);
+            void collect_gpu_times(bool wait);
+            double now() const;
+
+            std::string M_trace_filename;
+            std::vector<Event> M_events;
+            std::vector<std::size_t> M_pending_queries;
+            std::chrono::steady_clock::time_point M_start;
+            int M_frame = 0;
+            bool M_query_active = false;
+    };
+}
+
+#endif
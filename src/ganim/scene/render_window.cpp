@@ -0,0 +1,110 @@
+#include "render_window.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <stdexcept>
+
+using namespace ganim;
+
+namespace {
+    constexpr auto max_frame = std::numeric_limits<int>::max();
+
+    int to_frame(double value, RenderWindow::Unit unit, int fps)
+    {
+        if (unit == RenderWindow::Unit::Seconds) value *= fps;
+        if (!(value < max_frame)) return max_frame;
+        return static_cast<int>(std::round(value));
+    }
+
+    RenderWindow parse_window(
+        const char* name,
+        const std::string& value,
+        RenderWindow::Unit unit
+    )
+    {
+        auto result = RenderWindow();
+        result.unit = unit;
+        auto parse = [&](const std::string& str, double& out) {
+            if (str.empty()) return;
+            auto pos = std::size_t(0);
+            out = unit == RenderWindow::Unit::Frames
+                ? std::stoi(str, &pos) : std::stod(str, &pos);
+            if (pos != str.size()) throw std::invalid_argument("");
+        };
+        auto colon = value.find(':');
+        try {
+            if (colon == std::string::npos) throw std::invalid_argument("");
+            parse(value.substr(0, colon), result.start);
+            parse(value.substr(colon + 1), result.end);
+        }
+        catch (const std::logic_error&) {
+            throw std::runtime_error(std::format(
+                "Unable to parse {} value \"{}\".  It should be a start and "
+                "an end separated by a colon.", name, value
+            ));
+        }
+        return result;
+    }
+}
+
+RenderWindow RenderWindow::frames(int start, int end)
+{
+    return {double(start), double(end), Unit::Frames};
+}
+
+RenderWindow RenderWindow::seconds(double start, double end)
+{
+    return {start, end, Unit::Seconds};
+}
+
+int RenderWindow::first_frame(int fps) const
+{
+    return to_frame(start, unit, fps);
+}
+
+int RenderWindow::end_frame(int fps) const
+{
+    return to_frame(end, unit, fps);
+}
+
+bool RenderWindow::contains(int frame, int fps) const
+{
+    return frame >= first_frame(fps) and frame < end_frame(fps);
+}
+
+std::optional<RenderWindow> ganim::get_render_window_from_environment()
+{
+    auto frames = std::getenv("GANIM_RENDER_FRAMES");
+    auto time = std::getenv("GANIM_RENDER_TIME");
+    if (frames and time) {
+        throw std::runtime_error(
+            "Only one of GANIM_RENDER_FRAMES and GANIM_RENDER_TIME can be set");
+    }
+    if (frames) {
+        return parse_window(
+            "GANIM_RENDER_FRAMES", frames, RenderWindow::Unit::Frames);
+    }
+    if (time) {
+        return parse_window(
+            "GANIM_RENDER_TIME", time, RenderWindow::Unit::Seconds);
+    }
+    return std::nullopt;
+}
+
+std::string ganim::get_window_filename(
+    const std::string& output,
+    const RenderWindow& window,
+    int fps
+)
+{
+    auto path = std::filesystem::path(output);
+    auto end = window.end_frame(fps);
+    auto filename = std::format(
+        "{}.{}-{}{}", path.stem().string(), window.first_frame(fps),
+        end == max_frame ? std::string("end") : std::to_string(end),
+        path.extension().string()
+    );
+    return (path.parent_path() / filename).string();
+}
@@ -0,0 +1,88 @@
+#ifndef GANIM_SCENE_RENDER_WINDOW_HPP
+#define GANIM_SCENE_RENDER_WINDOW_HPP
+
+/** @file
+ * @brief Settings for only rendering part of a scene.
+ */
+
+#include <limits>
+#include <optional>
+#include <string>
+
+namespace ganim {
+    /** @brief The part of a scene to draw and encode.
+     *
+     * Every frame of the scene still runs, so all objects end up in the same
+     * state they would in a full render, but frames outside of the window are
+     * skipped the same way that @ref SceneBase::stop_animating skips them.
+     * The window includes its start and excludes its end.
+     */
+    struct RenderWindow {
+        /** @brief What the start and end of a window are measured in. */
+        enum class Unit {
+            /** @brief Frame numbers of the scene */
+            Frames,
+            /** @brief Seconds since the start of the scene */
+            Seconds
+        };
+        /** @brief The start of the window. */
+        double start = 0;
+        /** @brief The end of the window.  By default, the window goes until
+         * the end of the scene.
+         */
+        double end = std::numeric_limits<double>::infinity();
+        /** @brief What @ref start and @ref end are measured in. */
+        Unit unit = Unit::Seconds;
+
+        /** @brief Make a window from frame numbers. */
+        static RenderWindow frames(
+            int start,
+            int end = std::numeric_limits<int>::max()
+        );
+        /** @brief Make a window from times in seconds. */
+        static RenderWindow seconds(
+            double start,
+            double end = std::numeric_limits<double>::infinity()
+        );
+
+        /** @brief Get the first frame in the window.
+         *
+         * Times are rounded to the nearest frame, the same way that @ref
+         * SceneBase::wait rounds them.
+         */
+        int first_frame(int fps) const;
+        /** @brief Get the frame after the last one in the window. */
+        int end_frame(int fps) const;
+        /** @brief Get whether a frame is in the window. */
+        bool contains(int frame, int fps) const;
+    };
+
+    /** @brief Get the render window from the environment.
+     *
+     * The window can be given in frames with the environment variable
+     * `GANIM_RENDER_FRAMES` or in seconds with `GANIM_RENDER_TIME`.  Either
+     * one should be the start and end separated by a colon, like "120:240".
+     * Either side can be left empty to go from the start of the scene or to
+     * the end of it.
+     *
+     * @return The window, or nothing if neither variable is set.
+     * @throws std::runtime_error If both variables are set or one of them
+     * can't be parsed.
+     */
+    std::optional<RenderWindow> get_render_window_from_environment();
+
+    /** @brief Get the filename that part of a scene is written to.
+     *
+     * This adds the frames in the window to the filename so that rendering
+     * part of a scene doesn't overwrite a full render of it.  For example,
+     * the frames 120 to 240 of "scene.mp4" are written to
+     * "scene.120-240.mp4".
+     */
+    std::string get_window_filename(
+        const std::string& output,
+        const RenderWindow& window,
+        int fps
+    );
+}
+
+#endif
@@ -1,5 +1,12 @@
 #include "scene.hpp"
 
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <stdexcept>
+
 #include "ganim/gl/gl.hpp"
 #include "ganim/util/stb_image_write.h"
 
@@ -11,26 +18,295 @@ Scene::Scene(
     int pixel_height,
     double coord_width,
     double coord_height,
-    int fps
+    int fps,
+    VideoWriterOptions options,
+    std::optional<PreviewOptions> preview,
+    std::optional<RenderWindow> window
 )
-:   SceneBase(pixel_width, pixel_height, coord_width, coord_height, fps),
-    M_writer(std::move(filename), pixel_width, pixel_height, fps),
-    M_data(std::make_unique<std::uint8_t[]>(pixel_width*pixel_height*3)) {}
+:   SceneBase(
+        pixel_width, pixel_height, coord_width, coord_height, fps,
+        preview ? preview : get_preview_options()
+    ),
+    M_filename(std::move(filename)),
+    M_options(std::move(options)),
+    M_fps(get_fps()),
+    M_chunks(get_chunk_assignment()),
+    M_data(std::make_unique<std::uint8_t[]>(
+        this->pixel_width()*this->pixel_height()*3))
+{
+    if (M_chunks and is_raw_stream_filename(M_filename)) {
+        throw std::invalid_argument(std::format(
+            "Unable to write a scene to {} with render_chunked, because "
+            "every worker would write to it at once.", M_filename));
+    }
+    if (is_preview()) M_options.preset = "ultrafast";
+    set_render_window(window ? window : get_render_window_from_environment());
+    auto first_frame = 0;
+    if (auto& render_window = get_render_window()) {
+        first_frame = render_window->first_frame(M_fps);
+        // Image sequences are numbered by frame, so their names can stay the
+        // same
+        if (is_video_filename(M_filename)) {
+            M_filename = get_window_filename(
+                M_filename, *render_window, M_fps);
+        }
+    }
+    if (!M_chunks) {
+        M_writer = make_frame_sink(M_filename, this->pixel_width(),
+                                   this->pixel_height(), M_fps, M_options,
+                                   first_frame);
+    }
+    set_readback_buffers(2);
+}
+
+Scene::~Scene()
+{
+    // Moved-from scenes have nothing left to write
+    if (!M_data) return;
+    try {
+        if (M_chunks) finish_chunk();
+        else flush_readback();
+    }
+    catch (std::exception& e) {
+        std::cerr << "Error while finishing scene: " << e.what() << "\n";
+    }
+}
 
 void Scene::process_frame()
 {
+    if (M_chunks) {
+        auto chunk = M_chunks->chunk_of(get_frame_count());
+        if (chunk != M_current_chunk) {
+            finish_chunk();
+            // Image sequences name each image after its frame, so workers
+            // can write them directly.  Raw streams were already rejected in
+            // the constructor.
+            auto filename = M_filename;
+            if (is_video_filename(M_filename)) {
+                filename = get_chunk_filename(M_filename, chunk);
+                std::filesystem::create_directories(
+                    std::filesystem::path(filename).parent_path());
+            }
+            M_writer = make_frame_sink(filename, pixel_width(),
+                                       pixel_height(), M_fps, M_options,
+                                       get_frame_count());
+            M_current_chunk = chunk;
+            M_chunk_start_frame = get_output_frame_count();
+        }
+    }
     glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    if (M_readback_slots.empty()) {
+        {
+            auto scope = Profiler::Scope(get_profiler(), "readback", true);
+            glReadPixels(0, 0, pixel_width(), pixel_height(), GL_RGB,
+                         GL_UNSIGNED_BYTE, M_data.get());
+        }
+        auto data = std::span<uint8_t>(
+                M_data.get(), pixel_width()*pixel_height()*3);
+        auto scope = Profiler::Scope(get_profiler(), "encode");
+        M_writer->set_frame_number(get_frame_count());
+        M_writer->write_frame(data);
+        M_processed = true;
+        return;
+    }
+    // The slot we're about to reuse holds the oldest frame still in flight, so
+    // finishing it here keeps the frames going to the writer in order.
+    auto& slot = M_readback_slots[M_next_slot];
+    if (slot.pending) finish_readback(M_next_slot, false);
+    auto scope = Profiler::Scope(get_profiler(), "readback", true);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
     glReadPixels(0, 0, pixel_width(), pixel_height(), GL_RGB, GL_UNSIGNED_BYTE,
-                 M_data.get());
-    auto data = std::span<uint8_t>(
-            M_data.get(), pixel_width()*pixel_height()*3);
-    M_writer.write_frame(data);
+                 nullptr);
+    submit_readback();
+}
+
+void Scene::process_partial_frame(int y, int height)
+{
+    if (!M_processed or starts_chunk()) {
+        process_frame();
+        return;
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    const auto row_size = pixel_width()*3;
+    const auto size = row_size*pixel_height();
+    if (M_readback_slots.empty()) {
+        // M_data still has the previous frame, so only the rows that changed
+        // need to be replaced
+        {
+            auto scope = Profiler::Scope(get_profiler(), "readback", true);
+            glReadPixels(0, y, pixel_width(), height, GL_RGB,
+                         GL_UNSIGNED_BYTE, M_data.get() + y*row_size);
+        }
+        auto scope = Profiler::Scope(get_profiler(), "encode");
+        M_writer->set_frame_number(get_frame_count());
+        M_writer->write_frame(std::span<uint8_t>(M_data.get(), size));
+        return;
+    }
+    auto& slot = M_readback_slots[M_next_slot];
+    if (slot.pending) finish_readback(M_next_slot, false);
+    auto scope = Profiler::Scope(get_profiler(), "readback", true);
+    // Start from a copy of the previous frame.  When there's only one slot,
+    // it already has the previous frame in it.
+    if (M_last_slot < 0) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glBufferSubData(GL_PIXEL_PACK_BUFFER, 0, size, M_data.get());
+    }
+    else if (M_last_slot != M_next_slot) {
+        glBindBuffer(GL_COPY_READ_BUFFER,
+                     M_readback_slots[M_last_slot].buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, slot.buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                            0, 0, size);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glReadPixels(0, y, pixel_width(), height, GL_RGB, GL_UNSIGNED_BYTE,
+                 reinterpret_cast<void*>(std::uintptr_t(y*row_size)));
+    submit_readback();
+}
+
+void Scene::submit_readback()
+{
+    auto& slot = M_readback_slots[M_next_slot];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = get_frame_count();
+    slot.pending = true;
+    M_last_slot = M_next_slot;
+    M_next_slot = (M_next_slot + 1) % ssize(M_readback_slots);
     M_processed = true;
 }
 
+bool Scene::starts_chunk() const
+{
+    return M_chunks and
+        M_chunks->chunk_of(get_frame_count()) != M_current_chunk;
+}
+
+void Scene::repeat_frame()
+{
+    // A new chunk needs its own copy of the frame
+    if (!M_processed or starts_chunk()) {
+        process_frame();
+        return;
+    }
+    if (M_last_slot >= 0 and M_readback_slots[M_last_slot].pending) {
+        auto& slot = M_readback_slots[M_last_slot];
+        // Repeats are numbered one after another, so they can't skip over
+        // frames that weren't output, like when the scene stopped animating
+        if (slot.frame + slot.repeats + 1 == get_frame_count()) {
+            ++slot.repeats;
+            return;
+        }
+        flush_readback();
+    }
+    // Otherwise, the previous frame has already been read back into M_data
+    auto scope = Profiler::Scope(get_profiler(), "encode");
+    M_writer->set_frame_number(get_frame_count());
+    M_writer->write_frame(std::span<uint8_t>(
+            M_data.get(), pixel_width()*pixel_height()*3));
+}
+
+void Scene::finish_readback(int slot_index, bool keep_latest)
+{
+    auto& slot = M_readback_slots[slot_index];
+    auto fence = static_cast<GLsync>(slot.fence);
+    auto result = GL_TIMEOUT_EXPIRED;
+    {
+        auto scope = Profiler::Scope(get_profiler(), "readback wait");
+        while (result == GL_TIMEOUT_EXPIRED) {
+            result = glClientWaitSync(
+                fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000);
+        }
+    }
+    glDeleteSync(fence);
+    slot.fence = nullptr;
+    slot.pending = false;
+    if (result == GL_WAIT_FAILED) {
+        throw std::runtime_error("Error: Unable to wait for frame readback.");
+    }
+    auto size = pixel_width()*pixel_height()*3;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    auto pixels = static_cast<std::uint8_t*>(
+            glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT));
+    if (!pixels) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        throw std::runtime_error("Error: Unable to map frame readback buffer.");
+    }
+    if (keep_latest and slot_index == M_last_slot) {
+        std::memcpy(M_data.get(), pixels, size);
+    }
+    auto scope = Profiler::Scope(get_profiler(), "encode");
+    auto count = 1 + slot.repeats;
+    slot.repeats = 0;
+    try {
+        M_writer->set_frame_number(slot.frame);
+        M_writer->write_frame(std::span<uint8_t>(pixels, size), count);
+    }
+    catch (...) {
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        throw;
+    }
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void Scene::flush_readback()
+{
+    auto count = ssize(M_readback_slots);
+    for (int i = 0; i < count; ++i) {
+        auto slot = (M_next_slot + i) % count;
+        if (M_readback_slots[slot].pending) finish_readback(slot, true);
+    }
+}
+
+bool Scene::draws_frame(int frame) const
+{
+    return !M_chunks or M_chunks->owns_frame(frame);
+}
+
+void Scene::finish_chunk()
+{
+    flush_readback();
+    if (!M_writer) return;
+    M_writer->finish();
+    M_writer.reset();
+    if (!is_video_filename(M_filename)) return;
+    // Frames that weren't output, like ones outside of the render window,
+    // don't take up any time in the output
+    record_finished_chunk(
+        *M_chunks, M_filename, M_current_chunk, M_fps, M_chunk_start_frame);
+}
+
+void Scene::set_readback_buffers(int buffers)
+{
+    if (buffers < 0) {
+        throw std::invalid_argument(
+            "Negative amount passed to Scene::set_readback_buffers");
+    }
+    flush_readback();
+    M_readback_slots.clear();
+    M_readback_slots.resize(buffers);
+    M_next_slot = 0;
+    M_last_slot = -1;
+    for (auto& slot : M_readback_slots) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, pixel_width()*pixel_height()*3,
+                     nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
 void Scene::write_to_image(std::string filename)
 {
     if (!M_processed) frame_advance();
+    // Only the worker that drew the current frame has it, and nobody has it
+    // if it was outside of the render window
+    const auto frame = get_frame_count() - 1;
+    if (!in_render_window(frame) or !draws_frame(frame)) return;
+    flush_readback();
     auto real_filename = std::format("{}.png", filename);
     stbi_write_png(
         real_filename.c_str(), pixel_width(), pixel_height(), 3,
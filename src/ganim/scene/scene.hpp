@@ -8,26 +8,62 @@
 #include <string>
 
 #include "base.hpp"
+#include "chunked_render.hpp"
 
+#include "ganim/gl/buffer.hpp"
+#include "ganim/video_writer/frame_sink.hpp"
 #include "ganim/video_writer/video_writer.hpp"
 
 namespace ganim {
     /** @brief The scene class that writes to a file.
      *
      * Most of the logic for scenes is in @ref SceneBase.
+     *
+     * When this program is a worker started by @ref render_chunked, the scene
+     * only draws the frames in this worker's chunks, and it writes each chunk
+     * to its own file instead of writing to the filename it was given.  Image
+     * sequences are the exception: each worker writes its own frames directly
+     * with their usual numbers.  Pipes can't be used with @ref
+     * render_chunked, because every worker would write to them at once, so
+     * the constructor throws if a worker tries.
+     *
+     * Images in an image sequence are numbered by the frame of the scene
+     * that they come from, so a chunked render names them the same way that
+     * a normal render does.
+     *
+     * When the environment variable `GANIM_PREVIEW` is set, every scene is
+     * drawn as a preview, even if none was passed to the constructor.  See
+     * @ref get_preview_options.
+     *
+     * When the scene has a @ref RenderWindow, only the frames inside of it
+     * are written.  Videos are written to a file whose name includes the
+     * window (see @ref get_window_filename) so that a full render isn't
+     * overwritten, while image sequences keep their names so that the
+     * window's images can replace the ones from a full render.  This works
+     * with @ref render_chunked as well.
      */
     class Scene : public SceneBase {
         public:
             /** @brief Constructor.
              *
              * @param filename The filename to write this scene to, including
-             * the extension.
+             * the extension.  This can also name an image sequence, a pipe,
+             * or nothing at all.  See @ref make_frame_sink.
              * @param pixel_width The width, in pixels, of this scene.
              * @param pixel_height The height, in pixels, of this scene.
              * @param coord_width The width, in coordinate units, of this scene.
              * @param coord_height The height, in coordinate units, of this
              * scene.
              * @param fps The framerate of this scene.
+             * @param options The settings used to encode the video.
+             * @param preview If this is set, the scene is drawn as a quick
+             * preview, and the video is encoded with the "ultrafast" preset.
+             * See @ref PreviewOptions.
+             * @param window If this is set, only this part of the scene is
+             * drawn and written.  Otherwise, the window is read from the
+             * environment with @ref get_render_window_from_environment.
+             * @throw std::invalid_argument If this program is a worker
+             * started by @ref render_chunked and the filename is a pipe.
              */
             Scene(
                 std::string filename,
@@ -35,20 +71,65 @@ namespace ganim {
                 int pixel_height,
                 double coord_width,
                 double coord_height,
-                int fps
+                int fps,
+                VideoWriterOptions options = {},
+                std::optional<PreviewOptions> preview = std::nullopt,
+                std::optional<RenderWindow> window = std::nullopt
             );
+            ~Scene();
+            Scene(Scene&&) noexcept=default;
+            Scene& operator=(Scene&&) noexcept=default;
             /** @brief Write the current frame to a file
              *
              * If the scene hasn't rendered anything yet, it will advance one
              * frame first.  It will always make a .png file.
              */
             void write_to_image(std::string filename);
+            /** @brief Set how many frames can be read back from the GPU
+             * asynchronously.
+             *
+             * Reading a frame back from the GPU stalls the CPU until the GPU
+             * has finished drawing it.  To avoid this, each frame is read into
+             * one of several pixel buffers, and it is only passed to the video
+             * writer once a later frame needs that buffer, by which time the
+             * GPU has usually finished with it.  More buffers mean more frames
+             * in flight at once.  Passing zero will read every frame back
+             * synchronously.  The default is two.
+             */
+            void set_readback_buffers(int buffers);
 
         private:
             virtual void process_frame() override;
+            virtual bool draws_frame(int frame) const override;
+            virtual void repeat_frame() override;
+            virtual void process_partial_frame(int y, int height) override;
+            bool starts_chunk() const;
+            void submit_readback();
+            void finish_readback(int slot, bool keep_latest);
+            void flush_readback();
+            void finish_chunk();
+
+            struct ReadbackSlot {
+                gl::Buffer buffer;
+                void* fence = nullptr;
+                // The number of frames after this one that are the same
+                int repeats = 0;
+                // The frame of the scene that this is
+                int frame = 0;
+                bool pending = false;
+            };
 
-            VideoWriter M_writer;
+            std::string M_filename;
+            VideoWriterOptions M_options;
+            int M_fps = 0;
+            std::optional<ChunkAssignment> M_chunks;
+            int M_current_chunk = -1;
+            int M_chunk_start_frame = 0;
+            std::unique_ptr<FrameSink> M_writer;
             std::unique_ptr<std::uint8_t[]> M_data;
+            std::vector<ReadbackSlot> M_readback_slots;
+            int M_next_slot = 0;
+            int M_last_slot = -1;
             bool M_processed = false;
     };
 }
@@ -25,6 +25,11 @@ in VertexData {
 #endif
 #ifdef OUTLINE
     vec2 out_tex_coord;
+#endif
+#ifdef INSTANCED
+    flat vec4 object_color;
+    flat float this_t;
+    flat float noise_scale;
 #endif
     vec3 window_pos;
 } fs_in;
@@ -32,6 +37,7 @@ in VertexData {
 #ifdef TEXTURE
 uniform sampler2D in_texture;
 #endif
+#ifndef INSTANCED
 #ifdef CREATE
 uniform float this_t;
 #endif
@@ -39,8 +45,10 @@ uniform float this_t;
 uniform float this_t;
 uniform float noise_scale;
 #endif
+#endif
 #ifdef DEPTH_PEELING
 uniform sampler2DMS layer_depth_buffer;
+uniform int layer_samples;
 #endif
 #ifdef DASH
 uniform float dash_on_time;
@@ -57,15 +65,24 @@ uniform float scale2;
 #endif
 #ifdef OUTLINE
 uniform float thickness;
+#ifndef ANALYTIC_OUTLINE
 uniform sampler2D distance_transform;
 #endif
+#endif
 #ifdef PIXELATE
 uniform int pixel_size;
 #endif
 
+#ifdef WEIGHTED_TRANSPARENCY
+layout(location = 0) out vec4 color;
+layout(location = 1) out float revealage;
+#else
 out vec4 color;
+#endif
 
+#ifndef INSTANCED
 uniform vec4 object_color;
+#endif
 
 // Various helper functions
 
@@ -117,6 +134,11 @@ float psrdnoise(vec2 x, vec2 period, float alpha, out vec2 gradient)
 
 void main()
 {
+#ifdef INSTANCED
+    vec4 object_color = fs_in.object_color;
+    float this_t = fs_in.this_t;
+    float noise_scale = fs_in.noise_scale;
+#endif
 #ifdef TIME
     // So for some reason, even when the t values passed in to the shader are
     // all greater than or equal to zero, fs_in.t can be negative.  I'm thinking
@@ -150,10 +172,10 @@ void main()
         round(gl_FragCoord.y - 0.5)
     );
     float depth = 0;
-    for (int i = 0; i < 4; ++i) {
+    for (int i = 0; i < layer_samples; ++i) {
         depth += texelFetch(layer_depth_buffer, depth_pos, i).r;
     }
-    depth /= 4;
+    depth /= layer_samples;
     if (depth >= fs_in.window_pos.z) discard;
 #endif
     color = object_color;
@@ -224,7 +246,11 @@ void main()
     }
 #endif
 #ifdef OUTLINE
+#ifdef ANALYTIC_OUTLINE
+    float distance = fs_in.out_tex_coord.x;
+#else
     float distance = texture(distance_transform, fs_in.out_tex_coord).r;
+#endif
     color = object_color;
     color.a *= clamp(thickness + 0.5 - distance, 0, 1);
 #endif
@@ -232,5 +258,18 @@ void main()
     // and without this they cover up objects behind them
     if (color.a <= 0) discard;
     gl_FragDepth = fs_in.window_pos.z;
+#ifdef WEIGHTED_TRANSPARENCY
+    // Weighted blended order-independent transparency, from McGuire and
+    // Bavoil's paper.  Closer and more opaque fragments get more weight, and
+    // the scene divides the weights back out when compositing.
+    float weight_depth = fs_in.window_pos.z * 0.5 + 0.5;
+    float weight = clamp(
+        color.a * max(1e-2, 3e3 * pow(1 - weight_depth, 3)),
+        1e-2,
+        3e3
+    );
+    revealage = color.a;
+    color = vec4(color.rgb * color.a, color.a) * weight;
+#endif
 }
 )"
@@ -13,9 +13,16 @@ layout (location = 3) in vec2 in_tex_coord;
 layout (location = 1) in vec2 in_tex_coord1;
 layout (location = 2) in vec2 in_tex_coord2;
 #endif
-#ifdef OUTLINE
+#ifdef ANALYTIC_OUTLINE
+// The direction to move the vertex in, and the fraction of the outline's
+// extent that the moved vertex is from the object
+layout (location = 1) in vec3 in_outline_offset;
+#elif defined(OUTLINE)
 layout (location = 1) in vec2 in_tex_coord;
 #endif
+#ifdef INSTANCED
+layout (location = 4) in uint in_object_index;
+#endif
 
 out VertexData {
 #ifdef TIME
@@ -39,6 +46,11 @@ out VertexData {
 #endif
 #ifdef OUTLINE
     vec2 out_tex_coord;
+#endif
+#ifdef INSTANCED
+    flat vec4 object_color;
+    flat float this_t;
+    flat float noise_scale;
 #endif
     vec3 window_pos;
 } vs_out;
@@ -52,12 +64,34 @@ uniform float tip_size;
 uniform float squish_amount;
 uniform vec4 squish_axis; // This is assumed to be normalized
 #endif
+#ifdef ANALYTIC_OUTLINE
+// How far the outside of the outline is from the object, in the object's own
+// coordinates and in pixels
+uniform float outline_extent;
+uniform float outline_extent_pixels;
+#endif
 
 uniform vec2 camera_scale;
 uniform vec4 view[2];
+#ifdef INSTANCED
+// Everything that would normally be a per-object uniform comes from here
+// instead, so that many objects can be drawn at once
+struct ObjectData {
+    vec4 model[2];
+    vec4 color;
+    float scale;
+    float depth_z;
+    float this_t;
+    float noise_scale;
+};
+layout (std430, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+#else
 uniform vec4 model[2];
 uniform float scale;
 uniform float depth_z;
+#endif
 
 // Various helper functions
 
@@ -121,6 +155,15 @@ vec3 squish(vec3 P)
 void main()
 {
     vec3 m_in_pos = in_pos;
+#ifdef INSTANCED
+    ObjectData object_data = objects[in_object_index];
+    vec4 model[2] = object_data.model;
+    float scale = object_data.scale;
+    float depth_z = object_data.depth_z;
+    vs_out.object_color = object_data.color;
+    vs_out.this_t = object_data.this_t;
+    vs_out.noise_scale = object_data.noise_scale;
+#endif
 
 #ifdef VECTOR
     if (m_in_pos.x == 0.5) {
@@ -129,6 +172,9 @@ void main()
     }
     else if (m_in_pos.x == 1.0) m_in_pos.x = end_pos;
 #endif
+#ifdef ANALYTIC_OUTLINE
+    m_in_pos.xy += in_outline_offset.xy * outline_extent;
+#endif
 
 #ifdef SQUISH
     vec3 pos_base = rotor_trivector_sandwich(model, m_in_pos*scale);
@@ -163,7 +209,11 @@ void main()
     vs_out.out_tex_coord1 = in_tex_coord1;
     vs_out.out_tex_coord2 = in_tex_coord2;
 #endif
-#ifdef OUTLINE
+#ifdef ANALYTIC_OUTLINE
+    // The distance is linear over each triangle, so the fragment shader gets
+    // it from the interpolated value instead of a texture
+    vs_out.out_tex_coord = vec2(in_outline_offset.z * outline_extent_pixels, 0);
+#elif defined(OUTLINE)
     vs_out.out_tex_coord = in_tex_coord;
 #endif
 
@@ -1,9 +1,13 @@
 #include "alpha_threshold.hpp"
 
 #include <format>
+#include <stdexcept>
 
 #include "ganim/gl/shader.hpp"
 #include "ganim/gl/gl.hpp"
+#include "ganim/gl/stats.hpp"
+#include "compute_backend.hpp"
+#include "parallel_for.hpp"
 
 using namespace ganim;
 
@@ -17,10 +21,12 @@ layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
 uniform layout(rgba32f, binding = 0) readonly image2D input_img;
 uniform layout(r8ui, binding = 1) writeonly uimage2D output_img;
 uniform layout(location = 2) float threshold;
+uniform layout(location = 3) ivec2 size;
 
 void main()
 {
     ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(pos, size))) return;
     float alpha = imageLoad(input_img, pos).a;
     float red = alpha >= threshold ? 255 : 0;
     imageStore(output_img, pos, uvec4(red, 0, 0, 0));
@@ -37,10 +43,59 @@ void main()
         static auto result = make_shader();
         return result;
     }
+
+    constexpr std::size_t min_parallel_pixels = 1 << 16;
+
+    gl::ScratchTexture gpu_alpha_threshold(
+        unsigned tex,
+        float threshold,
+        int width,
+        int height
+    )
+    {
+        auto& shader = ::shader();
+        ++gl::stats.program_changes;
+        glUseProgram(shader);
+
+        glBindImageTexture(0, tex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+
+        auto result = gl::get_scratch_texture(width, height, GL_R8UI);
+        glBindImageTexture(1, result, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8UI);
+
+        glUniform1f(2, threshold);
+        glUniform2i(3, width, height);
+
+        glDispatchCompute((width + 7) / 8, (height + 7) / 8, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        return result;
+    }
+
+    gl::ScratchTexture cpu_alpha_threshold(
+        unsigned tex,
+        float threshold,
+        int width,
+        int height
+    )
+    {
+        auto image = std::vector<float>(std::size_t(width) * height * 4);
+        glGetTextureImage(tex, 0, GL_RGBA, GL_FLOAT,
+                          image.size() * sizeof(float), image.data());
+        auto thresholded = alpha_threshold_cpu(image, threshold, width, height);
+
+        auto result = gl::get_scratch_texture(width, height, GL_R8UI);
+        glBindTexture(GL_TEXTURE_2D, result);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
+                        GL_RED_INTEGER, GL_UNSIGNED_BYTE, thresholded.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return result;
+    }
 }
 
-gl::Texture ganim::alpha_threshold(
-    const gl::Texture& tex,
+gl::ScratchTexture ganim::alpha_threshold(
+    unsigned tex,
     float threshold,
     int width,
     int height
@@ -52,28 +107,47 @@ gl::Texture ganim::alpha_threshold(
     if (height <= 0) throw std::invalid_argument(std::format(
         "The texture height passed to alpha_threshold is not positive: {}",
         height));
-    if (width % 8 != 0) throw std::invalid_argument(std::format(
-        "The texture width passed to alpha_threshold is not a multiple of 8: "
-        "{}", width));
-    if (height % 8 != 0) throw std::invalid_argument(std::format(
-        "The texture height passed to alpha_threshold is not a multiple of 8: "
-        "{}", height));
-
-    auto& shader = ::shader();
-    glUseProgram(shader);
-
-    glBindImageTexture(0, tex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
-
-    auto result = gl::Texture();
-    glBindTexture(GL_TEXTURE_2D, result);
-    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8UI, width, height);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindImageTexture(1, result, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8UI);
-
-    glUniform1f(2, threshold);
+    auto actual_width = 0;
+    auto actual_height = 0;
+    glGetTextureLevelParameteriv(tex, 0, GL_TEXTURE_WIDTH, &actual_width);
+    glGetTextureLevelParameteriv(tex, 0, GL_TEXTURE_HEIGHT, &actual_height);
+    if (width != actual_width or height != actual_height) {
+        throw std::invalid_argument(std::format(
+            "The texture size passed to alpha_threshold is {}x{}, but the "
+            "texture is {}x{}", width, height, actual_width, actual_height));
+    }
 
-    glDispatchCompute(width / 8, height / 8, 1);
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    if (get_compute_backend() == ComputeBackend::CPU) {
+        return cpu_alpha_threshold(tex, threshold, width, height);
+    }
+    return gpu_alpha_threshold(tex, threshold, width, height);
+}
 
+std::vector<std::uint8_t> ganim::alpha_threshold_cpu(
+    std::span<const float> image,
+    float threshold,
+    int width,
+    int height
+)
+{
+    if (width <= 0 or height <= 0) {
+        throw std::invalid_argument(std::format(
+            "The image size passed to alpha_threshold_cpu is not positive: "
+            "{}x{}", width, height));
+    }
+    const auto pixels = std::size_t(width) * height;
+    if (image.size() != pixels * 4) {
+        throw std::invalid_argument(std::format(
+            "The image passed to alpha_threshold_cpu has {} floats, but it "
+            "should have 4x{}x{}", image.size(), width, height));
+    }
+    auto result = std::vector<std::uint8_t>(pixels);
+    parallel_for(pixels, min_parallel_pixels,
+        [&](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; ++i) {
+                result[i] = image[4*i + 3] >= threshold ? 255 : 0;
+            }
+        }
+    );
     return result;
 }
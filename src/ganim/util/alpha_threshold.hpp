@@ -1,7 +1,11 @@
 #ifndef GANIM_UTIL_ALPHA_THRESHOLD_HPP
 #define GANIM_UTIL_ALPHA_THRESHOLD_HPP
 
-#include "ganim/gl/texture.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "ganim/gl/scratch_pool.hpp"
 
 namespace ganim {
     /** @brief Computes an "alpha threshold" on a given texture
@@ -11,20 +15,43 @@ namespace ganim {
      * `threshold` value will be 255 in the resulting texture, and all other
      * pixels will be 0.
      *
-     * For now, width and height must be a multiple of 8.  If they are not, an
-     * `std::invalid_argument` will be thrown.
+     * Where this is calculated depends on @ref get_compute_backend.
      *
-     * @param tex The texture.  Its format must be GL_RGBA32F.
+     * @param tex The texture id.  Its format must be GL_RGBA32F.
      * @param threshold The alpha threshold value to use.  Anything greater than
      * or equal to it will be 255 in the output image, and everything else will
      * be 0.
      * @param width The width of the texture, in pixels.
      * @param height The height of the texture, in pixels.
      *
-     * @return The thresholded texture.  Its format will be GL_R8UI.
+     * @return The thresholded texture.  Its format will be GL_R8UI.  It is
+     * borrowed from the scratch pool, because it is almost always only
+     * passed to @ref distance_transform and then thrown away.
+     *
+     * @throw std::invalid_argument If the width or height isn't positive or
+     * doesn't match the size of the texture.
+     */
+    gl::ScratchTexture alpha_threshold(
+        unsigned tex,
+        float threshold,
+        int width,
+        int height
+    );
+    /** @brief Computes an "alpha threshold" on an image on the CPU.
+     *
+     * @param image The RGBA image, with four floats per pixel.
+     * @param threshold The alpha threshold value to use.
+     * @param width The width of the image, in pixels.
+     * @param height The height of the image, in pixels.
+     *
+     * @return One byte per pixel, which is 255 if the pixel's alpha is
+     * greater than or equal to `threshold` and 0 otherwise.
+     *
+     * @throw std::invalid_argument If the width or height isn't positive or
+     * doesn't match the size of the image.
      */
-    gl::Texture alpha_threshold(
-        const gl::Texture& tex,
+    std::vector<std::uint8_t> alpha_threshold_cpu(
+        std::span<const float> image,
         float threshold,
         int width,
         int height
@@ -0,0 +1,47 @@
+#include "compute_backend.hpp"
+
+#include <cstdlib>
+#include <format>
+#include <stdexcept>
+#include <string_view>
+
+#include "ganim/gl/context.hpp"
+#include "ganim/gl/gl.hpp"
+
+using namespace ganim;
+
+namespace {
+    ComputeBackend G_backend = ComputeBackend::Automatic;
+
+    ComputeBackend choose_backend()
+    {
+        if (auto env = std::getenv("GANIM_COMPUTE_BACKEND")) {
+            auto name = std::string_view(env);
+            if (name == "cpu") return ComputeBackend::CPU;
+            if (name == "gpu") return ComputeBackend::GPU;
+            throw std::runtime_error(std::format(
+                "Unknown compute backend \"{}\" in GANIM_COMPUTE_BACKEND",
+                name));
+        }
+        gl::ensure_context();
+        auto renderer = glGetString(GL_RENDERER);
+        if (!renderer) return ComputeBackend::GPU;
+        auto name = std::string_view(reinterpret_cast<const char*>(renderer));
+        for (auto software : {"llvmpipe", "softpipe", "SwiftShader"}) {
+            if (name.contains(software)) return ComputeBackend::CPU;
+        }
+        return ComputeBackend::GPU;
+    }
+}
+
+void ganim::set_compute_backend(ComputeBackend backend)
+{
+    G_backend = backend;
+}
+
+ComputeBackend ganim::get_compute_backend()
+{
+    if (G_backend != ComputeBackend::Automatic) return G_backend;
+    static const auto automatic = choose_backend();
+    return automatic;
+}
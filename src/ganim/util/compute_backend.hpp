@@ -0,0 +1,45 @@
+#ifndef GANIM_UTIL_COMPUTE_BACKEND_HPP
+#define GANIM_UTIL_COMPUTE_BACKEND_HPP
+
+/** @file
+ * @brief Choosing where image processing like @ref ganim::distance_transform
+ * "distance_transform" is done.
+ */
+
+namespace ganim {
+    /** @brief Where to do image processing on textures. */
+    enum class ComputeBackend {
+        /** @brief Pick a backend at runtime.
+         *
+         * If the environment variable `GANIM_COMPUTE_BACKEND` is set to "cpu"
+         * or "gpu", that backend is used.  Otherwise, the CPU is used when
+         * OpenGL is being emulated in software (like with llvmpipe), where
+         * compute shaders are very slow, and the GPU is used otherwise.
+         */
+        Automatic,
+        /** @brief Use OpenGL compute shaders. */
+        GPU,
+        /** @brief Copy the texture to the CPU, process it there on several
+         * threads, and copy the result back.
+         */
+        CPU
+    };
+
+    /** @brief Choose where image processing on textures is done.
+     *
+     * Unlike @ref gl::set_context_backend, this can be changed at any time.
+     */
+    void set_compute_backend(ComputeBackend backend);
+
+    /** @brief Get where image processing on textures is done.
+     *
+     * This never returns @ref ComputeBackend::Automatic; it returns the
+     * backend that was picked instead.
+     *
+     * @throw std::runtime_error If `GANIM_COMPUTE_BACKEND` is set to
+     * something unknown.
+     */
+    ComputeBackend get_compute_backend();
+}
+
+#endif
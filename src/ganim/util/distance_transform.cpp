@@ -1,10 +1,23 @@
 #include "distance_transform.hpp"
 
-#include <format>
+#include <algorithm>
 #include <bit>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GANIM_DISTANCE_TRANSFORM_X86
+#endif
 
 #include "ganim/gl/shader.hpp"
 #include "ganim/gl/gl.hpp"
+#include "ganim/gl/scratch_pool.hpp"
+#include "ganim/gl/stats.hpp"
+#include "compute_backend.hpp"
+#include "parallel_for.hpp"
 
 using namespace ganim;
 
@@ -17,15 +30,24 @@ layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
 
 uniform layout(r8ui, binding = 0) readonly uimage2D input_img;
 uniform layout(rgba32f, binding = 1) writeonly image2D output_img;
+uniform layout(r32ui, binding = 2) readonly uimage2D region_img;
+uniform layout(location = 2) ivec2 size;
+uniform layout(location = 3) bool use_regions;
 
 void main()
 {
     ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
-    if (imageLoad(input_img, pos).r == 255) {
-        imageStore(output_img, pos, vec4(pos.xy, 0.0, 0.0));
+    if (any(greaterThanEqual(pos, size))) return;
+    // Pixels only look at pixels with the same region in z.  Region 0 is
+    // outside of every region, so it can't have any seeds.
+    float region = 0.0;
+    if (use_regions) region = float(imageLoad(region_img, pos).r);
+    bool seed = imageLoad(input_img, pos).r == 255;
+    if (seed && (!use_regions || region != 0.0)) {
+        imageStore(output_img, pos, vec4(pos.xy, region, 0.0));
     }
     else {
-        imageStore(output_img, pos, vec4(0.0, 0.0, 0.0, 1.0 / 0.0));
+        imageStore(output_img, pos, vec4(0.0, 0.0, region, 1.0 / 0.0));
     }
 }
 )";
@@ -38,20 +60,21 @@ layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
 uniform layout(rgba32f, binding = 0) readonly image2D input_img;
 uniform layout(rgba32f, binding = 1) writeonly image2D output_img;
 uniform layout(location = 2) int n;
-uniform layout(location = 3) int size;
+uniform layout(location = 3) ivec2 size;
 
 void main()
 {
     ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(pos, size))) return;
     vec4 p = imageLoad(input_img, pos);
     if (p.a != 0.0) {
         for (int x = -n; x <= n; x += n) {
-            if (pos.x + x < 0 || pos.x + x >= size) continue;
+            if (pos.x + x < 0 || pos.x + x >= size.x) continue;
             for (int y = -n; y <= n; y += n) {
-                if (pos.y + y < 0 || pos.y + y >= size) continue;
+                if (pos.y + y < 0 || pos.y + y >= size.y) continue;
                 if (x == 0 && y == 0) continue;
                 vec4 q = imageLoad(input_img, pos + ivec2(x, y));
-                if (isinf(q.a)) continue;
+                if (isinf(q.a) || q.z != p.z) continue;
                 float q_distance = distance(pos, q.xy);
                 if (q_distance < p.a) {
                     p.xy = q.xy;
@@ -71,11 +94,13 @@ layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
 
 uniform layout(rgba32f, binding = 0) readonly image2D input_img;
 uniform layout(r32f, binding = 1) writeonly image2D output_img;
+uniform layout(location = 2) ivec2 size;
 uniform float scale;
 
 void main()
 {
     ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(pos, size))) return;
     imageStore(
         output_img,
         pos,
@@ -116,70 +141,473 @@ void main()
         static auto result = make_end();
         return result;
     }
+
+    constexpr auto infinity = std::numeric_limits<float>::infinity();
+    // Each column only takes a few operations per pixel in the first pass,
+    // so a chunk has to have a lot of them to be worth a thread
+    constexpr std::size_t min_parallel_pixels = 1 << 16;
+
+    // The first pass goes down each column and then back up it, finding the
+    // distance to the closest pixel in the same column.  Rows are contiguous,
+    // so these work on part of a row at a time, which can be vectorized.
+    using DownKernel = void(*)(
+        const std::uint8_t* image,
+        const float* above,
+        float* output,
+        std::size_t size
+    );
+    using UpKernel = void(*)(
+        const float* below,
+        float* output,
+        std::size_t size
+    );
+
+    void sweep_down_scalar(
+        const std::uint8_t* image,
+        const float* above,
+        float* output,
+        std::size_t size
+    )
+    {
+        for (std::size_t i = 0; i < size; ++i) {
+            output[i] = image[i] == 255 ? 0.0f : above[i] + 1;
+        }
+    }
+
+    void sweep_up_scalar(
+        const float* below,
+        float* output,
+        std::size_t size
+    )
+    {
+        for (std::size_t i = 0; i < size; ++i) {
+            output[i] = std::min(output[i], below[i] + 1);
+        }
+    }
+
+#ifdef GANIM_DISTANCE_TRANSFORM_X86
+    __attribute__((target("avx2")))
+    void sweep_down_avx2(
+        const std::uint8_t* image,
+        const float* above,
+        float* output,
+        std::size_t size
+    )
+    {
+        const auto one = _mm256_set1_ps(1);
+        const auto full = _mm256_set1_epi32(255);
+        std::size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            auto bytes = _mm_loadl_epi64(
+                reinterpret_cast<const __m128i*>(image + i));
+            auto is_full = _mm256_castsi256_ps(
+                _mm256_cmpeq_epi32(_mm256_cvtepu8_epi32(bytes), full));
+            auto next = _mm256_add_ps(_mm256_loadu_ps(above + i), one);
+            _mm256_storeu_ps(output + i, _mm256_andnot_ps(is_full, next));
+        }
+        sweep_down_scalar(image + i, above + i, output + i, size - i);
+    }
+
+    __attribute__((target("avx2")))
+    void sweep_up_avx2(
+        const float* below,
+        float* output,
+        std::size_t size
+    )
+    {
+        const auto one = _mm256_set1_ps(1);
+        std::size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            auto next = _mm256_add_ps(_mm256_loadu_ps(below + i), one);
+            _mm256_storeu_ps(output + i,
+                    _mm256_min_ps(_mm256_loadu_ps(output + i), next));
+        }
+        sweep_up_scalar(below + i, output + i, size - i);
+    }
+#endif
+
+    std::pair<DownKernel, UpKernel> choose_kernels()
+    {
+#ifdef GANIM_DISTANCE_TRANSFORM_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return {sweep_down_avx2, sweep_up_avx2};
+        }
+#endif
+        return {sweep_down_scalar, sweep_up_scalar};
+    }
+
+    // The second pass goes along each row, finding the lower envelope of the
+    // parabolas (x - q)^2 + g(q)^2 for every pixel q in the row, where g is
+    // the result of the first pass.  The minimum of these is the squared
+    // distance to the closest pixel.
+    void envelope_row(
+        const float* column_distances,
+        float* output,
+        int width,
+        double scale,
+        std::vector<int>& parabolas,
+        std::vector<double>& heights,
+        std::vector<double>& boundaries
+    )
+    {
+        auto k = -1;
+        for (int q = 0; q < width; ++q) {
+            const auto g = double(column_distances[q]);
+            // Columns without any pixels can't be the closest one
+            if (std::isinf(g)) continue;
+            const auto height = g*g + double(q)*q;
+            auto boundary = -double(infinity);
+            while (k >= 0) {
+                boundary = (height - heights[k]) / (2.0 * (q - parabolas[k]));
+                if (boundary > boundaries[k]) break;
+                --k;
+            }
+            if (k < 0) boundary = -double(infinity);
+            ++k;
+            parabolas[k] = q;
+            heights[k] = height;
+            boundaries[k] = boundary;
+        }
+        if (k < 0) {
+            std::fill(output, output + width, infinity);
+            return;
+        }
+        auto j = 0;
+        for (int x = 0; x < width; ++x) {
+            while (j < k and boundaries[j + 1] < x) ++j;
+            const auto dx = double(x - parabolas[j]);
+            const auto g = double(column_distances[parabolas[j]]);
+            output[x] = static_cast<float>(std::sqrt(dx*dx + g*g) * scale);
+        }
+    }
+
+    void check_texture_size(
+        unsigned texture,
+        int width,
+        int height,
+        const char* function
+    )
+    {
+        if (width <= 0 or height <= 0) {
+            throw std::invalid_argument(std::format(
+                "The texture size passed to {} is not positive: {}x{}",
+                function, width, height));
+        }
+        auto actual_width = 0;
+        auto actual_height = 0;
+        glGetTextureLevelParameteriv(
+            texture, 0, GL_TEXTURE_WIDTH, &actual_width);
+        glGetTextureLevelParameteriv(
+            texture, 0, GL_TEXTURE_HEIGHT, &actual_height);
+        if (width != actual_width or height != actual_height) {
+            throw std::invalid_argument(std::format(
+                "The texture size passed to {} is {}x{}, but the texture is "
+                "{}x{}", function, width, height, actual_width, actual_height));
+        }
+    }
+
+    void check_image_size(
+        std::size_t size,
+        int width,
+        int height,
+        const char* function
+    )
+    {
+        if (width <= 0 or height <= 0) {
+            throw std::invalid_argument(std::format(
+                "The image size passed to {} is not positive: {}x{}",
+                function, width, height));
+        }
+        if (size != std::size_t(width) * height) {
+            throw std::invalid_argument(std::format(
+                "The image passed to {} has {} pixels, but it should have "
+                "{}x{}", function, size, width, height));
+        }
+    }
+
+    // Gives each pixel the index of its region plus one, or zero if it isn't
+    // in any region
+    std::vector<std::uint32_t> region_ids(
+        std::span<const DistanceTransformRegion> regions,
+        int width,
+        int height,
+        const char* function
+    )
+    {
+        auto result = std::vector<std::uint32_t>(std::size_t(width) * height);
+        for (auto i = 0; auto& region : regions) {
+            ++i;
+            if (region.width <= 0 or region.height <= 0 or region.x < 0
+                    or region.y < 0 or region.x + region.width > width
+                    or region.y + region.height > height) {
+                throw std::invalid_argument(std::format(
+                    "Region {} passed to {} ({}x{} at {}, {}) is not inside "
+                    "the {}x{} image", i - 1, function, region.width,
+                    region.height, region.x, region.y, width, height));
+            }
+            for (int y = region.y; y < region.y + region.height; ++y) {
+                auto row = result.data() + std::size_t(y) * width;
+                for (int x = region.x; x < region.x + region.width; ++x) {
+                    if (row[x] != 0) {
+                        throw std::invalid_argument(std::format(
+                            "Regions {} and {} passed to {} overlap",
+                            row[x] - 1, i - 1, function));
+                    }
+                    row[x] = i;
+                }
+            }
+        }
+        return result;
+    }
+
+    gl::Texture gpu_distance_transform(
+        unsigned input,
+        int width,
+        int height,
+        std::span<const std::uint32_t> regions,
+        int largest_region,
+        double scale
+    )
+    {
+        auto& start = start_shader();
+        auto& main = main_shader();
+        auto& end = end_shader();
+        const auto groups_x = (width + 7) / 8;
+        const auto groups_y = (height + 7) / 8;
+
+        auto tex1 = gl::get_scratch_texture(width, height, GL_RGBA32F);
+        auto tex2 = gl::get_scratch_texture(width, height, GL_RGBA32F);
+
+        ++gl::stats.program_changes;
+        glUseProgram(start);
+        glUniform2i(2, width, height);
+        glUniform1i(3, !regions.empty());
+        auto region_texture = gl::ScratchTexture();
+        if (!regions.empty()) {
+            region_texture = gl::get_scratch_texture(width, height, GL_R32UI);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glTextureSubImage2D(region_texture, 0, 0, 0, width, height,
+                    GL_RED_INTEGER, GL_UNSIGNED_INT, regions.data());
+            glBindImageTexture(
+                2, region_texture, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32UI);
+        }
+        glBindImageTexture(0, input, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R8UI);
+        glBindImageTexture(
+            1, tex1, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+        glDispatchCompute(groups_x, groups_y, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        ++gl::stats.program_changes;
+        glUseProgram(main);
+        glUniform2i(3, width, height);
+        // Nothing is farther apart than the size of the largest region
+        const auto first_step = static_cast<int>(
+            std::bit_ceil(static_cast<unsigned>(largest_region)) / 2);
+        for (int n = first_step; n > 0; n /= 2) {
+            glBindImageTexture(
+                0, tex1, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+            glBindImageTexture(
+                1, tex2, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+            glUniform1i(2, n);
+            glDispatchCompute(groups_x, groups_y, 1);
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            std::swap(tex1, tex2);
+        }
+
+        ++gl::stats.program_changes;
+        glUseProgram(end);
+        auto result = gl::Texture();
+        glBindTexture(GL_TEXTURE_2D, result);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32F, width, height);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindImageTexture(0, tex1, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(1, result, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glUniform2i(2, width, height);
+        glUniform1f(end.get_uniform("scale"), scale);
+        glDispatchCompute(groups_x, groups_y, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        return result;
+    }
+
+    gl::Texture cpu_distance_transform(
+        unsigned input,
+        int width,
+        int height,
+        std::span<const DistanceTransformRegion> regions,
+        double scale
+    )
+    {
+        auto image = std::vector<std::uint8_t>(std::size_t(width) * height);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTextureImage(input, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE,
+                          image.size(), image.data());
+        auto distances = regions.empty()
+            ? distance_transform_cpu(image, width, height, scale)
+            : distance_transform_cpu(image, width, height, regions, scale);
+
+        auto result = gl::Texture();
+        glBindTexture(GL_TEXTURE_2D, result);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32F, width, height);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED,
+                        GL_FLOAT, distances.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return result;
+    }
+}
+
+namespace {
+    gl::Texture distance_transform_impl(
+        unsigned input,
+        int width,
+        int height,
+        std::span<const DistanceTransformRegion> regions,
+        double scale
+    )
+    {
+        auto result = [&]{
+            if (get_compute_backend() == ComputeBackend::CPU) {
+                return cpu_distance_transform(
+                        input, width, height, regions, scale);
+            }
+            if (regions.empty()) {
+                return gpu_distance_transform(input, width, height, {},
+                                              std::max(width, height), scale);
+            }
+            auto ids = region_ids(regions, width, height, "distance_transform");
+            auto largest = 1;
+            for (auto& region : regions) {
+                largest = std::max({largest, region.width, region.height});
+            }
+            return gpu_distance_transform(
+                    input, width, height, ids, largest, scale);
+        }();
+
+        glBindTexture(GL_TEXTURE_2D, result);
+        glTexParameteri(
+            GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR
+        );
+        glTexParameteri(
+            GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR
+        );
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        return result;
+    }
+}
+
+gl::Texture ganim::distance_transform(
+    unsigned input,
+    int width,
+    int height,
+    double scale
+)
+{
+    check_texture_size(input, width, height, "distance_transform");
+    return distance_transform_impl(input, width, height, {}, scale);
 }
 
 gl::Texture ganim::distance_transform(
-    const gl::Texture& input,
+    unsigned input,
     int size,
     double scale
 )
 {
-    if (size <= 0) throw std::invalid_argument(std::format(
-        "The texture size passed to distance_transform is not positive: {}",
-        size));
-    if (!std::has_single_bit(static_cast<unsigned>(size)))
-        throw std::invalid_argument(std::format(
-            "The texture size passed to alpha_threshold is not a multiple of 8:"
-            "{}", size));
-
-    auto& start = start_shader();
-    auto& main = main_shader();
-    auto& end = end_shader();
-
-    auto tex1 = gl::Texture();
-    auto tex2 = gl::Texture();
-    glBindTexture(GL_TEXTURE_2D, tex1);
-    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, size, size);
-    glBindTexture(GL_TEXTURE_2D, tex2);
-    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, size, size);
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    glUseProgram(start);
-    glBindImageTexture(0, input, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R8UI);
-    glBindImageTexture(1, tex1, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
-    glDispatchCompute(size / 8, size / 8, 1);
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-
-    glUseProgram(main);
-    glUniform1i(3, size);
-    for (int n = size / 2; n > 0; n /= 2) {
-        glBindImageTexture(0, tex1, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
-        glBindImageTexture(1, tex2, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
-        glUniform1i(2, n);
-        glDispatchCompute(size / 8, size / 8, 1);
-        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-        std::swap(tex1, tex2);
-    }
-
-    glUseProgram(end);
-    auto result = gl::Texture();
-    glBindTexture(GL_TEXTURE_2D, result);
-    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32F, size, size);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindImageTexture(0, tex1, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
-    glBindImageTexture(1, result, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
-    glUniform1f(end.get_uniform("scale"), scale);
-    glDispatchCompute(size / 8, size / 8, 1);
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-
-    glBindTexture(GL_TEXTURE_2D, result);
-    glTexParameteri(
-        GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR
+    return distance_transform(input, size, size, scale);
+}
+
+gl::Texture ganim::distance_transform(
+    unsigned input,
+    int width,
+    int height,
+    std::span<const DistanceTransformRegion> regions,
+    double scale
+)
+{
+    check_texture_size(input, width, height, "distance_transform");
+    if (regions.empty()) {
+        throw std::invalid_argument(
+            "No regions were passed to distance_transform");
+    }
+    return distance_transform_impl(input, width, height, regions, scale);
+}
+
+std::vector<float> ganim::distance_transform_cpu(
+    std::span<const std::uint8_t> image,
+    int width,
+    int height,
+    double scale
+)
+{
+    check_image_size(image.size(), width, height, "distance_transform_cpu");
+    const auto w = std::size_t(width);
+    const auto h = std::size_t(height);
+    static const auto kernels = choose_kernels();
+    const auto [down, up] = kernels;
+
+    auto column_distances = std::vector<float>(w * h);
+    const auto infinite_row = std::vector<float>(w, infinity);
+    parallel_for(w, std::max<std::size_t>(min_parallel_pixels / h, 8),
+        [&](std::size_t begin, std::size_t end) {
+            const auto size = end - begin;
+            auto row = [&](std::size_t y) {
+                return column_distances.data() + y * w + begin;
+            };
+            down(image.data() + begin, infinite_row.data() + begin, row(0),
+                 size);
+            for (std::size_t y = 1; y < h; ++y) {
+                down(image.data() + y * w + begin, row(y - 1), row(y), size);
+            }
+            for (std::size_t y = h - 1; y-- > 0;) {
+                up(row(y + 1), row(y), size);
+            }
+        }
     );
-    glTexParameteri(
-        GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR
+
+    auto result = std::vector<float>(w * h);
+    parallel_for(h, std::max<std::size_t>(min_parallel_pixels / w, 1),
+        [&](std::size_t begin, std::size_t end) {
+            auto parabolas = std::vector<int>(w);
+            auto heights = std::vector<double>(w);
+            auto boundaries = std::vector<double>(w);
+            for (auto y = begin; y < end; ++y) {
+                envelope_row(column_distances.data() + y * w,
+                             result.data() + y * w, width, scale,
+                             parabolas, heights, boundaries);
+            }
+        }
     );
-    glGenerateMipmap(GL_TEXTURE_2D);
+    return result;
+}
 
+std::vector<float> ganim::distance_transform_cpu(
+    std::span<const std::uint8_t> image,
+    int width,
+    int height,
+    std::span<const DistanceTransformRegion> regions,
+    double scale
+)
+{
+    check_image_size(image.size(), width, height, "distance_transform_cpu");
+    // This is only used to check the regions
+    region_ids(regions, width, height, "distance_transform_cpu");
+    auto result = std::vector<float>(std::size_t(width) * height, infinity);
+    auto part = std::vector<std::uint8_t>();
+    for (auto& region : regions) {
+        part.resize(std::size_t(region.width) * region.height);
+        for (int y = 0; y < region.height; ++y) {
+            auto row = image.begin()
+                + std::size_t(region.y + y) * width + region.x;
+            std::copy(row, row + region.width,
+                      part.begin() + std::size_t(y) * region.width);
+        }
+        auto distances = distance_transform_cpu(
+                part, region.width, region.height, scale);
+        for (int y = 0; y < region.height; ++y) {
+            auto row = distances.begin() + std::size_t(y) * region.width;
+            std::copy(row, row + region.width, result.begin()
+                      + std::size_t(region.y + y) * width + region.x);
+        }
+    }
     return result;
 }
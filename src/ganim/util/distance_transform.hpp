@@ -1,33 +1,135 @@
 #ifndef GANIM_UTIL_DISTANCE_TRANSFORM_HPP
 #define GANIM_UTIL_DISTANCE_TRANSFORM_HPP
 
+#include <cstdint>
+#include <span>
+#include <vector>
+
 #include "ganim/gl/texture.hpp"
 
 namespace ganim {
+    /** @brief A rectangle of an image whose distance transform is computed
+     * separately from the rest of the image.
+     */
+    struct DistanceTransformRegion {
+        int x = 0;
+        int y = 0;
+        int width = 0;
+        int height = 0;
+    };
+
     /** @brief Computes the distance transform of a given thresholded texture
      *
      * This will take in a given texture in GL_R8UI format and produce a new
      * texture in GL_R32F format.  It will calculate the distance transform of
      * the input texture.  The value in each pixel will be the distance from
      * that pixel to the closest pixel with a value equal to 255 in the input
-     * texture.
+     * texture, or infinity if there are no such pixels.
      *
-     * For now, this only supports square textures of side lengths that are a
-     * power of two.  If they are not, an `std::invalid_argument` will be
-     * thrown.
+     * Where this is calculated depends on @ref get_compute_backend.  On the
+     * GPU, it uses jump flooding, which is very close to exact.  On the CPU,
+     * it uses @ref distance_transform_cpu, which is exact.
      *
-     * @param input The texture.  Its format must be GL_R8UI.
-     * @param size The width and height of the texture, in pixels.
+     * @param input The texture id.  Its format must be GL_R8UI.
+     * @param width The width of the texture, in pixels.
+     * @param height The height of the texture, in pixels.
      * @param scale An amount to multiply all distances by.  The final values
      * will be the pixel distance times this scale factor.
      *
      * @return The distance transform.  Its format will be GL_R32F.
+     *
+     * @throw std::invalid_argument If the width or height isn't positive or
+     * doesn't match the size of the texture.
      */
     gl::Texture distance_transform(
-        const gl::Texture& input,
+        unsigned input,
+        int width,
+        int height,
+        double scale = 1.0
+    );
+    /** @brief Computes the distance transform of a given square thresholded
+     * texture.
+     *
+     * This is the same as the other overload with the same width and height.
+     */
+    gl::Texture distance_transform(
+        unsigned input,
         int size,
         double scale = 1.0
     );
+    /** @brief Computes the distance transforms of several parts of a
+     * thresholded texture at once.
+     *
+     * This is used when several images are packed into one texture.  Each
+     * pixel in a region gets the distance to the closest pixel equal to 255
+     * in the same region, so the images don't affect each other, and pixels
+     * that aren't in any region are infinitely far away.  Doing this once is
+     * much faster than doing it for each image separately.
+     *
+     * @param input The texture id.  Its format must be GL_R8UI.
+     * @param width The width of the texture, in pixels.
+     * @param height The height of the texture, in pixels.
+     * @param regions The parts of the texture.
+     * @param scale An amount to multiply all distances by.
+     *
+     * @return The distance transform.  Its format will be GL_R32F.
+     *
+     * @throw std::invalid_argument If the texture size is wrong, there are no
+     * regions, or the regions overlap or aren't inside of the texture.
+     */
+    gl::Texture distance_transform(
+        unsigned input,
+        int width,
+        int height,
+        std::span<const DistanceTransformRegion> regions,
+        double scale = 1.0
+    );
+
+    /** @brief Computes the exact Euclidean distance transform of an image on
+     * the CPU.
+     *
+     * This uses the separable algorithm by Meijster et al., which finds the
+     * distance to the closest pixel in each column and then combines the
+     * columns using the lower envelope of parabolas from Felzenszwalb and
+     * Huttenlocher.  The first pass is vectorized with AVX2 when the CPU
+     * supports it, and both passes are split across several threads.
+     *
+     * @param image The image, one byte per pixel, starting at the first row.
+     * @param width The width of the image, in pixels.
+     * @param height The height of the image, in pixels.
+     * @param scale An amount to multiply all distances by.
+     *
+     * @return The distance from each pixel to the closest pixel equal to 255,
+     * times `scale`, in the same layout as `image`.  Pixels are infinitely far
+     * away if there are no such pixels.
+     *
+     * @throw std::invalid_argument If the width or height isn't positive or
+     * doesn't match the size of the image.
+     */
+    std::vector<float> distance_transform_cpu(
+        std::span<const std::uint8_t> image,
+        int width,
+        int height,
+        double scale = 1.0
+    );
+    /** @brief Computes the exact Euclidean distance transforms of several
+     * parts of an image on the CPU.
+     *
+     * Like the overload of @ref distance_transform that takes regions, each
+     * pixel in a region gets the distance to the closest pixel equal to 255
+     * in the same region, and pixels that aren't in any region are infinitely
+     * far away.
+     *
+     * @throw std::invalid_argument If the image size is wrong or the regions
+     * overlap or aren't inside of the image.
+     */
+    std::vector<float> distance_transform_cpu(
+        std::span<const std::uint8_t> image,
+        int width,
+        int height,
+        std::span<const DistanceTransformRegion> regions,
+        double scale = 1.0
+    );
 }
 
 #endif
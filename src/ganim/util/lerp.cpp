@@ -0,0 +1,124 @@
+#include "lerp.hpp"
+
+#include <cstddef>
+#include <format>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GANIM_LERP_X86
+#endif
+
+#include "parallel_for.hpp"
+
+namespace {
+    // Interpolating is so cheap that a chunk has to be pretty big before the
+    // cost of starting a thread is worth it
+    constexpr std::size_t min_parallel_chunk = 1 << 18;
+
+    using LerpKernel = void(*)(
+        const float* start,
+        const float* end,
+        float* output,
+        std::size_t size,
+        float t
+    );
+
+    void lerp_scalar(
+        const float* start,
+        const float* end,
+        float* output,
+        std::size_t size,
+        float t
+    )
+    {
+        const float s = 1 - t;
+        for (std::size_t i = 0; i < size; ++i) {
+            output[i] = s * start[i] + t * end[i];
+        }
+    }
+
+#ifdef GANIM_LERP_X86
+    // SSE2 is part of x86-64, so this can always be used there
+    __attribute__((target("sse2")))
+    void lerp_sse(
+        const float* start,
+        const float* end,
+        float* output,
+        std::size_t size,
+        float t
+    )
+    {
+        const auto s4 = _mm_set1_ps(1 - t);
+        const auto t4 = _mm_set1_ps(t);
+        std::size_t i = 0;
+        for (; i + 4 <= size; i += 4) {
+            auto a = _mm_loadu_ps(start + i);
+            auto b = _mm_loadu_ps(end + i);
+            _mm_storeu_ps(output + i,
+                    _mm_add_ps(_mm_mul_ps(s4, a), _mm_mul_ps(t4, b)));
+        }
+        lerp_scalar(start + i, end + i, output + i, size - i, t);
+    }
+
+    __attribute__((target("avx2")))
+    void lerp_avx2(
+        const float* start,
+        const float* end,
+        float* output,
+        std::size_t size,
+        float t
+    )
+    {
+        const auto s8 = _mm256_set1_ps(1 - t);
+        const auto t8 = _mm256_set1_ps(t);
+        std::size_t i = 0;
+        // Two vectors per iteration to hide the latency of the loads
+        for (; i + 16 <= size; i += 16) {
+            auto a1 = _mm256_loadu_ps(start + i);
+            auto b1 = _mm256_loadu_ps(end + i);
+            auto a2 = _mm256_loadu_ps(start + i + 8);
+            auto b2 = _mm256_loadu_ps(end + i + 8);
+            auto r1 = _mm256_add_ps(_mm256_mul_ps(s8, a1),
+                                    _mm256_mul_ps(t8, b1));
+            auto r2 = _mm256_add_ps(_mm256_mul_ps(s8, a2),
+                                    _mm256_mul_ps(t8, b2));
+            _mm256_storeu_ps(output + i, r1);
+            _mm256_storeu_ps(output + i + 8, r2);
+        }
+        lerp_sse(start + i, end + i, output + i, size - i, t);
+    }
+#endif
+
+    LerpKernel choose_kernel()
+    {
+#ifdef GANIM_LERP_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return lerp_avx2;
+        if (__builtin_cpu_supports("sse2")) return lerp_sse;
+#endif
+        return lerp_scalar;
+    }
+}
+
+void ganim::lerp_floats(
+    std::span<const float> start,
+    std::span<const float> end,
+    std::span<float> output,
+    float t
+)
+{
+    if (start.size() != end.size() or start.size() != output.size()) {
+        throw std::invalid_argument(std::format(
+            "Attempted to interpolate arrays of different sizes ({}, {}, and "
+            "{}).", start.size(), end.size(), output.size()
+        ));
+    }
+    static const auto kernel = choose_kernel();
+    parallel_for(start.size(), min_parallel_chunk,
+        [&](std::size_t begin, std::size_t end_index) {
+            kernel(start.data() + begin, end.data() + begin,
+                   output.data() + begin, end_index - begin, t);
+        }
+    );
+}
@@ -0,0 +1,29 @@
+#ifndef GANIM_UTIL_LERP_HPP
+#define GANIM_UTIL_LERP_HPP
+
+#include <span>
+
+namespace ganim {
+
+/** @brief Linearly interpolate two arrays of floats
+ *
+ * This calculates `output[i] = (1 - t)*start[i] + t*end[i]` for every element,
+ * using AVX2 or SSE when the CPU supports it.  Arrays large enough to benefit
+ * from it are also split across several threads.  Because of the way it's
+ * calculated, `t == 0` gives exactly `start` and `t == 1` gives exactly `end`.
+ *
+ * `output` may be the same array as `start` or `end`, but it can't partially
+ * overlap them.
+ *
+ * @throws std::invalid_argument If the three arrays don't have the same size.
+ */
+void lerp_floats(
+    std::span<const float> start,
+    std::span<const float> end,
+    std::span<float> output,
+    float t
+);
+
+}
+
+#endif
@@ -0,0 +1,30 @@
+#include "parallel_for.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+void ganim::parallel_for(
+    std::size_t count,
+    std::size_t min_chunk,
+    const std::function<void(std::size_t, std::size_t)>& f
+)
+{
+    if (count == 0) return;
+    const auto hardware = std::max(std::thread::hardware_concurrency(), 1U);
+    const auto chunks = std::clamp<std::size_t>(
+        count / std::max<std::size_t>(min_chunk, 1), 1, hardware);
+    if (chunks == 1) {
+        f(0, count);
+        return;
+    }
+    const auto chunk_size = (count + chunks - 1) / chunks;
+    auto threads = std::vector<std::jthread>();
+    threads.reserve(chunks - 1);
+    // The last chunk is done on this thread so that it isn't just waiting
+    for (std::size_t begin = 0; begin + chunk_size < count;
+            begin += chunk_size) {
+        threads.emplace_back(f, begin, begin + chunk_size);
+    }
+    f(threads.size() * chunk_size, count);
+}
@@ -0,0 +1,30 @@
+#ifndef GANIM_UTIL_PARALLEL_FOR_HPP
+#define GANIM_UTIL_PARALLEL_FOR_HPP
+
+#include <cstddef>
+#include <functional>
+
+namespace ganim {
+
+/** @brief Split a range into chunks and process them on several threads
+ *
+ * The range `[0, count)` is split into at most one chunk per hardware thread,
+ * with each chunk containing at least `min_chunk` elements, and `f` is called
+ * once per chunk with the beginning and end of that chunk.  If there would only
+ * be one chunk, `f` is called on the current thread.  This function returns
+ * once every chunk has been processed.
+ *
+ * @param count The size of the range to process.
+ * @param min_chunk The smallest chunk worth giving to another thread.
+ * @param f The function to call on each chunk.  It must be safe to call it on
+ * several threads at once with different chunks.
+ */
+void parallel_for(
+    std::size_t count,
+    std::size_t min_chunk,
+    const std::function<void(std::size_t, std::size_t)>& f
+);
+
+}
+
+#endif
@@ -0,0 +1,111 @@
+#include "concatenate.hpp"
+
+#include "libav.h"
+
+#include <format>
+#include <limits>
+#include <stdexcept>
+
+using namespace ganim;
+
+namespace {
+    void check(int error, std::string_view message, const std::string& file)
+    {
+        if (error < 0) {
+            throw std::runtime_error(std::format("{} {}", message, file));
+        }
+    }
+}
+
+void ganim::concatenate_videos(
+    const std::vector<VideoSegment>& segments,
+    const std::string& output,
+    int fps
+)
+{
+    if (segments.empty()) {
+        throw std::invalid_argument(
+            "No segments passed to concatenate_videos");
+    }
+    AVFormatContext* out_context = nullptr;
+    AVFormatContext* in_context = nullptr;
+    AVPacket* packet = av_packet_alloc();
+    auto clean_up = [&]{
+        if (in_context) avformat_close_input(&in_context);
+        if (out_context) {
+            if (out_context->pb) avio_closep(&out_context->pb);
+            avformat_free_context(out_context);
+            out_context = nullptr;
+        }
+        av_packet_free(&packet);
+    };
+    try {
+        check(avformat_alloc_output_context2(
+            &out_context, nullptr, nullptr, output.c_str()),
+            "Unable to create output context for", output);
+        AVStream* out_stream = nullptr;
+        auto last_dts = std::numeric_limits<std::int64_t>::min();
+        for (auto& segment : segments) {
+            check(avformat_open_input(
+                &in_context, segment.filename.c_str(), nullptr, nullptr),
+                "Unable to open video segment", segment.filename);
+            check(avformat_find_stream_info(in_context, nullptr),
+                "Unable to read video segment", segment.filename);
+            if (in_context->nb_streams < 1) {
+                throw std::runtime_error(std::format(
+                    "Video segment {} has no streams", segment.filename));
+            }
+            auto in_stream = in_context->streams[0];
+            if (!out_stream) {
+                out_stream = avformat_new_stream(out_context, nullptr);
+                if (!out_stream) {
+                    throw std::runtime_error("Unable to create stream");
+                }
+                check(avcodec_parameters_copy(
+                    out_stream->codecpar, in_stream->codecpar),
+                    "Unable to copy the codec parameters of",
+                    segment.filename);
+                out_stream->codecpar->codec_tag = 0;
+                out_stream->time_base = in_stream->time_base;
+                check(avio_open(
+                    &out_context->pb, output.c_str(), AVIO_FLAG_WRITE),
+                    "Unable to open file", output);
+                check(avformat_write_header(out_context, nullptr),
+                    "Unable to write header to", output);
+            }
+            auto offset = av_rescale_q(
+                segment.start_frame, AVRational(1, fps), in_stream->time_base);
+            while (av_read_frame(in_context, packet) >= 0) {
+                if (packet->stream_index != 0) {
+                    av_packet_unref(packet);
+                    continue;
+                }
+                if (packet->pts != AV_NOPTS_VALUE) packet->pts += offset;
+                if (packet->dts != AV_NOPTS_VALUE) packet->dts += offset;
+                av_packet_rescale_ts(
+                    packet, in_stream->time_base, out_stream->time_base);
+                // With B-frames, each segment's first decode timestamps are
+                // before its first frame, which can overlap with the end of
+                // the previous segment.
+                if (packet->dts != AV_NOPTS_VALUE) {
+                    if (packet->dts <= last_dts) packet->dts = last_dts + 1;
+                    if (packet->pts != AV_NOPTS_VALUE and
+                            packet->pts < packet->dts) {
+                        packet->pts = packet->dts;
+                    }
+                    last_dts = packet->dts;
+                }
+                packet->stream_index = out_stream->index;
+                check(av_interleaved_write_frame(out_context, packet),
+                    "Unable to write packet to", output);
+            }
+            avformat_close_input(&in_context);
+        }
+        check(av_write_trailer(out_context), "Unable to finish", output);
+    }
+    catch (...) {
+        clean_up();
+        throw;
+    }
+    clean_up();
+}
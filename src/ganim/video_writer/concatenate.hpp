@@ -0,0 +1,43 @@
+#ifndef GANIM_VIDEO_WRITER_CONCATENATE_HPP
+#define GANIM_VIDEO_WRITER_CONCATENATE_HPP
+
+/** @file
+ * @brief The @ref ganim::concatenate_videos "concatenate_videos" function.
+ */
+
+#include <string>
+#include <vector>
+
+namespace ganim {
+    /** @brief A piece of a video that was written separately. */
+    struct VideoSegment {
+        /** @brief The file that this segment was written to. */
+        std::string filename;
+        /** @brief The frame in the final video that this segment starts on.
+         */
+        int start_frame = 0;
+    };
+
+    /** @brief Join several video files into one without re-encoding them.
+     *
+     * The packets of each segment are copied into the output file with their
+     * timestamps shifted so that each segment starts on its start frame.  For
+     * this to work, all of the segments must have been encoded with the same
+     * settings and must each start on a keyframe, which is always the case for
+     * files written by separate @ref VideoWriter "VideoWriters".
+     *
+     * @param segments The segments to join, in order.
+     * @param output The filename of the joined video, including the extension.
+     * @param fps The framerate of the segments.
+     * @throw std::invalid_argument If there are no segments.
+     * @throw std::runtime_error If a segment can't be read or the output
+     * can't be written.
+     */
+    void concatenate_videos(
+        const std::vector<VideoSegment>& segments,
+        const std::string& output,
+        int fps
+    );
+}
+
+#endif
@@ -0,0 +1,137 @@
+#include "frame_sink.hpp"
+
+#include <format>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+
+#include "image_sequence_writer.hpp"
+#include "video_writer.hpp"
+
+using namespace ganim;
+
+namespace {
+    std::optional<ImageFormat> image_format(const std::string& filename)
+    {
+        if (filename.ends_with(".png")) return ImageFormat::PNG;
+        if (filename.ends_with(".qoi")) return ImageFormat::QOI;
+        if (filename.ends_with(".rgb")) return ImageFormat::Raw;
+        return std::nullopt;
+    }
+}
+
+void FrameSink::check_frame(
+    std::span<std::uint8_t> image,
+    int count,
+    int width,
+    int height,
+    const char* name
+) const
+{
+    if (ssize(image) != width * height * 3) {
+        throw std::invalid_argument(std::format(
+            "The image passed to {}::write_frame has an incorrect size.",
+            name));
+    }
+    if (count < 1) {
+        throw std::invalid_argument(std::format(
+            "The count passed to {}::write_frame must be positive.", name));
+    }
+}
+
+void NullFrameSink::write_frame(std::span<std::uint8_t>, int count)
+{
+    if (count < 1) {
+        throw std::invalid_argument(
+            "The count passed to NullFrameSink::write_frame must be "
+            "positive.");
+    }
+    M_frame_count += count;
+}
+
+RawStreamWriter::RawStreamWriter(std::string path, int width, int height)
+:   M_path(std::move(path)),
+    M_width(width),
+    M_height(height)
+{
+    M_file = M_path == "-" ? stdout : std::fopen(M_path.c_str(), "wb");
+    if (!M_file) {
+        throw std::runtime_error(std::format(
+            "Unable to open {} for writing frames", M_path));
+    }
+}
+
+RawStreamWriter::~RawStreamWriter()
+{
+    try {
+        finish();
+    }
+    catch (std::exception& e) {
+        std::cerr << "Error while finishing raw stream: " << e.what() << "\n";
+    }
+}
+
+void RawStreamWriter::write_frame(std::span<std::uint8_t> image, int count)
+{
+    if (!M_file) {
+        throw std::logic_error(
+            "Trying to write a frame to an already finished RawStreamWriter");
+    }
+    check_frame(image, count, M_width, M_height, "RawStreamWriter");
+    for (int i = 0; i < count; ++i) {
+        if (std::fwrite(image.data(), 1, image.size(), M_file)
+                != image.size()) {
+            throw std::runtime_error(std::format(
+                "Unable to write a frame to {}", M_path));
+        }
+    }
+}
+
+void RawStreamWriter::finish()
+{
+    if (!M_file) return;
+    auto file = M_file;
+    M_file = nullptr;
+    auto error = file == stdout ? std::fflush(file) : std::fclose(file);
+    if (error) {
+        throw std::runtime_error(std::format(
+            "Unable to finish writing frames to {}", M_path));
+    }
+}
+
+std::unique_ptr<FrameSink> ganim::make_frame_sink(
+    const std::string& filename,
+    int width,
+    int height,
+    int fps,
+    const VideoWriterOptions& options,
+    int first_frame
+)
+{
+    if (filename == "null") return std::make_unique<NullFrameSink>();
+    if (filename == "-") {
+        return std::make_unique<RawStreamWriter>(filename, width, height);
+    }
+    if (filename.starts_with("pipe:")) {
+        return std::make_unique<RawStreamWriter>(
+            filename.substr(5), width, height);
+    }
+    if (auto format = image_format(filename)) {
+        return std::make_unique<ImageSequenceWriter>(
+            filename, width, height, *format, first_frame,
+            options.worker_threads, options.queue_size);
+    }
+    return std::make_unique<VideoWriter>(
+        filename, width, height, fps, options);
+}
+
+bool ganim::is_video_filename(const std::string& filename)
+{
+    return filename != "null" and !is_raw_stream_filename(filename)
+        and !image_format(filename);
+}
+
+bool ganim::is_raw_stream_filename(const std::string& filename)
+{
+    return filename == "-" or filename.starts_with("pipe:");
+}
@@ -0,0 +1,173 @@
+#ifndef GANIM_VIDEO_WRITER_FRAME_SINK_HPP
+#define GANIM_VIDEO_WRITER_FRAME_SINK_HPP
+
+/** @file
+ * @brief The @ref ganim::FrameSink "FrameSink" class and its simplest
+ * subclasses.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace ganim {
+    struct VideoWriterOptions;
+
+    /** @brief Somewhere that the frames of a scene are sent.
+     *
+     * Frames are always RGB data with three bytes per pixel, starting at the
+     * top row.  See @ref make_frame_sink for how a @ref Scene picks which
+     * kind of sink to use.
+     */
+    class FrameSink {
+        public:
+            virtual ~FrameSink()=default;
+            /** @brief Write a frame.
+             *
+             * @param image The data for a frame.  `image.size()` must be
+             * equal to `width * height * 3`.
+             * @param count The number of times in a row to write the frame.
+             * @throw std::invalid_argument When the image has the wrong size
+             * or the count isn't positive.
+             */
+            virtual void write_frame(
+                std::span<std::uint8_t> image,
+                int count = 1
+            )=0;
+            /** @brief Finish writing every frame.
+             *
+             * Sinks call this in their destructors, so you only need to call
+             * it to find out about errors or to make sure that the output is
+             * complete earlier.
+             */
+            virtual void finish()=0;
+            /** @brief Set the number of the next frame that is written.
+             *
+             * Frames are numbered one after another by default.  Only sinks
+             * that name their output after the frame number, like @ref
+             * ImageSequenceWriter, use this, so by default it does nothing.
+             */
+            virtual void set_frame_number(int) {}
+
+        protected:
+            void check_frame(
+                std::span<std::uint8_t> image,
+                int count,
+                int width,
+                int height,
+                const char* name
+            ) const;
+    };
+
+    /** @brief A sink that throws every frame away.
+     *
+     * This is useful to measure how fast a scene can be drawn without
+     * encoding getting in the way.
+     */
+    class NullFrameSink : public FrameSink {
+        public:
+            virtual void write_frame(
+                std::span<std::uint8_t> image,
+                int count = 1
+            ) override;
+            virtual void finish() override {}
+            /** @brief Get the number of frames written so far. */
+            std::int64_t get_frame_count() const {return M_frame_count;}
+
+        private:
+            std::int64_t M_frame_count = 0;
+    };
+
+    /** @brief A sink that writes raw RGB frames one after another.
+     *
+     * There is no header or anything else in between the frames, so the
+     * output can be read by, for example, `ffmpeg -f rawvideo -pix_fmt rgb24
+     * -s WIDTHxHEIGHT -r FPS -i PATH`.  Writing to a named pipe lets another
+     * program encode the frames while they are being drawn.  Frames are
+     * written synchronously, so a slow reader slows the scene down instead of
+     * frames piling up in memory.
+     */
+    class RawStreamWriter : public FrameSink {
+        public:
+            /** @brief Constructor.
+             *
+             * @param path The file or named pipe to write to, or "-" to write
+             * to standard output.  Opening a named pipe waits until
+             * something opens it for reading.
+             * @param width The width of each frame.
+             * @param height The height of each frame.
+             * @throw std::runtime_error If the file can't be opened.
+             */
+            RawStreamWriter(std::string path, int width, int height);
+            virtual ~RawStreamWriter();
+            RawStreamWriter(const RawStreamWriter&)=delete;
+            RawStreamWriter& operator=(const RawStreamWriter&)=delete;
+
+            /** @copydoc FrameSink::write_frame
+             *
+             * @throw std::runtime_error If the frame can't be written, for
+             * example because the reader closed the pipe.
+             */
+            virtual void write_frame(
+                std::span<std::uint8_t> image,
+                int count = 1
+            ) override;
+            virtual void finish() override;
+
+        private:
+            std::string M_path;
+            std::FILE* M_file = nullptr;
+            int M_width = 0;
+            int M_height = 0;
+    };
+
+    /** @brief Make the sink that a scene writes to, based on the filename.
+     *
+     * - "null" makes a @ref NullFrameSink.
+     * - "-" makes a @ref RawStreamWriter that writes to standard output.
+     * - "pipe:PATH" makes a @ref RawStreamWriter that writes to PATH.
+     * - Filenames ending in ".png", ".qoi", or ".rgb" (raw RGB without
+     *   alpha, see @ref ImageFormat::Raw) make an @ref
+     *   ImageSequenceWriter that writes one file per frame, numbered starting
+     *   at `first_frame`.  For example, frame 12 of "out/scene.png" is written
+     *   to "out/scene.000012.png".
+     * - Anything else makes a @ref VideoWriter.
+     *
+     * Scenes number the images in an image sequence by the frame of the
+     * scene that they come from (see @ref FrameSink::set_frame_number), so
+     * frames skipped with @ref SceneBase::stop_animating leave gaps in the
+     * numbers.
+     *
+     * @param filename Where to write the frames.
+     * @param width The width of each frame.
+     * @param height The height of each frame.
+     * @param fps The framerate of the frames.
+     * @param options The settings for video files.  For image sequences,
+     * @ref VideoWriterOptions::worker_threads and @ref
+     * VideoWriterOptions::queue_size are used for the threads that encode the
+     * images.
+     * @param first_frame The number of the first image in an image sequence.
+     */
+    std::unique_ptr<FrameSink> make_frame_sink(
+        const std::string& filename,
+        int width,
+        int height,
+        int fps,
+        const VideoWriterOptions& options,
+        int first_frame = 0
+    );
+
+    /** @brief Get whether @ref make_frame_sink makes a @ref VideoWriter for
+     * a filename.
+     */
+    bool is_video_filename(const std::string& filename);
+
+    /** @brief Get whether @ref make_frame_sink makes a @ref RawStreamWriter
+     * for a filename.
+     */
+    bool is_raw_stream_filename(const std::string& filename);
+}
+
+#endif
@@ -0,0 +1,327 @@
+#include "image_sequence_writer.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "ganim/util/stb_image_write.h"
+
+using namespace ganim;
+
+namespace {
+    struct Job {
+        std::vector<std::uint8_t> rgb;
+        int frame = 0;
+        int count = 1;
+    };
+
+    void append_u32(std::string& out, std::uint32_t value)
+    {
+        out += static_cast<char>(value >> 24);
+        out += static_cast<char>(value >> 16);
+        out += static_cast<char>(value >> 8);
+        out += static_cast<char>(value);
+    }
+}
+
+/// @private
+struct ImageSequenceWriter::Impl {
+    std::filesystem::path directory;
+    std::string stem;
+    std::string extension;
+    int width = 0;
+    int height = 0;
+    ImageFormat format = ImageFormat::PNG;
+    int next_frame = 0;
+    std::size_t queue_size = 0;
+
+    // Everything below is only used when there are worker threads
+    std::vector<std::thread> workers;
+    std::deque<Job> queue;
+    std::vector<std::vector<std::uint8_t>> free_buffers;
+    std::mutex mutex;
+    std::condition_variable job_added;
+    std::condition_variable job_taken;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    std::string filename(int frame) const;
+    std::string encode(std::span<const std::uint8_t> image) const;
+    void write(std::span<const std::uint8_t> image, int frame, int count);
+    void run_worker();
+    void stop_threads();
+};
+
+std::string ImageSequenceWriter::Impl::filename(int frame) const
+{
+    return (directory / std::format("{}.{:06}{}", stem, frame, extension))
+        .string();
+}
+
+std::string ImageSequenceWriter::Impl::encode(
+    std::span<const std::uint8_t> image
+) const
+{
+    switch (format) {
+        case ImageFormat::PNG: {
+            auto result = std::string();
+            auto success = stbi_write_png_to_func(
+                [](void* context, void* data, int size) {
+                    static_cast<std::string*>(context)->append(
+                        static_cast<const char*>(data), size);
+                },
+                &result, width, height, 3, image.data(), width * 3
+            );
+            if (!success) {
+                throw std::runtime_error("Unable to encode PNG image");
+            }
+            return result;
+        }
+        case ImageFormat::QOI:
+            return encode_qoi(image, width, height);
+        case ImageFormat::Raw:
+            break;
+    }
+    return std::string(image.begin(), image.end());
+}
+
+void ImageSequenceWriter::Impl::write(
+    std::span<const std::uint8_t> image,
+    int frame,
+    int count
+)
+{
+    auto data = encode(image);
+    for (int i = 0; i < count; ++i) {
+        auto name = filename(frame + i);
+        auto file = std::ofstream(name, std::ios::binary);
+        file.write(data.data(), data.size());
+        if (!file) {
+            throw std::runtime_error(std::format(
+                "Unable to write image {}", name));
+        }
+    }
+}
+
+void ImageSequenceWriter::Impl::run_worker()
+{
+    auto lock = std::unique_lock(mutex);
+    while (true) {
+        job_added.wait(lock, [&]{return stopping or !queue.empty();});
+        if (queue.empty()) break;
+        auto job = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        job_taken.notify_one();
+        auto new_error = std::exception_ptr();
+        try {
+            write(job.rgb, job.frame, job.count);
+        }
+        catch (...) {
+            new_error = std::current_exception();
+        }
+        lock.lock();
+        if (new_error and !error) error = new_error;
+        free_buffers.push_back(std::move(job.rgb));
+        job_taken.notify_one();
+    }
+}
+
+void ImageSequenceWriter::Impl::stop_threads()
+{
+    {
+        auto lock = std::lock_guard(mutex);
+        stopping = true;
+    }
+    job_added.notify_all();
+    for (auto& thread : workers) thread.join();
+    workers.clear();
+}
+
+ImageSequenceWriter::ImageSequenceWriter(
+    std::string filename,
+    int width,
+    int height,
+    ImageFormat format,
+    int first_frame,
+    int threads,
+    int queue_size
+) :
+    M_impl(std::make_unique<Impl>())
+{
+    if (threads < 0) {
+        throw std::invalid_argument(
+            "Negative number of threads passed to ImageSequenceWriter");
+    }
+    if (threads > 0 and queue_size < 1) {
+        throw std::invalid_argument(
+            "The queue size passed to ImageSequenceWriter must be positive");
+    }
+    auto path = std::filesystem::path(filename);
+    M_impl->directory = path.parent_path();
+    if (!M_impl->directory.empty()) {
+        std::filesystem::create_directories(M_impl->directory);
+    }
+    M_impl->stem = path.stem().string();
+    M_impl->extension = path.extension().string();
+    M_impl->width = width;
+    M_impl->height = height;
+    M_impl->format = format;
+    M_impl->next_frame = first_frame;
+    M_impl->queue_size = queue_size;
+    auto impl = M_impl.get();
+    for (int i = 0; i < threads; ++i) {
+        M_impl->workers.emplace_back([impl]{impl->run_worker();});
+    }
+}
+
+ImageSequenceWriter::~ImageSequenceWriter()
+{
+    try {
+        finish();
+    }
+    catch (std::exception& e) {
+        std::cerr << "Error while finishing image sequence: " << e.what()
+                  << "\n";
+    }
+}
+
+std::string ImageSequenceWriter::get_image_filename(int frame) const
+{
+    if (!M_impl) {
+        throw std::logic_error(
+            "Trying to use an already finished ImageSequenceWriter");
+    }
+    return M_impl->filename(frame);
+}
+
+void ImageSequenceWriter::set_frame_number(int frame)
+{
+    if (!M_impl) {
+        throw std::logic_error(
+            "Trying to use an already finished ImageSequenceWriter");
+    }
+    M_impl->next_frame = frame;
+}
+
+void ImageSequenceWriter::write_frame(std::span<std::uint8_t> image, int count)
+{
+    if (!M_impl) {
+        throw std::logic_error(
+            "Trying to write a frame to an already finished "
+            "ImageSequenceWriter");
+    }
+    auto& impl = *M_impl;
+    check_frame(image, count, impl.width, impl.height, "ImageSequenceWriter");
+    auto frame = impl.next_frame;
+    impl.next_frame += count;
+    if (impl.workers.empty()) {
+        impl.write(image, frame, count);
+        return;
+    }
+
+    auto lock = std::unique_lock(impl.mutex);
+    impl.job_taken.wait(lock, [&]{
+        return impl.error or impl.queue.size() < impl.queue_size;
+    });
+    if (impl.error) std::rethrow_exception(impl.error);
+    auto job = Job();
+    if (!impl.free_buffers.empty()) {
+        job.rgb = std::move(impl.free_buffers.back());
+        impl.free_buffers.pop_back();
+    }
+    lock.unlock();
+    job.rgb.assign(image.begin(), image.end());
+    job.frame = frame;
+    job.count = count;
+    lock.lock();
+    impl.queue.push_back(std::move(job));
+    lock.unlock();
+    impl.job_added.notify_one();
+}
+
+void ImageSequenceWriter::finish()
+{
+    if (!M_impl) return;
+    auto impl = std::move(M_impl);
+    impl->stop_threads();
+    if (impl->error) std::rethrow_exception(impl->error);
+}
+
+std::string ganim::encode_qoi(
+    std::span<const std::uint8_t> image,
+    int width,
+    int height
+)
+{
+    struct Pixel {
+        std::uint8_t r = 0, g = 0, b = 0, a = 0;
+        bool operator==(const Pixel&) const=default;
+    };
+    auto result = std::string("qoif");
+    append_u32(result, width);
+    append_u32(result, height);
+    result += char(3);
+    result += char(0);
+
+    Pixel index[64] = {};
+    auto previous = Pixel{0, 0, 0, 255};
+    auto run = 0;
+    const auto pixel_count = std::size_t(width) * height;
+    for (std::size_t i = 0; i < pixel_count; ++i) {
+        auto pixel = Pixel{image[3*i], image[3*i + 1], image[3*i + 2], 255};
+        if (pixel == previous) {
+            ++run;
+            if (run == 62 or i + 1 == pixel_count) {
+                result += static_cast<char>(0xc0 | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            result += static_cast<char>(0xc0 | (run - 1));
+            run = 0;
+        }
+        auto hash = (pixel.r*3 + pixel.g*5 + pixel.b*7 + pixel.a*11) % 64;
+        if (index[hash] == pixel) {
+            result += static_cast<char>(hash);
+        }
+        else {
+            index[hash] = pixel;
+            // The differences wrap around, so they need to be 8-bit
+            auto dr = static_cast<std::int8_t>(pixel.r - previous.r);
+            auto dg = static_cast<std::int8_t>(pixel.g - previous.g);
+            auto db = static_cast<std::int8_t>(pixel.b - previous.b);
+            auto dr_dg = dr - dg;
+            auto db_dg = db - dg;
+            if (dr >= -2 and dr <= 1 and dg >= -2 and dg <= 1 and
+                    db >= -2 and db <= 1) {
+                result += static_cast<char>(
+                    0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+            }
+            else if (dg >= -32 and dg <= 31 and dr_dg >= -8 and dr_dg <= 7
+                    and db_dg >= -8 and db_dg <= 7) {
+                result += static_cast<char>(0x80 | (dg + 32));
+                result += static_cast<char>((dr_dg + 8) << 4 | (db_dg + 8));
+            }
+            else {
+                result += static_cast<char>(0xfe);
+                result += static_cast<char>(pixel.r);
+                result += static_cast<char>(pixel.g);
+                result += static_cast<char>(pixel.b);
+            }
+        }
+        previous = pixel;
+    }
+    result.append(7, char(0));
+    result += char(1);
+    return result;
+}
@@ -0,0 +1,128 @@
+#ifndef GANIM_VIDEO_WRITER_IMAGE_SEQUENCE_WRITER_HPP
+#define GANIM_VIDEO_WRITER_IMAGE_SEQUENCE_WRITER_HPP
+
+/** @file
+ * @brief The @ref ganim::ImageSequenceWriter "ImageSequenceWriter" class.
+ */
+
+#include <memory>
+#include <string>
+
+#include "frame_sink.hpp"
+
+namespace ganim {
+    /** @brief The file format of each image in an image sequence. */
+    enum class ImageFormat {
+        /** @brief Compressed PNG files.  These are the smallest, but they
+         * are the slowest to write.
+         */
+        PNG,
+        /** @brief QOI files, which compress almost as well as PNG for the
+         * flat colors that ganim usually draws but are much faster to write.
+         */
+        QOI,
+        /** @brief The raw data with no header.
+         *
+         * Each pixel is three bytes of RGB with no alpha, since that's what
+         * scenes give to their sinks.  A file can be read with, for example,
+         * `ffmpeg -f rawvideo -pix_fmt rgb24 -s WIDTHxHEIGHT -i FILE`.
+         */
+        Raw
+    };
+
+    /** @brief A sink that writes each frame to its own numbered image file.
+     *
+     * Because every frame is its own file, an image sequence can be encoded
+     * separately later, and a render that crashed can be resumed by only
+     * rendering the frames whose files are missing (see @ref RenderWindow).
+     *
+     * The images are encoded and written on a pool of worker threads.  Like
+     * with @ref VideoWriter, frames are copied into a bounded queue, so the
+     * caller only waits when the queue is full, and any error that happens on
+     * a worker thread is rethrown by the next call to @ref write_frame or
+     * @ref finish.
+     */
+    class ImageSequenceWriter : public FrameSink {
+        public:
+            /** @brief Constructor.
+             *
+             * @param filename The filename of the images without the frame
+             * number.  The frame number is put before the extension, so
+             * frame 12 of "scene.png" is written to "scene.000012.png".  The
+             * extension isn't changed to match the format.  The directory is
+             * made if it doesn't exist yet.
+             * @param width The width of each image.
+             * @param height The height of each image.
+             * @param format The file format of each image.
+             * @param first_frame The number of the first image.
+             * @param threads The number of threads used to encode and write
+             * images.  If this is zero, each image is written before @ref
+             * write_frame returns.
+             * @param queue_size The maximum number of frames that can be
+             * waiting to be written when using threads.
+             * @throw std::invalid_argument If the number of threads is
+             * negative or the queue size isn't positive.
+             */
+            ImageSequenceWriter(
+                std::string filename,
+                int width,
+                int height,
+                ImageFormat format,
+                int first_frame = 0,
+                int threads = 1,
+                int queue_size = 8
+            );
+            /** @brief Destructor.
+             *
+             * This calls @ref finish if it hasn't been called already.
+             */
+            virtual ~ImageSequenceWriter();
+            ImageSequenceWriter(const ImageSequenceWriter&)=delete;
+            ImageSequenceWriter& operator=(const ImageSequenceWriter&)=delete;
+
+            /** @copydoc FrameSink::write_frame
+             *
+             * Each copy of a repeated frame gets its own file, but the image
+             * is only encoded once.
+             *
+             * @throw std::runtime_error When writing a previous frame on a
+             * worker thread failed.
+             */
+            virtual void write_frame(
+                std::span<std::uint8_t> image,
+                int count = 1
+            ) override;
+            /** @brief Wait for every image to be written.
+             *
+             * @throw std::runtime_error If any image couldn't be written.
+             */
+            virtual void finish() override;
+            /** @brief Set the number of the next image that is written.
+             *
+             * Images after that are numbered one after another again.
+             */
+            virtual void set_frame_number(int frame) override;
+
+            /** @brief Get the filename of one of the images. */
+            std::string get_image_filename(int frame) const;
+
+        private:
+            class Impl;
+            std::unique_ptr<Impl> M_impl;
+    };
+
+    /** @brief Encode an RGB image as a QOI file.
+     *
+     * @param image The RGB data, starting at the top row.
+     * @param width The width of the image.
+     * @param height The height of the image.
+     * @return The contents of the file.
+     */
+    std::string encode_qoi(
+        std::span<const std::uint8_t> image,
+        int width,
+        int height
+    );
+}
+
+#endif
@@ -2,30 +2,261 @@
 
 #include "libav.h"
 
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <format>
 #include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 using namespace ganim;
 
+namespace {
+    /* A frame that has been queued by write_frame.  The RGB buffer and the
+     * AVFrame are allocated once and reused for every frame that passes through
+     * this slot.
+     */
+    struct FrameSlot {
+        enum State {Free, Filled, Converting, Converted};
+        std::unique_ptr<std::uint8_t[]> rgb;
+        AVFrame* frame = nullptr;
+        std::int64_t index = 0;
+        int count = 1;
+        State state = Free;
+    };
+}
+
 /// @private
 struct VideoWriter::Impl {
     int width = 0;
     int height = 0;
     int fps = 0;
     int frame = 0;
+    AVPixelFormat pixel_format = AV_PIX_FMT_YUV420P;
     const AVOutputFormat* oformat = nullptr;
     AVFormatContext* fcontext = nullptr;
     AVCodecContext* ccontext = nullptr;
     SwsContext* sws_context = nullptr;
     AVFrame* video_frame = nullptr;
     AVPacket* packet = nullptr;
+
+    // Everything below is only used when there are worker threads
+    std::vector<FrameSlot> slots;
+    std::deque<FrameSlot*> conversion_queue;
+    std::vector<std::thread> converters;
+    std::thread encoder;
+    std::mutex mutex;
+    std::condition_variable slot_freed;
+    std::condition_variable frame_filled;
+    std::condition_variable frame_converted;
+    std::int64_t next_index = 0;
+    std::int64_t next_encode = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    AVFrame* allocate_frame();
+    void encode(AVFrame* frame);
+    void receive_packets();
+    void convert(std::uint8_t* data, AVFrame* frame, SwsContext* context);
+    void run_converter();
+    void run_encoder();
+    void stop_threads();
+    void rethrow_error();
+    void set_error(std::exception_ptr new_error);
+    void free_resources();
 };
 
-VideoWriter::VideoWriter(std::string filename, int width, int height, int fps) :
+AVFrame* VideoWriter::Impl::allocate_frame()
+{
+    auto result = av_frame_alloc();
+    result->format = pixel_format;
+    result->width = width;
+    result->height = height;
+    auto error = av_frame_get_buffer(result, 32);
+    if (error < 0) {
+        av_frame_free(&result);
+        throw std::runtime_error("Unable to allocate frame");
+    }
+    return result;
+}
+
+void VideoWriter::Impl::convert(
+    std::uint8_t* data,
+    AVFrame* frame,
+    SwsContext* context
+)
+{
+    // The encoder might still be holding a reference to this frame's buffers
+    if (av_frame_make_writable(frame) < 0) {
+        throw std::runtime_error("Unable to make frame writable");
+    }
+    int linesize = 3*width;
+    sws_scale(context, &data, &linesize, 0, height,
+            frame->data, frame->linesize);
+}
+
+void VideoWriter::Impl::encode(AVFrame* frame)
+{
+    // I honestly have no idea where the 90000 comes from, I hope that's not
+    // tied to the framerate or bitrate somehow
+    frame->pts = (1.0 / fps) * 90000 * (this->frame++);
+
+    auto error = avcodec_send_frame(ccontext, frame);
+    if (error < 0) {
+        throw std::runtime_error("Unable to send frame");
+    }
+
+    receive_packets();
+}
+
+void VideoWriter::Impl::receive_packets()
+{
+    auto ret = 0;
+    while (ret == 0) {
+        ret = avcodec_receive_packet(ccontext, packet);
+        if (ret == 0) {
+            av_interleaved_write_frame(fcontext, packet);
+        }
+    }
+}
+
+void VideoWriter::Impl::run_converter()
+{
+    auto context = sws_getContext(
+        width, height, AV_PIX_FMT_RGB24,
+        width, height, pixel_format,
+        SWS_BILINEAR, nullptr, nullptr, nullptr
+    );
+    auto lock = std::unique_lock(mutex);
+    while (true) {
+        frame_filled.wait(lock, [&]{
+            return stopping or !conversion_queue.empty();
+        });
+        if (conversion_queue.empty()) break;
+        auto slot = conversion_queue.front();
+        conversion_queue.pop_front();
+        slot->state = FrameSlot::Converting;
+        lock.unlock();
+        try {
+            convert(slot->rgb.get(), slot->frame, context);
+        }
+        catch (...) {
+            lock.lock();
+            set_error(std::current_exception());
+            continue;
+        }
+        lock.lock();
+        slot->state = FrameSlot::Converted;
+        frame_converted.notify_all();
+    }
+    lock.unlock();
+    sws_freeContext(context);
+}
+
+void VideoWriter::Impl::run_encoder()
+{
+    auto lock = std::unique_lock(mutex);
+    while (true) {
+        FrameSlot* slot = nullptr;
+        frame_converted.wait(lock, [&]{
+            if (error) return true;
+            for (auto& s : slots) {
+                if (s.state == FrameSlot::Converted and
+                        s.index == next_encode) {
+                    slot = &s;
+                    return true;
+                }
+            }
+            return stopping and next_encode == next_index;
+        });
+        if (error or !slot) break;
+        lock.unlock();
+        try {
+            for (int i = 0; i < slot->count; ++i) encode(slot->frame);
+        }
+        catch (...) {
+            lock.lock();
+            set_error(std::current_exception());
+            break;
+        }
+        lock.lock();
+        slot->state = FrameSlot::Free;
+        ++next_encode;
+        slot_freed.notify_all();
+    }
+}
+
+void VideoWriter::Impl::set_error(std::exception_ptr new_error)
+{
+    if (!error) error = new_error;
+    // Wake up everybody so that nobody waits on a frame that will never come
+    slot_freed.notify_all();
+    frame_converted.notify_all();
+}
+
+void VideoWriter::Impl::stop_threads()
+{
+    {
+        auto lock = std::lock_guard(mutex);
+        stopping = true;
+    }
+    frame_filled.notify_all();
+    frame_converted.notify_all();
+    for (auto& thread : converters) thread.join();
+    converters.clear();
+    if (encoder.joinable()) encoder.join();
+}
+
+void VideoWriter::Impl::rethrow_error()
+{
+    if (error) std::rethrow_exception(error);
+}
+
+void VideoWriter::Impl::free_resources()
+{
+    for (auto& slot : slots) {
+        if (slot.frame) av_frame_free(&slot.frame);
+    }
+    slots.clear();
+    if (packet) av_packet_free(&packet);
+    if (video_frame) av_frame_free(&video_frame);
+    if (ccontext) avcodec_free_context(&ccontext);
+    if (fcontext) avformat_free_context(fcontext);
+    if (sws_context) sws_freeContext(sws_context);
+    fcontext = nullptr;
+    sws_context = nullptr;
+}
+
+VideoWriter::VideoWriter(
+    std::string filename,
+    int width,
+    int height,
+    int fps,
+    VideoWriterOptions options
+) :
     M_impl(std::make_unique<Impl>())
 {
+    if (options.worker_threads < 0) {
+        throw std::invalid_argument(
+            "Negative number of worker threads passed to VideoWriter");
+    }
+    if (options.worker_threads > 0 and options.queue_size < 1) {
+        throw std::invalid_argument(
+            "The queue size passed to VideoWriter must be positive");
+    }
     M_impl->width = width;
     M_impl->height = height;
     M_impl->fps = fps;
+    M_impl->pixel_format = av_get_pix_fmt(options.pixel_format.c_str());
+    if (M_impl->pixel_format == AV_PIX_FMT_NONE) {
+        throw std::invalid_argument(std::format(
+            "Unknown pixel format \"{}\" passed to VideoWriter",
+            options.pixel_format));
+    }
 
     M_impl->oformat = av_guess_format(nullptr, filename.c_str(), nullptr);
     if (!M_impl->oformat) {
@@ -36,9 +267,15 @@ VideoWriter::VideoWriter(std::string filename, int width, int height, int fps) :
     if (error) {
         throw std::runtime_error("Unable to create output context");
     }
-    auto codec = avcodec_find_encoder(M_impl->oformat->video_codec);
+    auto codec = options.codec.empty()
+        ? avcodec_find_encoder(M_impl->oformat->video_codec)
+        : avcodec_find_encoder_by_name(options.codec.c_str());
     if (!codec) {
-        throw std::runtime_error("Unable to create codec");
+        if (options.codec.empty()) {
+            throw std::runtime_error("Unable to create codec");
+        }
+        throw std::invalid_argument(std::format(
+            "Unknown codec \"{}\" passed to VideoWriter", options.codec));
     }
     auto stream = avformat_new_stream(M_impl->fcontext, codec);
     if (!stream) {
@@ -50,19 +287,34 @@ VideoWriter::VideoWriter(std::string filename, int width, int height, int fps) :
     }
     M_impl->ccontext->log_level_offset = 1;
 
-    stream->codecpar->codec_id = M_impl->oformat->video_codec;
+    stream->codecpar->codec_id = codec->id;
     stream->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
     stream->codecpar->width = width;
     stream->codecpar->height = height;
-    stream->codecpar->format = AV_PIX_FMT_YUV420P;
-    stream->codecpar->bit_rate = 4000000;
+    stream->codecpar->format = M_impl->pixel_format;
     avcodec_parameters_to_context(M_impl->ccontext, stream->codecpar);
 
     M_impl->ccontext->time_base = AVRational(1, 1);
-    M_impl->ccontext->max_b_frames = 1;
-    M_impl->ccontext->gop_size = 10;
+    M_impl->ccontext->max_b_frames = options.max_b_frames;
+    M_impl->ccontext->gop_size
+        = options.gop_size > 0 ? options.gop_size : 10*fps;
     M_impl->ccontext->framerate = AVRational(fps, 1);
-    av_opt_set(M_impl->ccontext, "preset", "ultrafast", 0);
+    M_impl->ccontext->thread_count = options.encoder_threads;
+    M_impl->ccontext->thread_type
+        = (options.frame_threading ? FF_THREAD_FRAME : 0)
+        | (options.slice_threading ? FF_THREAD_SLICE : 0);
+    // These are options of the specific encoder, so they aren't available on
+    // every codec.  That's fine, the encoder's defaults will be used instead.
+    if (!options.preset.empty()) {
+        av_opt_set(M_impl->ccontext, "preset", options.preset.c_str(),
+                   AV_OPT_SEARCH_CHILDREN);
+    }
+    // Codecs like mpeg4 don't have a constant rate factor, so they get the
+    // bitrate instead of libav's tiny default one
+    if (options.crf < 0 or av_opt_set_int(M_impl->ccontext, "crf",
+            options.crf, AV_OPT_SEARCH_CHILDREN) < 0) {
+        M_impl->ccontext->bit_rate = options.bit_rate;
+    }
     avcodec_parameters_from_context(stream->codecpar, M_impl->ccontext);
 
     error = avcodec_open2(M_impl->ccontext, codec, nullptr);
@@ -78,35 +330,46 @@ VideoWriter::VideoWriter(std::string filename, int width, int height, int fps) :
         throw std::runtime_error("Unable to write header");
     }
 
-    M_impl->sws_context = sws_getContext(
-        width, height, AV_PIX_FMT_RGB24,
-        width, height, AV_PIX_FMT_YUV420P,
-        SWS_BILINEAR, nullptr, nullptr, nullptr
-    );
-
-    M_impl->video_frame = av_frame_alloc();
-    M_impl->video_frame->format = AV_PIX_FMT_YUV420P;
-    M_impl->video_frame->width = width;
-    M_impl->video_frame->height = height;
-    error = av_frame_get_buffer(M_impl->video_frame, 32);
-    if (error < 0) {
-        throw std::runtime_error("Unable to allocate frame");
-    }
-
     M_impl->packet = av_packet_alloc();
     M_impl->packet->data = nullptr;
     M_impl->packet->size = 0;
     M_impl->packet->flags |= AV_PKT_FLAG_KEY;
+
+    if (options.worker_threads == 0) {
+        M_impl->sws_context = sws_getContext(
+            width, height, AV_PIX_FMT_RGB24,
+            width, height, M_impl->pixel_format,
+            SWS_BILINEAR, nullptr, nullptr, nullptr
+        );
+        M_impl->video_frame = M_impl->allocate_frame();
+    }
+    else {
+        M_impl->slots.resize(options.queue_size);
+        for (auto& slot : M_impl->slots) {
+            slot.rgb = std::make_unique<std::uint8_t[]>(width*height*3);
+            slot.frame = M_impl->allocate_frame();
+        }
+        auto impl = M_impl.get();
+        for (int i = 0; i < options.worker_threads; ++i) {
+            M_impl->converters.emplace_back([impl]{impl->run_converter();});
+        }
+        M_impl->encoder = std::thread([impl]{impl->run_encoder();});
+    }
 }
 
 VideoWriter::~VideoWriter()
 {
-    finish();
+    try {
+        finish();
+    }
+    catch (std::exception& e) {
+        std::cerr << "Error while finishing video: " << e.what() << "\n";
+    }
 }
 VideoWriter::VideoWriter(VideoWriter&&)=default;
 VideoWriter& VideoWriter::operator=(VideoWriter&&)=default;
 
-void VideoWriter::write_frame(std::span<std::uint8_t> image)
+void VideoWriter::write_frame(std::span<std::uint8_t> image, int count)
 {
     if (!M_impl) {
         throw std::logic_error(
@@ -117,50 +380,62 @@ void VideoWriter::write_frame(std::span<std::uint8_t> image)
             "The image passed to VideoWriter::write_frame has an incorrect "
             "size.");
     }
-    int linesize = 3*M_impl->width;
-    auto data = image.data();
-    sws_scale(M_impl->sws_context, &data, &linesize, 0, M_impl->height,
-            M_impl->video_frame->data, M_impl->video_frame->linesize);
-    // I honestly have no idea where the 90000 comes from, I hope that's not
-    // tied to the framerate or bitrate somehow
-    M_impl->video_frame->pts = (1.0 / M_impl->fps) * 90000 * (M_impl->frame++);
-
-    auto error = avcodec_send_frame(M_impl->ccontext, M_impl->video_frame);
-    if (error < 0) {
-        throw std::runtime_error("Unable to send frame");
+    if (count < 1) {
+        throw std::invalid_argument(
+            "The count passed to VideoWriter::write_frame must be positive.");
+    }
+    if (M_impl->slots.empty()) {
+        M_impl->convert(
+            image.data(), M_impl->video_frame, M_impl->sws_context);
+        for (int i = 0; i < count; ++i) M_impl->encode(M_impl->video_frame);
+        return;
     }
 
-    receive_packets();
-}
-
-void VideoWriter::receive_packets()
-{
-    auto ret = 0;
-    while (ret == 0) {
-        ret = avcodec_receive_packet(M_impl->ccontext, M_impl->packet);
-        if (ret == 0) {
-            av_interleaved_write_frame(M_impl->fcontext, M_impl->packet);
+    auto& impl = *M_impl;
+    auto lock = std::unique_lock(impl.mutex);
+    FrameSlot* slot = nullptr;
+    impl.slot_freed.wait(lock, [&]{
+        if (impl.error) return true;
+        for (auto& s : impl.slots) {
+            if (s.state == FrameSlot::Free) {
+                slot = &s;
+                return true;
+            }
         }
-    }
+        return false;
+    });
+    impl.rethrow_error();
+    // Nobody else touches a free slot, so the copy can happen unlocked
+    slot->state = FrameSlot::Filled;
+    lock.unlock();
+    std::memcpy(slot->rgb.get(), image.data(), image.size());
+    lock.lock();
+    slot->index = impl.next_index++;
+    slot->count = count;
+    impl.conversion_queue.push_back(slot);
+    lock.unlock();
+    impl.frame_filled.notify_one();
 }
 
 void VideoWriter::finish()
 {
     if (!M_impl) return;
-    avcodec_send_frame(M_impl->ccontext, nullptr);
-    receive_packets();
+    auto impl = std::move(M_impl);
+    if (!impl->slots.empty()) {
+        impl->stop_threads();
+        if (impl->error) {
+            if (impl->fcontext) avio_close(impl->fcontext->pb);
+            impl->free_resources();
+            impl->rethrow_error();
+        }
+    }
+    avcodec_send_frame(impl->ccontext, nullptr);
+    impl->receive_packets();
 
-    av_write_trailer(M_impl->fcontext);
-    int error = avio_close(M_impl->fcontext->pb);
+    av_write_trailer(impl->fcontext);
+    int error = avio_close(impl->fcontext->pb);
+    impl->free_resources();
     if (error < 0) {
         throw std::runtime_error("Failed to close file");
     }
-
-    if (M_impl->packet) av_packet_free(&M_impl->packet);
-    if (M_impl->video_frame) av_frame_free(&M_impl->video_frame);
-    if (M_impl->ccontext) avcodec_free_context(&M_impl->ccontext);
-    if (M_impl->fcontext) avformat_free_context(M_impl->fcontext);
-    if (M_impl->sws_context) sws_freeContext(M_impl->sws_context);
-
-    M_impl.reset();
 }
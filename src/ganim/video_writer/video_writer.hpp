@@ -7,17 +7,88 @@
 
 #include <memory>
 #include <span>
+#include <string>
 #include <cstdint>
 
+#include "frame_sink.hpp"
+
 namespace ganim {
+    /** @brief Settings for how a @ref VideoWriter encodes its video.
+     *
+     * The defaults are meant for the kind of mostly static content that ganim
+     * usually makes, so you should only need to change these if you have a
+     * specific reason to.
+     */
+    struct VideoWriterOptions {
+        /** @brief The name of the libavcodec encoder to use, like "libx264",
+         * "libx265", or "libsvtav1".  If this is empty, the default encoder
+         * for the container given by the filename's extension is used.
+         */
+        std::string codec = "";
+        /** @brief The constant rate factor to encode with.  Lower is better
+         * quality.  If this is negative or the codec doesn't have a constant
+         * rate factor, @ref bit_rate is used instead.
+         */
+        int crf = 18;
+        /** @brief The target bitrate, in bits per second.  This is only used
+         * if @ref crf is negative or the codec doesn't support it.
+         */
+        std::int64_t bit_rate = 4000000;
+        /** @brief The encoder preset, like "ultrafast" or "medium".  If this
+         * is empty, the encoder's default preset is used.
+         */
+        std::string preset = "ultrafast";
+        /** @brief The maximum number of frames between keyframes.  If this is
+         * zero, ten seconds of video is used.
+         */
+        int gop_size = 0;
+        /** @brief The maximum number of B-frames between other frames. */
+        int max_b_frames = 1;
+        /** @brief The number of threads libavcodec itself uses to encode.
+         * Zero lets libavcodec pick based on the number of cores.
+         */
+        int encoder_threads = 0;
+        /** @brief Whether libavcodec may encode several frames at once. */
+        bool frame_threading = true;
+        /** @brief Whether libavcodec may split frames into slices that are
+         * encoded at once.
+         */
+        bool slice_threading = true;
+        /** @brief The pixel format of the output video, using the names from
+         * libavutil.  For example, "yuv420p" is the most compatible,
+         * "yuv444p" avoids blurring colors at sharp edges, and "yuv420p10le"
+         * is 10-bit.
+         */
+        std::string pixel_format = "yuv420p";
+        /** @brief The number of threads used to convert frames to the output
+         * pixel format.  If this is zero, everything happens synchronously in
+         * @ref VideoWriter::write_frame.  Otherwise, one more thread is also
+         * used for encoding and writing the file.
+         */
+        int worker_threads = 1;
+        /** @brief The maximum number of frames that can be waiting to be
+         * encoded when using worker threads.  The buffers for these frames
+         * are allocated once and then reused.
+         */
+        int queue_size = 8;
+    };
+
     /** @brief The class that actually writes the images to a video file.
      *
      * To use it just construct it, pass frames to it whenever you want using
      * @ref write_frame, and then to finish writing to the file call @ref finish
      * (which is also called by the destructor, so this last step is not always
      * necessary).
+     *
+     * If @ref VideoWriterOptions::worker_threads is zero, each frame is
+     * converted, encoded, and written to the file before @ref write_frame
+     * returns.  Otherwise, frames are instead copied into a bounded queue and
+     * all of that work happens on background threads, so the caller only waits
+     * when the queue is full.  Any error that happens on a
+     * background thread is rethrown by the next call to @ref write_frame or
+     * @ref finish.
      */
-    class VideoWriter {
+    class VideoWriter : public FrameSink {
         public:
             /** @brief Constructor.
              * @param filename The name of the file you want to create,
@@ -25,13 +96,22 @@ namespace ganim {
              * @param width The width of the output video.
              * @param height The height of the output video.
              * @param fps The framerate of the output video.
+             * @param options The settings used to encode the video.
+             * @throw std::invalid_argument When the codec or pixel format in
+             * the options doesn't exist.
              */
-            VideoWriter(std::string filename, int width, int height, int fps);
+            VideoWriter(
+                std::string filename,
+                int width,
+                int height,
+                int fps,
+                VideoWriterOptions options = {}
+            );
             /** @brief Destructor.
              *
              * This calls @ref finish if it hasn't been called already.
              */
-            ~VideoWriter();
+            virtual ~VideoWriter();
             VideoWriter(const VideoWriter&)=delete;
             VideoWriter& operator=(const VideoWriter&)=delete;
             VideoWriter(VideoWriter&&);
@@ -42,22 +122,32 @@ namespace ganim {
              * @param image The data for a frame.  It must be RGB data, not RGBA
              * data.  Thus, `image.size()` must be equal to
              * `width * height * 3`.
+             * @param count The number of times in a row to write the frame.
+             * The frame is only converted once no matter how many times it is
+             * written, so this is much faster than writing the same frame
+             * several times.
              * @throw std::invalid_argument When
-             * `image.size() != width * height * 3`.
+             * `image.size() != width * height * 3` or the count isn't
+             * positive.
+             * @throw std::runtime_error When encoding a previous frame on a
+             * worker thread failed.
              */
-            void write_frame(std::span<std::uint8_t> image);
+            virtual void write_frame(
+                std::span<std::uint8_t> image,
+                int count = 1
+            ) override;
             /** @brief Finish writing to the file and close the file.
              *
              * This is called automatically by the destructor, so only call it
              * if you want the file to be finished before the destructor would
-             * get called.
+             * get called.  When using worker threads, this waits for every
+             * queued frame to be written first.
              */
-            void finish();
+            virtual void finish() override;
 
         private:
             class Impl;
             std::unique_ptr<Impl> M_impl;
-            void receive_packets();
     };
 }
 
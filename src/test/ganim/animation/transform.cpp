@@ -580,6 +580,41 @@ TEST_CASE("group_transform", "[animation]") {
     }
 }
 
+TEST_CASE("group_transform bookkeeping", "[animation]") {
+    auto scene = TestScene(4, 4, 4, 4, 2);
+    auto make_square = [] {
+        return make_shape(
+            {{-1,  1}, {-1, -1}, { 1,  1}, { 1, -1}},
+            {0, 1, 2, 2, 1, 3}
+        );
+    };
+    auto shape1 = make_square();
+    auto shape2 = make_square();
+    auto shape3 = make_square();
+    auto shape4 = make_square();
+    auto group1 = make_group(shape1, shape2, shape3);
+    auto group2 = make_group(shape4);
+    scene.add(group1, group2);
+    group1->set_visible(true);
+
+    // Nothing should change if any subobject is already being animated
+    animate(scene, shape2);
+    REQUIRE_THROWS(group_transform(scene, group1, group2));
+    REQUIRE(shape1->is_visible());
+    REQUIRE(!shape4->is_animating());
+    scene.wait();
+
+    group_transform(scene, group1, group2);
+    REQUIRE(shape4->is_animating());
+    REQUIRE(!shape1->is_visible());
+    REQUIRE(!shape2->is_visible());
+    REQUIRE(!shape3->is_visible());
+    scene.wait();
+    scene.frame_advance();
+    REQUIRE(shape4->is_visible());
+    REQUIRE(!shape4->is_animating());
+}
+
 TEST_CASE("Global transform basic", "[animation]") {
     auto scene = TestScene(8, 8, 8, 8, 2);
     auto shape1 = make_shape(
@@ -0,0 +1,94 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "ganim/gl/scratch_pool.hpp"
+
+#include "ganim/gl/gl.hpp"
+
+using namespace ganim;
+
+TEST_CASE("Scratch textures", "[gl]") {
+    gl::clear_scratch_pool();
+    auto id = 0U;
+    {
+        auto texture = gl::get_scratch_texture(16, 8, GL_RGBA32F);
+        REQUIRE(texture.get_width() == 16);
+        REQUIRE(texture.get_height() == 8);
+        REQUIRE(texture.get_format() == GL_RGBA32F);
+        id = texture;
+        REQUIRE(gl::get_scratch_pool_memory() == 0);
+    }
+    REQUIRE(gl::get_scratch_pool_memory() == 16*8*16);
+
+    // A different size or format needs a different texture
+    auto other_size = gl::get_scratch_texture(8, 16, GL_RGBA32F);
+    auto other_format = gl::get_scratch_texture(16, 8, GL_R32F);
+    REQUIRE(unsigned(other_size) != id);
+    REQUIRE(unsigned(other_format) != id);
+
+    auto same = gl::get_scratch_texture(16, 8, GL_RGBA32F);
+    REQUIRE(unsigned(same) == id);
+    REQUIRE(gl::get_scratch_pool_memory() == 0);
+
+    // Released textures aren't returned to the pool
+    auto kept = same.release();
+    REQUIRE(unsigned(kept) == id);
+    REQUIRE(unsigned(same) == 0);
+    same = gl::ScratchTexture();
+    REQUIRE(gl::get_scratch_pool_memory() == 0);
+
+    REQUIRE_THROWS_AS(gl::get_scratch_texture(0, 8, GL_RGBA32F),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(gl::get_scratch_texture(8, 8, GL_DEPTH_COMPONENT24),
+                      std::invalid_argument);
+    gl::clear_scratch_pool();
+
+    // Textures are counted by how big their format really is
+    gl::get_scratch_texture(8, 8, GL_R32UI);
+    REQUIRE(gl::get_scratch_pool_memory() == 8*8*4);
+    gl::get_scratch_texture(8, 8, GL_R8UI);
+    REQUIRE(gl::get_scratch_pool_memory() == 8*8*5);
+    gl::clear_scratch_pool();
+}
+
+TEST_CASE("Scratch pool budget", "[gl]") {
+    gl::clear_scratch_pool();
+    gl::set_scratch_pool_budget(2 * 8*8*4);
+    auto new_id = 0U;
+    auto third_id = 0U;
+    {
+        auto old_texture = gl::get_scratch_texture(8, 8, GL_R32F);
+        auto new_texture = gl::get_scratch_texture(8, 8, GL_R32F);
+        auto third = gl::get_scratch_texture(8, 8, GL_R32F);
+        new_id = new_texture;
+        third_id = third;
+        // Make sure they're returned in a known order
+        old_texture = gl::ScratchTexture();
+        third = gl::ScratchTexture();
+    }
+    // The texture returned first was deleted to make room for the others
+    REQUIRE(gl::get_scratch_pool_memory() == 2 * 8*8*4);
+    auto a = gl::get_scratch_texture(8, 8, GL_R32F);
+    auto b = gl::get_scratch_texture(8, 8, GL_R32F);
+    REQUIRE(unsigned(a) == new_id);
+    REQUIRE(unsigned(b) == third_id);
+    REQUIRE(gl::get_scratch_pool_memory() == 0);
+
+    // Textures bigger than the whole budget are never kept
+    { auto big = gl::get_scratch_texture(64, 64, GL_R32F); }
+    REQUIRE(gl::get_scratch_pool_memory() == 0);
+    gl::set_scratch_pool_budget(512 << 20);
+    gl::clear_scratch_pool();
+}
+
+TEST_CASE("Scratch framebuffers", "[gl]") {
+    gl::clear_scratch_pool();
+    auto id = 0U;
+    {
+        auto framebuffer = gl::get_scratch_framebuffer();
+        id = framebuffer;
+        REQUIRE(id != 0);
+    }
+    auto framebuffer = gl::get_scratch_framebuffer();
+    REQUIRE(unsigned(framebuffer) == id);
+    gl::clear_scratch_pool();
+}
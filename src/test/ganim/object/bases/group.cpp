@@ -430,6 +430,61 @@ TEST_CASE("Group bounding box", "[object]") {
     REQUIRE_THAT(res6p2, GAEquals(3.5*e1 + 1.5*e2));
 }
 
+TEST_CASE("Group bounding box caching", "[object]") {
+    using namespace vga3;
+    auto square = [] {
+        return make_shape(
+            {{0, 0}, {1, 0}, {1, 1}, {0, 1}},
+            {0, 1, 2, 0, 2, 3}
+        );
+    };
+    auto shape1 = square();
+    auto shape2 = square();
+    auto inner = make_group(shape1, shape2);
+    auto outer = make_group(inner);
+    auto box_corners = [&] {
+        auto box = outer->get_true_bounding_box();
+        return std::pair{
+            pga3_to_vga3(box.get_inner_lower_left()),
+            pga3_to_vga3(box.get_outer_upper_right())
+        };
+    };
+    REQUIRE(outer->has_cacheable_bounding_box());
+    auto [p1, p2] = box_corners();
+    REQUIRE_THAT(p1, GAEquals(0));
+    REQUIRE_THAT(p2, GAEquals(e1 + e2));
+
+    shape2->shift(2*e1);
+    std::tie(p1, p2) = box_corners();
+    REQUIRE_THAT(p2, GAEquals(3*e1 + e2));
+
+    shape1->set_vertices(
+        {{0, -1}, {1, -1}, {1, 1}, {0, 1}},
+        {0, 1, 2, 0, 2, 3}
+    );
+    std::tie(p1, p2) = box_corners();
+    REQUIRE_THAT(p1, GAEquals(-e2));
+
+    shape2->scale(2, 2*e1);
+    std::tie(p1, p2) = box_corners();
+    REQUIRE_THAT(p2, GAEquals(4*e1 + 2*e2));
+
+    inner->remove(shape2);
+    std::tie(p1, p2) = box_corners();
+    REQUIRE_THAT(p2, GAEquals(e1 + e2));
+
+    auto shape3 = square();
+    shape3->shift(-e1);
+    inner->add(shape3);
+    std::tie(p1, p2) = box_corners();
+    REQUIRE_THAT(p1, GAEquals(-e1 - e2));
+
+    // Moving the shape that was removed shouldn't affect anything
+    shape2->shift(10*e1);
+    std::tie(p1, p2) = box_corners();
+    REQUIRE_THAT(p2, GAEquals(e1 + e2));
+}
+
 TEST_CASE("Group draw_together", "[object]") {
     auto scene = TestScene(4, 4, 4, 4, 4);
     auto shape1 = make_shape(
@@ -0,0 +1,115 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <stdexcept>
+
+#include "ganim/object/bases/outline_geometry.hpp"
+
+using namespace ganim;
+
+namespace {
+    const auto square_positions = std::vector<std::array<float, 3>>{{
+        {-1, -1, 0},
+        { 1, -1, 0},
+        { 1,  1, 0},
+        {-1,  1, 0}
+    }};
+    const auto square_indices = std::vector<unsigned>{0, 1, 2, 0, 2, 3};
+}
+
+TEST_CASE("Outline geometry of a square", "[object]") {
+    SECTION("Round") {
+        auto geometry = make_outline_geometry(
+            square_positions, square_indices, OutlineJoin::Round);
+        // Four points on the shape, two for each edge, and nine for each
+        // corner
+        REQUIRE(geometry.vertices.size() == 4 + 8 + 36);
+        // The shape, two for each edge, and eight for each corner
+        REQUIRE(geometry.indices.size() == 3 * (2 + 8 + 32));
+    }
+    SECTION("Miter") {
+        auto geometry = make_outline_geometry(
+            square_positions, square_indices, OutlineJoin::Miter);
+        REQUIRE(geometry.vertices.size() == 4 + 8 + 12);
+        REQUIRE(geometry.indices.size() == 3 * (2 + 8 + 8));
+        auto tips = 0;
+        for (auto& v : geometry.vertices) {
+            if (std::abs(v.dx) == 1 and std::abs(v.dy) == 1) {
+                REQUIRE(v.dx * v.x > 0);
+                REQUIRE(v.dy * v.y > 0);
+                ++tips;
+            }
+        }
+        REQUIRE(tips == 4);
+    }
+    SECTION("Miter limit") {
+        // The corners are sqrt(2) times further away than the edges
+        auto geometry = make_outline_geometry(
+            square_positions, square_indices, OutlineJoin::Miter, 1.2);
+        REQUIRE(geometry.vertices.size() == 4 + 8 + 8);
+        REQUIRE(geometry.indices.size() == 3 * (2 + 8 + 4));
+    }
+    for (auto& v : make_outline_geometry(square_positions, square_indices)
+            .vertices) {
+        if (v.distance == 0) {
+            REQUIRE(v.dx == 0);
+            REQUIRE(v.dy == 0);
+        }
+        else {
+            REQUIRE(v.distance == 1);
+            // Offsets always point away from the square
+            REQUIRE(v.dx * v.x + v.dy * v.y > 0);
+        }
+    }
+}
+
+TEST_CASE("Outline geometry welding", "[object]") {
+    // The same square, but the triangles don't share any vertices
+    auto positions = std::vector<std::array<float, 3>>{{
+        {-1, -1, 0},
+        { 1, -1, 0},
+        { 1,  1, 0},
+        {-1, -1, 0},
+        { 1,  1, 0},
+        {-1,  1, 0}
+    }};
+    auto indices = std::vector<unsigned>{0, 1, 2, 3, 4, 5};
+    auto geometry = make_outline_geometry(
+        positions, indices, OutlineJoin::Miter);
+    REQUIRE(geometry.vertices.size() == 4 + 8 + 12);
+    REQUIRE(geometry.indices.size() == 3 * (2 + 8 + 8));
+}
+
+TEST_CASE("Outline geometry inside corners", "[object]") {
+    // An L shape, which has one inside corner that doesn't need a join
+    auto positions = std::vector<std::array<float, 3>>{{
+        {0, 0, 0},
+        {2, 0, 0},
+        {2, 1, 0},
+        {1, 1, 0},
+        {1, 2, 0},
+        {0, 2, 0},
+        {0, 1, 0}
+    }};
+    auto indices = std::vector<unsigned>{
+        0, 1, 2,
+        0, 2, 3,
+        0, 3, 6,
+        6, 3, 4,
+        6, 4, 5
+    };
+    auto geometry = make_outline_geometry(
+        positions, indices, OutlineJoin::Miter);
+    // Seven boundary edges, and five outside corners because the corner at
+    // (0, 1) is straight
+    REQUIRE(geometry.vertices.size() == 7 + 14 + 15);
+    REQUIRE(geometry.indices.size() == 3 * (5 + 14 + 10));
+}
+
+TEST_CASE("Outline geometry errors", "[object]") {
+    auto indices = std::vector<unsigned>{0, 1, 4};
+    REQUIRE_THROWS_AS(
+        make_outline_geometry(square_positions, indices),
+        std::out_of_range
+    );
+}
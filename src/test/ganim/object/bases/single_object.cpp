@@ -1,6 +1,10 @@
 #include <catch2/catch_test_macros.hpp>
 
+#include <stdexcept>
+
 #include "ganim/object/shape.hpp"
+#include "ganim/object/bases/outline_cache.hpp"
+#include "ganim/object/bases/outline_geometry.hpp"
 #include "test/ganim/scene/test_scene.hpp"
 #include "test/ganim/approx_color.hpp"
 
@@ -180,3 +184,146 @@ TEST_CASE("Outlines and scaling", "[object]") {
     REQUIRE(scene.get_pixel(0, 0, 0) == Color("000000"));
     REQUIRE(scene.get_pixel(0, 2, 0) != Color("000000"));
 }
+
+TEST_CASE("Outline sharing", "[object]") {
+    auto& cache = OutlineCache::get();
+    cache.clear();
+    auto scene = TestScene(16, 16, 16, 16, 1);
+    auto make_square = [](double x) {
+        return make_shape(
+            {{float(x) - 1, -1},
+             {float(x) + 1, -1},
+             {float(x) + 1,  1},
+             {float(x) - 1,  1}},
+            {0, 1, 2, 0, 2, 3}
+        );
+    };
+    auto shape1 = make_square(-4);
+    auto shape2 = make_square(4);
+    auto shape3 = make_square(0);
+    shape3->set_color("0000FF");
+    shape3->shift(-4*pga3::e2);
+    for (auto shape : {shape1, shape2, shape3}) {
+        shape->set_outline("FF0000", 2);
+        shape->set_visible(true);
+        scene.add(shape);
+    }
+    auto hits = cache.get_hit_count();
+    scene.frame_advance();
+    // Color and position don't matter, so all three squares share an outline
+    REQUIRE(cache.size() == 1);
+    REQUIRE(cache.get_hit_count() == hits + 2);
+    REQUIRE(scene.get_pixel(0, 2, 7) == Color("FF0000"));
+    REQUIRE(scene.get_pixel(0, 3, 7) == Color("FFFFFF"));
+    REQUIRE(scene.get_pixel(0, 13, 8) == Color("FF0000"));
+    REQUIRE(scene.get_pixel(0, 12, 8) == Color("FFFFFF"));
+    REQUIRE(scene.get_pixel(0, 8, 13) == Color("FF0000"));
+    REQUIRE(scene.get_pixel(0, 8, 12) == Color("0000FF"));
+
+    // A slightly thicker outline still fits in the same texture
+    shape1->set_outline("FF0000", 2.2);
+    hits = cache.get_hit_count();
+    auto misses = cache.get_miss_count();
+    scene.frame_advance();
+    REQUIRE(cache.get_hit_count() == hits);
+    REQUIRE(cache.get_miss_count() == misses);
+    cache.clear();
+}
+
+TEST_CASE("Outline cache eviction", "[object]") {
+    auto cache = OutlineCache();
+    auto make_outline = [](int texture_size) {
+        auto result = std::make_shared<OutlineTexture>();
+        result->texture_size = texture_size;
+        return result;
+    };
+    auto key1 = OutlineCache::Key{1, 1, 8};
+    auto key2 = OutlineCache::Key{2, 1, 8};
+    auto key3 = OutlineCache::Key{3, 1, 8};
+    cache.set_memory_budget(2 * 16*16*4);
+    cache.insert(key1, make_outline(16));
+    cache.insert(key2, make_outline(16));
+    REQUIRE(cache.get_memory_usage() == 2 * 16*16*4);
+    REQUIRE(cache.find(key1));
+    cache.insert(key3, make_outline(16));
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.find(key1));
+    REQUIRE(!cache.find(key2));
+    REQUIRE(cache.find(key3));
+
+    // The newest outline is kept even if it's too big by itself
+    cache.insert(key2, make_outline(64));
+    REQUIRE(cache.size() == 1);
+    REQUIRE(cache.find(key2));
+    cache.set_memory_budget(0);
+    REQUIRE(cache.size() == 1);
+}
+
+TEST_CASE("Analytic outlines", "[object]") {
+    auto& cache = OutlineCache::get();
+    cache.clear();
+    auto scene = TestScene(8, 8, 8, 8, 1);
+    auto shape = make_shape(
+        {{-1, -1},
+         { 1, -1},
+         { 1,  1},
+         {-1,  1}},
+        {0, 1, 2, 0, 2, 3}
+    );
+    shape->set_outline("FF0000", 2);
+    shape->set_outline_mode(OutlineMode::Analytic);
+    shape->set_visible(true);
+    scene.add(shape);
+    scene.frame_advance();
+    // No distance field was made
+    REQUIRE(cache.size() == 0);
+    REQUIRE(scene.get_pixel(0, 3, 3) == Color("FFFFFF"));
+    REQUIRE(scene.get_pixel(0, 1, 3) == Color("FF0000"));
+    REQUIRE(scene.get_pixel(0, 6, 4) == Color("FF0000"));
+    REQUIRE(scene.get_pixel(0, 3, 6) == Color("FF0000"));
+    REQUIRE(scene.get_pixel(0, 0, 3) == Color("000000"));
+    REQUIRE(scene.get_pixel(0, 7, 4) == Color("000000"));
+    // The corners are rounded, so this pixel is only partially covered
+    auto corner = scene.get_pixel(0, 1, 1);
+    REQUIRE(int(corner.r) > 64);
+    REQUIRE(int(corner.r) < 128);
+
+    shape->set_outline_mode(OutlineMode::Analytic, OutlineJoin::Miter);
+    scene.frame_advance();
+    REQUIRE(scene.get_pixel(1, 1, 1) == Color("FF0000"));
+    REQUIRE(scene.get_pixel(1, 0, 0) == Color("000000"));
+
+    // With a low enough miter limit, the corners are cut off
+    shape->set_outline_mode(OutlineMode::Analytic, OutlineJoin::Miter, 1.2);
+    scene.frame_advance();
+    REQUIRE(scene.get_pixel(2, 1, 1) != Color("FF0000"));
+
+    REQUIRE_THROWS_AS(
+        shape->set_outline_mode(OutlineMode::Analytic, OutlineJoin::Miter, 0.5),
+        std::invalid_argument
+    );
+}
+
+TEST_CASE("Analytic outlines falling back", "[object]") {
+    auto scene = TestScene(16, 16, 16, 16, 4);
+    auto shape = make_shape(
+        {{-1,  1, 0, 0},
+         {-1, -1, 0, 0},
+         { 0,  1, 0, 1},
+         { 0, -1, 0, 1},
+         { 2,  1, 0, 2},
+         { 2, -1, 0, 2}},
+         {0, 1, 2, 1, 2, 3, 2, 3, 4, 3, 4, 5}
+    );
+    scene.add(shape);
+    shape->set_outline(Color("#FF0000"), 0.375);
+    shape->set_outline_mode(OutlineMode::Analytic);
+    // Shapes being created don't look like their triangles, so they still
+    // use a distance field
+    create(scene, shape, {.rate_function = [](double t) {return t;}});
+    scene.wait();
+    REQUIRE(scene.get_pixel(0, 4, 3) == Color("FF0000"));
+    REQUIRE(scene.get_pixel(0, 7, 3) == Color("000000"));
+    REQUIRE(scene.get_pixel(1, 6, 3) == Color("FF0000"));
+    REQUIRE(scene.get_pixel(1, 9, 3) == Color("000000"));
+}
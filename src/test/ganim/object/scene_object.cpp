@@ -81,3 +81,50 @@ TEST_CASE("SceneObject", "[object]") {
     REQUIRE(scene.get_pixel(2, 2, 3) == black);
     REQUIRE(scene.get_pixel(2, 3, 3) == black);
 }
+
+TEST_CASE("SceneObject outlines", "[object]") {
+    using namespace vga2;
+    auto scene = TestScene(16, 16, 16, 16, 1);
+    auto scene2 = make_scene_object(8, 8, 8, 8, 1);
+    auto square = make_polygon_shape({
+        -3*e1 - e2,
+        -1*e1 - e2,
+        -1*e1 + e2,
+        -3*e1 + e2
+    });
+    scene2->set_background_color("00000000");
+    scene2->set_outline("FF0000", 1);
+    scene2->set_visible(true);
+    square->set_visible(true);
+    scene2->add(square);
+    scene.add(scene2);
+    scene.frame_advance();
+    REQUIRE(int(scene.get_pixel(0, 4, 7).r) > 128);
+    REQUIRE(int(scene.get_pixel(0, 11, 7).r) < 128);
+
+    // The framebuffer texture stays the same, so the old outline would be
+    // shared if it wasn't marked as modified
+    square->shift(4*e1);
+    scene2->invalidate_outline();
+    scene.frame_advance();
+    REQUIRE(int(scene.get_pixel(1, 4, 7).r) < 128);
+    REQUIRE(int(scene.get_pixel(1, 11, 7).r) > 128);
+}
+
+TEST_CASE("SceneObject in a preview", "[object]") {
+    using namespace vga2;
+    auto scene = TestScene(4, 4, 4, 4, 4, PreviewOptions{1, 2});
+    auto scene2 = make_scene_object(2, 2, 2, 2, 4);
+    auto rect = make_polygon_shape({-e1, e1, e1 + e2, -e1 + e2});
+    scene2->add(rect);
+    REQUIRE(rect->get_fps() == 4);
+    scene.add(scene2);
+    // The scene inside runs at the same speed as the one it's in
+    REQUIRE(scene2->get_scene().get_fps() == 2);
+    REQUIRE(rect->get_fps() == 2);
+    auto other = make_polygon_shape({-e1, e1, e1 + e2, -e1 + e2});
+    scene2->add(other);
+    REQUIRE(other->get_fps() == 2);
+    scene2->get_scene().wait(1);
+    REQUIRE(scene2->get_scene().get_frame_count() == 2);
+}
@@ -656,3 +656,90 @@ TEST_CASE("Shape outline over other object", "[object]") {
     scene.frame_advance();
     REQUIRE(scene.get_pixel(0, 2, 2) == Color("FF0000"));
 }
+
+TEST_CASE("Shape batching", "[object]") {
+    using namespace vga2;
+    auto scene = TestScene(4, 4, 4, 4, 1);
+    auto make_square = [] {
+        return make_shape(
+            {{ 0.5,  0.5},
+             { 0.5, -0.5},
+             {-0.5, -0.5},
+             {-0.5,  0.5}},
+             {0, 1, 2, 0, 2, 3}
+        );
+    };
+    auto red = make_square();
+    auto green = make_square();
+    auto blue = make_square();
+    auto pixelated = make_square();
+    REQUIRE(red->is_batchable());
+    pixelated->pixelate(2);
+    REQUIRE(!pixelated->is_batchable());
+
+    red->set_color("FF0000");
+    green->set_color("00FF00");
+    blue->set_color("0000FF");
+    blue->set_opacity(0.5);
+    red->shift(-1.5*e1 + 1.5*e2);
+    green->shift(-0.5*e1 + 1.5*e2);
+    blue->shift(0.5*e1 + 1.5*e2);
+    red->set_visible(true);
+    green->set_visible(true);
+    blue->set_visible(true);
+    scene.add(red, green, blue);
+    scene.frame_advance();
+    REQUIRE(scene.get_pixel(0, 0, 0) == Color("FF0000"));
+    REQUIRE(scene.get_pixel(0, 1, 0) == Color("00FF00"));
+    REQUIRE(scene.get_pixel(0, 2, 0) == ApproxColor("000080"));
+    REQUIRE(scene.get_pixel(0, 3, 0) == Color("000000"));
+}
+
+TEST_CASE("Shape updating vertices", "[object]") {
+    auto scene = TestScene(4, 4, 4, 4, 1);
+    auto shape = make_shape(
+        {{ 1,  1},
+         { 1, -1},
+         {-1, -1},
+         {-1,  1}},
+         {0, 1, 2, 0, 2, 3}
+    );
+    shape->set_visible(true);
+    scene.add(shape);
+    scene.frame_advance();
+    REQUIRE(scene.get_pixel(0, 0, 0) == Color("000000"));
+    REQUIRE(scene.get_pixel(0, 1, 1) == Color("FFFFFF"));
+    auto new_vertices = std::vector<Shape::Vertex>{{ 2,  2}, { 2, -2}};
+    shape->update_vertices(0, new_vertices);
+    scene.frame_advance();
+    REQUIRE(scene.get_pixel(1, 3, 0) == Color("FFFFFF"));
+    REQUIRE(scene.get_pixel(1, 0, 0) == Color("000000"));
+    shape->set_vertices(
+        {{ 2,  2},
+         { 2, -2},
+         {-2, -2},
+         {-2,  2}},
+         {0, 1, 2, 0, 2, 3}
+    );
+    scene.frame_advance();
+    REQUIRE(scene.get_pixel(2, 0, 0) == Color("FFFFFF"));
+    REQUIRE_THROWS_AS(
+        shape->update_vertices(3, new_vertices),
+        std::out_of_range
+    );
+
+    // Making the shape flat again goes back to drawing it without shading
+    auto raised = std::vector<Shape::Vertex>{{ 2,  2, 1}};
+    shape->update_vertices(0, raised);
+    auto flat = std::vector<Shape::Vertex>{{ 2,  2, 0}};
+    shape->update_vertices(0, flat);
+    scene.frame_advance();
+    REQUIRE(scene.get_pixel(3, 0, 0) == Color("FFFFFF"));
+
+    auto empty = make_shape({}, {});
+    empty->update_vertices(0, std::span<const Shape::Vertex>());
+    REQUIRE_THROWS_AS(
+        empty->update_vertices(1, std::span<const Shape::Vertex>()),
+        std::out_of_range
+    );
+}
@@ -180,6 +180,53 @@ TEST_CASE("Scene skipping", "[scene]") {
     scene.frame_advance();
     REQUIRE(scene.time_size() == 2);
     REQUIRE(test->draw_count == 2);
+    REQUIRE(scene.get_frame_count() == 3);
+    REQUIRE(scene.get_output_frame_count() == 2);
+}
+
+TEST_CASE("Scene render windows", "[scene]") {
+    auto scene = TestScene(1, 1, 1, 1, 4);
+    auto test = ObjectPtr<TestDrawable>();
+    test->set_visible(true);
+    scene.add(test);
+    int updated = 0;
+    test->add_updater([&]{++updated;});
+    scene.set_render_window(RenderWindow::frames(2, 4));
+    REQUIRE(!scene.in_render_window(1));
+    REQUIRE(scene.in_render_window(2));
+    REQUIRE(!scene.in_render_window(4));
+    scene.frame_advance(6);
+    REQUIRE(updated == 6);
+    REQUIRE(test->draw_count == 2);
+    REQUIRE(scene.time_size() == 2);
+    REQUIRE(scene.get_output_frame_count() == 2);
+
+    // Frames 6 and 7
+    scene.set_render_window(RenderWindow::seconds(1.4, 2));
+    scene.wait(1);
+    REQUIRE(updated == 10);
+    REQUIRE(test->draw_count == 4);
+
+    // Frames 12 and 13
+    scene.set_render_window(RenderWindow::seconds(3));
+    scene.wait(1);
+    REQUIRE(test->draw_count == 6);
+    REQUIRE(scene.get_render_window()->end_frame(4)
+            == std::numeric_limits<int>::max());
+
+    scene.set_render_window(std::nullopt);
+    scene.frame_advance();
+    REQUIRE(test->draw_count == 7);
+
+    REQUIRE_THROWS_AS(scene.set_render_window(RenderWindow::frames(3, 2)),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(scene.set_render_window(RenderWindow::seconds(-1)),
+                      std::invalid_argument);
+
+    REQUIRE(get_window_filename("out/scene.mp4", RenderWindow::frames(3, 9), 4)
+            == "out/scene.3-9.mp4");
+    REQUIRE(get_window_filename("scene.mp4", RenderWindow::seconds(1), 4)
+            == "scene.4-end.mp4");
 }
 
 TEST_CASE("Scene object removing itself in its updater", "[scene]") {
@@ -276,6 +323,251 @@ TEST_CASE("Scene depth_z object sorting", "[scene]") {
     REQUIRE(scene.get_pixel(0, 0, 0).g != 0);
 }
 
+TEST_CASE("Scene depth_z changing between frames", "[scene]") {
+    auto scene = TestScene(2, 2, 2, 2, 1);
+    using namespace vga2;
+    auto shape1 = make_polygon_shape({
+        -e1 - e2,
+        +e1 - e2,
+        +e1 + e2,
+        -e1 + e2,
+    });
+    auto shape2 = make_polygon_shape({
+        -e1 - e2,
+        +e1 - e2,
+        +e1 + e2,
+        -e1 + e2,
+    });
+    shape1->set_color("FF0000");
+    shape2->set_color("00FF00");
+    shape1->set_visible(true);
+    shape2->set_visible(true);
+    shape1->set_opacity(0.5);
+    scene.add(shape1, shape2);
+    scene.frame_advance();
+    shape1->set_depth_z(1);
+    scene.frame_advance();
+    shape1->set_depth_z(0);
+    scene.frame_advance();
+    REQUIRE(scene.get_pixel(0, 0, 0).r == 0);
+    REQUIRE(scene.get_pixel(1, 0, 0).r != 0);
+    REQUIRE(scene.get_pixel(1, 0, 0).g != 0);
+    REQUIRE(scene.get_pixel(2, 0, 0).r == 0);
+}
+
+TEST_CASE("Scene weighted transparency", "[scene]") {
+    using namespace vga2;
+    auto make_square = [](const char* color) {
+        auto result = make_polygon_shape({
+            -e1 - e2,
+            +e1 - e2,
+            +e1 + e2,
+            -e1 + e2,
+        });
+        result->set_color(color);
+        result->set_opacity(0.5);
+        result->set_visible(true);
+        return result;
+    };
+    auto red = make_square("FF0000");
+    auto green = make_square("00FF00");
+    auto scene1 = TestScene(2, 2, 2, 2, 1);
+    scene1.set_weighted_transparency(true);
+    scene1.add(red, green);
+    scene1.frame_advance();
+    auto scene2 = TestScene(2, 2, 2, 2, 1);
+    scene2.set_weighted_transparency(true);
+    scene2.add(green, red);
+    scene2.frame_advance();
+    auto pixel1 = scene1.get_pixel(0, 0, 0);
+    auto pixel2 = scene2.get_pixel(0, 0, 0);
+    REQUIRE(pixel1.r != 0);
+    REQUIRE(pixel1.g != 0);
+    REQUIRE(pixel1.r == pixel2.r);
+    REQUIRE(pixel1.g == pixel2.g);
+
+    // The group is opaque, but what's in it isn't
+    auto group = make_group(make_square("FF0000"), make_square("00FF00"));
+    group->draw_together();
+    group->set_visible(true);
+    REQUIRE(group->get_opacity() == 1.0);
+    auto scene3 = TestScene(2, 2, 2, 2, 1);
+    scene3.set_weighted_transparency(true);
+    scene3.add(group);
+    scene3.frame_advance();
+    auto pixel3 = scene3.get_pixel(0, 0, 0);
+    REQUIRE(pixel3.r == pixel1.r);
+    REQUIRE(pixel3.g == pixel1.g);
+}
+
+TEST_CASE("Scene framebuffer formats", "[scene]") {
+    using namespace vga2;
+    auto square = make_polygon_shape({
+        -2*e1 - 2*e2,
+        +2*e1 - 2*e2,
+        +2*e1 + 2*e2,
+        -2*e1 + 2*e2,
+    });
+    square->set_color("FF8000");
+    square->set_visible(true);
+    for (auto format : {FramebufferFormat::RGBA32F, FramebufferFormat::RGBA16F,
+                        FramebufferFormat::RGBA8, FramebufferFormat::RGB10_A2}) {
+        for (auto samples : {4, 1}) {
+            auto scene = TestScene(8, 8, 8, 8, 1);
+            scene.set_framebuffer_format(format, samples);
+            REQUIRE(scene.get_framebuffer_format() == format);
+            REQUIRE(scene.get_samples() == samples);
+            scene.set_transparency_layers(2);
+            scene.add(square);
+            scene.frame_advance();
+            auto inside = scene.get_pixel(0, 3, 3);
+            REQUIRE(inside.r == 255);
+            REQUIRE(inside.g == 128);
+            REQUIRE(inside.b == 0);
+            auto outside = scene.get_pixel(0, 0, 0);
+            REQUIRE(outside.r == 0);
+        }
+    }
+    auto scene = TestScene(1, 1, 1, 1, 1);
+    REQUIRE_THROWS_AS(scene.set_framebuffer_format(
+                FramebufferFormat::RGBA8, 0), std::invalid_argument);
+}
+
+TEST_CASE("Scene previews", "[scene]") {
+    using namespace vga2;
+    auto square = make_polygon_shape({
+        -2*e1 - 2*e2,
+        +2*e1 - 2*e2,
+        +2*e1 + 2*e2,
+        -2*e1 + 2*e2,
+    });
+    square->set_color("FF8000");
+    square->set_visible(true);
+    // 4 doesn't divide 6, so the framerate is divided by 3 instead
+    auto scene = TestScene(16, 16, 8, 8, 6, PreviewOptions{0.5, 4});
+    REQUIRE(scene.is_preview());
+    REQUIRE(scene.pixel_width() == 8);
+    REQUIRE(scene.pixel_height() == 8);
+    REQUIRE(scene.get_fps() == 2);
+    REQUIRE(scene.get_samples() == 1);
+    scene.set_framebuffer_format(FramebufferFormat::RGBA32F, 4);
+    REQUIRE(scene.get_samples() == 1);
+    scene.set_transparency_layers(2);
+    scene.add(square);
+    REQUIRE(square->get_fps() == 2);
+    scene.wait(1);
+    REQUIRE(scene.time_size() == 2);
+    REQUIRE(scene.get_time() == 1);
+    auto inside = scene.get_pixel(0, 3, 3);
+    REQUIRE(inside.r == 255);
+    REQUIRE(inside.g == 128);
+    REQUIRE(inside.b == 0);
+    REQUIRE(scene.get_pixel(0, 0, 0).r == 0);
+    REQUIRE(scene.get_pixel(0, 7, 7).r == 0);
+
+    auto options = PreviewOptions{0.3, 1};
+    REQUIRE(options.scale_pixels(15) == 4);
+    options.resolution_scale = 0.01;
+    REQUIRE(options.scale_pixels(15) == 2);
+    options.resolution_scale = 0;
+    REQUIRE_THROWS_AS(options.scale_pixels(15), std::invalid_argument);
+    options.fps_divisor = 0;
+    REQUIRE_THROWS_AS(options.scale_fps(15), std::invalid_argument);
+}
+
+TEST_CASE("Scene frame caching", "[scene]") {
+    using namespace vga2;
+    auto square = make_polygon_shape({
+        -e1 - e2,
+        +e1 - e2,
+        +e1 + e2,
+        -e1 + e2,
+    });
+    square->set_visible(true);
+    auto scene = TestScene(4, 4, 4, 4, 1);
+    scene.add(square);
+    scene.frame_advance(2);
+    REQUIRE(scene.get_repeated_frame_count() == 0);
+
+    scene.set_frame_caching(true);
+    scene.frame_advance(3);
+    REQUIRE(scene.get_repeated_frame_count() == 2);
+    REQUIRE(scene.time_size() == 5);
+    REQUIRE(scene.get_pixel(4, 1, 1) == Color("FFFFFF"));
+
+    square->shift(e1);
+    scene.frame_advance();
+    REQUIRE(scene.get_repeated_frame_count() == 2);
+    REQUIRE(scene.get_pixel(5, 1, 1) == Color("000000"));
+    REQUIRE(scene.get_pixel(5, 3, 1) == Color("FFFFFF"));
+    scene.frame_advance();
+    REQUIRE(scene.get_repeated_frame_count() == 3);
+    REQUIRE(scene.get_pixel(6, 1, 1) == Color("000000"));
+
+    scene.set_background_color("FF0000");
+    scene.frame_advance();
+    REQUIRE(scene.get_repeated_frame_count() == 3);
+    REQUIRE(scene.get_pixel(7, 0, 0) == Color("FF0000"));
+
+    auto other = make_polygon_shape({-e1, e1, e2});
+    scene.add(other);
+    scene.frame_advance();
+    REQUIRE(scene.get_repeated_frame_count() == 3);
+}
+
+TEST_CASE("Scene partial redraws", "[scene]") {
+    using namespace vga2;
+    auto make_square = [](double x) {
+        auto result = make_polygon_shape({
+            x*e1 - e2,
+            (x + 2)*e1 - e2,
+            (x + 2)*e1 + e2,
+            x*e1 + e2,
+        });
+        result->set_visible(true);
+        return result;
+    };
+    auto still = make_square(-6);
+    auto moving = make_square(2);
+    auto hidden = make_square(-2);
+    hidden->set_visible(false);
+    auto scene = TestScene(16, 16, 16, 16, 1);
+    scene.set_partial_redraws(true);
+    scene.add(still, moving, hidden);
+    scene.frame_advance();
+    REQUIRE(scene.get_pixel(0, 2, 7) == Color("FFFFFF"));
+    REQUIRE(scene.get_pixel(0, 10, 7) == Color("FFFFFF"));
+    REQUIRE(scene.get_pixel(0, 12, 7) == Color("000000"));
+
+    REQUIRE(scene.get_partial_frames().empty());
+
+    moving->shift(2*e1);
+    scene.frame_advance();
+    REQUIRE(scene.get_repeated_frame_count() == 0);
+    // Only the rows around the square were redrawn
+    REQUIRE(scene.get_partial_frames().size() == 1);
+    auto [y, height] = scene.get_partial_frames().back();
+    REQUIRE(y > 0);
+    REQUIRE(y + height < 16);
+    REQUIRE(scene.get_pixel(1, 2, 7) == Color("FFFFFF"));
+    REQUIRE(scene.get_pixel(1, 3, 8) == Color("FFFFFF"));
+    REQUIRE(scene.get_pixel(1, 10, 7) == Color("000000"));
+    REQUIRE(scene.get_pixel(1, 12, 7) == Color("FFFFFF"));
+    REQUIRE(scene.get_pixel(1, 13, 8) == Color("FFFFFF"));
+
+    // Changing something that isn't visible doesn't change the frame
+    hidden->set_color("FF0000");
+    scene.frame_advance();
+    REQUIRE(scene.get_repeated_frame_count() == 1);
+
+    hidden->set_visible(true);
+    scene.frame_advance();
+    REQUIRE(scene.get_partial_frames().size() == 2);
+    REQUIRE(scene.get_pixel(3, 6, 7) == Color("FF0000"));
+    REQUIRE(scene.get_pixel(3, 2, 7) == Color("FFFFFF"));
+    REQUIRE(scene.get_pixel(3, 12, 7) == Color("FFFFFF"));
+}
+
 TEST_CASE("Scene resetting to remove", "[scene]") {
     auto scene = TestScene(1, 1, 1, 1, 1);
     auto obj = ObjectPtr<TestDrawable>();
@@ -287,3 +579,31 @@ TEST_CASE("Scene resetting to remove", "[scene]") {
     scene.frame_advance();
     REQUIRE(destructed == old_destructed + 1);
 }
+
+TEST_CASE("Scene group changes", "[scene]") {
+    auto scene = TestScene(1, 1, 1, 1, 1);
+    auto group = make_group();
+    group->set_visible(true);
+    scene.add(group);
+    scene.frame_advance();
+    REQUIRE(scene.size() == 1);
+
+    auto obj1 = ObjectPtr<TestDrawable>();
+    auto obj2 = ObjectPtr<TestDrawable>();
+    group->add(obj1);
+    group->add(obj2);
+    obj1->set_visible(true);
+    obj2->set_visible(true);
+    group->remove(obj2);
+    scene.frame_advance();
+    REQUIRE(scene.size() == 2);
+    REQUIRE(obj1->draw_count == 1);
+    REQUIRE(obj2->draw_count == 0);
+
+    auto old_destructed = destructed;
+    group.reset();
+    obj1.reset();
+    scene.frame_advance();
+    REQUIRE(destructed == old_destructed + 1);
+    REQUIRE(scene.size() == 0);
+}
@@ -0,0 +1,83 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+
+#include "ganim/scene/chunked_render.hpp"
+
+using namespace ganim;
+
+TEST_CASE("Chunk filenames", "[scene]") {
+    auto a = get_chunk_filename("a/out.mp4", 3);
+    auto b = get_chunk_filename("b/out.mp4", 3);
+    REQUIRE(a != b);
+    REQUIRE(a == get_chunk_filename("a/../a/out.mp4", 3));
+    REQUIRE(a != get_chunk_filename("a/out.mp4", 4));
+    REQUIRE(a.ends_with(".3.mp4"));
+}
+
+TEST_CASE("Chunk assignments", "[scene]") {
+    auto chunks = ChunkAssignment{1, 3, 10};
+    REQUIRE(chunks.chunk_of(0) == 0);
+    REQUIRE(chunks.chunk_of(9) == 0);
+    REQUIRE(chunks.chunk_of(10) == 1);
+    REQUIRE(chunks.chunk_of(29) == 2);
+    REQUIRE(chunks.chunk_of(30) == 3);
+    REQUIRE(!chunks.owns_frame(9));
+    REQUIRE(chunks.owns_frame(10));
+    REQUIRE(chunks.owns_frame(19));
+    REQUIRE(!chunks.owns_frame(20));
+    // Chunks are dealt out to the workers in turn
+    REQUIRE(!chunks.owns_frame(30));
+    REQUIRE(chunks.owns_frame(40));
+
+    // Every frame is drawn by exactly one worker
+    for (auto workers : {1, 2, 3, 5}) {
+        for (auto chunk_frames : {1, 4, 7}) {
+            for (int frame = 0; frame < 100; ++frame) {
+                auto owners = 0;
+                for (int worker = 0; worker < workers; ++worker) {
+                    auto assignment
+                        = ChunkAssignment{worker, workers, chunk_frames};
+                    if (assignment.owns_frame(frame)) ++owners;
+                }
+                INFO("workers = " << workers << ", chunk frames = "
+                     << chunk_frames << ", frame = " << frame);
+                REQUIRE(owners == 1);
+            }
+        }
+    }
+}
+
+TEST_CASE("Chunk manifests", "[scene]") {
+    std::filesystem::create_directories("ganim_files/chunks");
+    std::filesystem::remove("ganim_files/chunks/worker_0.txt");
+    std::filesystem::remove("ganim_files/chunks/worker_1.txt");
+    auto worker0 = ChunkAssignment{0, 2, 10};
+    auto worker1 = ChunkAssignment{1, 2, 10};
+    // Chunks can be finished in any order, and a chunk that starts after
+    // skipped frames starts earlier in the output than in the scene
+    record_finished_chunk(worker1, "out/scene one.mp4", 1, 30, 7);
+    record_finished_chunk(worker0, "out/scene one.mp4", 2, 30, 17);
+    record_finished_chunk(worker0, "out/scene one.mp4", 0, 30, 0);
+    record_finished_chunk(worker1, "other.mp4", 3, 60, 30);
+    auto outputs = read_finished_chunks(2);
+    std::filesystem::remove("ganim_files/chunks/worker_0.txt");
+    std::filesystem::remove("ganim_files/chunks/worker_1.txt");
+
+    REQUIRE(outputs.size() == 2);
+    auto& scene = outputs.at("out/scene one.mp4");
+    REQUIRE(scene.fps == 30);
+    REQUIRE(scene.segments.size() == 3);
+    for (int i = 0; i < 3; ++i) {
+        REQUIRE(scene.segments[i].filename
+                == get_chunk_filename("out/scene one.mp4", i));
+    }
+    REQUIRE(scene.segments[0].start_frame == 0);
+    REQUIRE(scene.segments[1].start_frame == 7);
+    REQUIRE(scene.segments[2].start_frame == 17);
+    auto& other = outputs.at("other.mp4");
+    REQUIRE(other.fps == 60);
+    REQUIRE(other.segments.size() == 1);
+    REQUIRE(other.segments[0].filename == get_chunk_filename("other.mp4", 3));
+    REQUIRE(other.segments[0].start_frame == 30);
+}
@@ -0,0 +1,57 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "test_scene.hpp"
+#include "ganim/object/polygon_shape.hpp"
+
+using namespace ganim;
+
+TEST_CASE("Scene profiling", "[scene]") {
+    auto scene = TestScene(2, 2, 2, 2, 1);
+    REQUIRE(scene.get_profiler() == nullptr);
+    scene.enable_profiling();
+    REQUIRE(scene.get_profiler() != nullptr);
+    using namespace vga2;
+    auto shape = make_polygon_shape({
+        -e1 - e2,
+        +e1 - e2,
+        +e1 + e2,
+        -e1 + e2,
+    });
+    shape->set_visible(true);
+    scene.add(shape);
+    scene.frame_advance(2);
+    auto summary = scene.get_profiler()->summary();
+    REQUIRE(summary.find("updaters") != std::string::npos);
+    REQUIRE(summary.find("sort") != std::string::npos);
+    REQUIRE(summary.find("draw world") != std::string::npos);
+    REQUIRE(summary.find("process frame") != std::string::npos);
+}
+
+TEST_CASE("Profiler traces", "[scene]") {
+    auto filename = (std::filesystem::temp_directory_path()
+                     / "ganim_profiler_test.json").string();
+    {
+        auto profiler = Profiler();
+        profiler.begin_frame(0);
+        {
+            auto outer = Profiler::Scope(&profiler, "outer", true);
+            auto inner = Profiler::Scope(&profiler, "inner \"quoted\"", true);
+        }
+        auto no_profiler = Profiler::Scope(nullptr, "ignored");
+        profiler.write_trace(filename);
+    }
+    auto file = std::ifstream(filename);
+    auto contents = std::stringstream();
+    contents << file.rdbuf();
+    auto trace = contents.str();
+    REQUIRE(trace.starts_with("{\"traceEvents\":["));
+    REQUIRE(trace.find("\"outer\"") != std::string::npos);
+    REQUIRE(trace.find("inner \\\"quoted\\\"") != std::string::npos);
+    REQUIRE(trace.find("ignored") == std::string::npos);
+    REQUIRE(trace.find("\"cat\":\"gpu\"") != std::string::npos);
+    std::filesystem::remove(filename);
+}
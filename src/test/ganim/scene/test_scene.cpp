@@ -8,8 +8,10 @@
 TestScene::TestScene(
     int pixel_width, int pixel_height,
     double coord_width, double coord_height,
-    int fps
-) : SceneBase(pixel_width, pixel_height, coord_width, coord_height, fps) {}
+    int fps,
+    std::optional<ganim::PreviewOptions> preview
+) : SceneBase(pixel_width, pixel_height, coord_width, coord_height, fps,
+              preview) {}
 
 ganim::Color TestScene::get_pixel(int t, int x, int y)
 {
@@ -27,6 +29,12 @@ void TestScene::process_frame()
                  new_frame.data());
 }
 
+void TestScene::process_partial_frame(int y, int height)
+{
+    M_partial_frames.emplace_back(y, height);
+    process_frame();
+}
+
 void TestScene::check_draw_equivalent(
     ganim::ObjectPtr<ganim::Object> o1,
     ganim::ObjectPtr<ganim::Object> o2,
@@ -1,6 +1,7 @@
 #ifndef GANIM_TEST_SCENE_HPP
 #define GANIM_TEST_SCENE_HPP
 
+#include <utility>
 #include <vector>
 
 #include "ganim/scene/base.hpp"
@@ -12,7 +13,8 @@ class TestScene : public ganim::SceneBase {
         TestScene(
             int pixel_width, int pixel_height,
             double coord_width, double coord_height,
-            int fps
+            int fps,
+            std::optional<ganim::PreviewOptions> preview = std::nullopt
         );
         ganim::Color get_pixel(int t, int x, int y);
         void check_draw_equivalent(
@@ -22,11 +24,17 @@ class TestScene : public ganim::SceneBase {
             std::string_view write_to_file_filename = ""
         );
         constexpr int time_size() const {return M_data.size();}
+        using ganim::SceneBase::set_render_window;
         void write_frames_to_file(std::string_view filename_base) const;
+        // The rows passed to each call of process_partial_frame
+        const std::vector<std::pair<int, int>>& get_partial_frames() const
+            {return M_partial_frames;}
 
     private:
         virtual void process_frame() override;
+        virtual void process_partial_frame(int y, int height) override;
         std::vector<std::vector<std::uint8_t>> M_data;
+        std::vector<std::pair<int, int>> M_partial_frames;
 };
 
 #endif
@@ -3,6 +3,7 @@
 #include "ganim/util/alpha_threshold.hpp"
 
 #include "ganim/gl/gl.hpp"
+#include "ganim/util/compute_backend.hpp"
 
 using namespace ganim;
 
@@ -52,3 +53,35 @@ TEST_CASE("alpha_threshold", "[object]") {
         }
     }
 }
+
+TEST_CASE("alpha_threshold backends", "[object]") {
+    const auto width = 5;
+    const auto height = 3;
+    auto image = std::vector<float>(width * height * 4);
+    for (int i = 0; i < width * height; ++i) image[i*4 + 3] = i / 14.0f;
+    auto cpu = alpha_threshold_cpu(image, 0.5, width, height);
+    for (int i = 0; i < width * height; ++i) {
+        INFO("i = " << i);
+        REQUIRE(int(cpu[i]) == (i >= 7 ? 255 : 0));
+    }
+    REQUIRE_THROWS_AS(alpha_threshold_cpu(image, 0.5, width, height + 1),
+                      std::invalid_argument);
+
+    auto texture = gl::Texture();
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(
+        GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0,
+        GL_RGBA, GL_FLOAT, image.data()
+    );
+    for (auto backend : {ComputeBackend::CPU, ComputeBackend::GPU}) {
+        set_compute_backend(backend);
+        auto tex = alpha_threshold(texture, 0.5, width, height);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        auto data = std::vector<unsigned char>(width * height);
+        glGetTextureImage(
+            tex, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, data.size(), data.data()
+        );
+        REQUIRE(std::vector<std::uint8_t>(data.begin(), data.end()) == cpu);
+    }
+    set_compute_backend(ComputeBackend::Automatic);
+}
@@ -3,8 +3,11 @@
 #include "ganim/util/distance_transform.hpp"
 
 #include <cmath>
+#include <limits>
+#include <vector>
 
 #include "ganim/gl/gl.hpp"
+#include "ganim/util/compute_backend.hpp"
 
 using namespace ganim;
 
@@ -58,3 +61,180 @@ TEST_CASE("distance_transform", "[object]") {
         }
     }
 }
+
+namespace {
+    // The slow but obviously correct way to do it
+    std::vector<float> brute_force(
+        const std::vector<std::uint8_t>& image,
+        int width,
+        int height
+    )
+    {
+        auto result = std::vector<float>(
+            image.size(), std::numeric_limits<float>::infinity());
+        for (int y1 = 0; y1 < height; ++y1) {
+            for (int x1 = 0; x1 < width; ++x1) {
+                auto& d = result[x1 + y1*width];
+                for (int y2 = 0; y2 < height; ++y2) {
+                    for (int x2 = 0; x2 < width; ++x2) {
+                        if (image[x2 + y2*width] != 255) continue;
+                        auto dx = double(x1 - x2);
+                        auto dy = double(y1 - y2);
+                        d = std::min(d, float(std::sqrt(dx*dx + dy*dy)));
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    std::vector<std::uint8_t> test_image(int width, int height)
+    {
+        auto result = std::vector<std::uint8_t>(width * height);
+        for (int i = 0; i < width * height; ++i) {
+            // Something irregular but the same every time
+            if ((i * 7919) % 23 == 0) result[i] = 255;
+        }
+        return result;
+    }
+}
+
+TEST_CASE("distance_transform_cpu", "[object]") {
+    const auto width = 37;
+    const auto height = 13;
+    auto image = test_image(width, height);
+    auto expected = brute_force(image, width, height);
+    auto result = distance_transform_cpu(image, width, height);
+    REQUIRE(result == expected);
+
+    auto scaled = distance_transform_cpu(image, width, height, 0.5);
+    for (int i = 0; i < width * height; ++i) {
+        REQUIRE(scaled[i] == float(double(expected[i]) * 0.5));
+    }
+
+    auto empty = std::vector<std::uint8_t>(6);
+    for (auto d : distance_transform_cpu(empty, 3, 2)) {
+        REQUIRE(std::isinf(d));
+    }
+
+    REQUIRE_THROWS_AS(distance_transform_cpu(image, 0, height),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(distance_transform_cpu(image, width, height + 1),
+                      std::invalid_argument);
+}
+
+TEST_CASE("distance_transform backends", "[object]") {
+    const auto width = 20;
+    const auto height = 12;
+    auto image = test_image(width, height);
+    auto expected = brute_force(image, width, height);
+    auto texture = gl::Texture();
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(
+        GL_TEXTURE_2D, 0, GL_R8UI, width, height, 0,
+        GL_RED_INTEGER, GL_UNSIGNED_BYTE, image.data()
+    );
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    for (auto backend : {ComputeBackend::CPU, ComputeBackend::GPU}) {
+        set_compute_backend(backend);
+        auto tex = distance_transform(texture, width, height);
+        REQUIRE_THROWS_AS(distance_transform(texture, width, width),
+                          std::invalid_argument);
+        auto data = std::vector<float>(width * height);
+        glGetTextureImage(tex, 0, GL_RED, GL_FLOAT,
+                          data.size() * sizeof(float), data.data());
+        for (int i = 0; i < width * height; ++i) {
+            INFO("i = " << i);
+            // Jump flooding is only approximate, but it's exact this close
+            // to the pixels
+            if (backend == ComputeBackend::GPU and expected[i] > 2) continue;
+            REQUIRE(data[i] == expected[i]);
+        }
+    }
+    set_compute_backend(ComputeBackend::Automatic);
+}
+
+namespace {
+    std::vector<float> brute_force_regions(
+        const std::vector<std::uint8_t>& image,
+        int width,
+        std::span<const DistanceTransformRegion> regions
+    )
+    {
+        auto result = std::vector<float>(
+            image.size(), std::numeric_limits<float>::infinity());
+        for (auto& r : regions) {
+            auto part = std::vector<std::uint8_t>(r.width * r.height);
+            for (int y = 0; y < r.height; ++y) {
+                for (int x = 0; x < r.width; ++x) {
+                    part[x + y*r.width] = image[r.x + x + (r.y + y)*width];
+                }
+            }
+            auto distances = brute_force(part, r.width, r.height);
+            for (int y = 0; y < r.height; ++y) {
+                for (int x = 0; x < r.width; ++x) {
+                    result[r.x + x + (r.y + y)*width]
+                        = distances[x + y*r.width];
+                }
+            }
+        }
+        return result;
+    }
+}
+
+TEST_CASE("distance_transform regions", "[object]") {
+    const auto width = 20;
+    const auto height = 12;
+    auto image = test_image(width, height);
+    const auto regions = std::vector<DistanceTransformRegion>{
+        {0, 0, 8, 8},
+        {8, 0, 12, 6},
+        {10, 7, 6, 5}
+    };
+    auto expected = brute_force_regions(image, width, regions);
+    REQUIRE(distance_transform_cpu(image, width, height, regions)
+            == expected);
+
+    auto overlapping = std::vector<DistanceTransformRegion>{
+        {0, 0, 8, 8},
+        {7, 7, 2, 2}
+    };
+    REQUIRE_THROWS_AS(
+        distance_transform_cpu(image, width, height, overlapping),
+        std::invalid_argument);
+    auto outside = std::vector<DistanceTransformRegion>{{15, 0, 6, 6}};
+    REQUIRE_THROWS_AS(distance_transform_cpu(image, width, height, outside),
+                      std::invalid_argument);
+
+    auto texture = gl::Texture();
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(
+        GL_TEXTURE_2D, 0, GL_R8UI, width, height, 0,
+        GL_RED_INTEGER, GL_UNSIGNED_BYTE, image.data()
+    );
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    for (auto backend : {ComputeBackend::CPU, ComputeBackend::GPU}) {
+        set_compute_backend(backend);
+        auto tex = distance_transform(texture, width, height, regions);
+        REQUIRE_THROWS_AS(
+            distance_transform(texture, width, height, overlapping),
+            std::invalid_argument);
+        auto data = std::vector<float>(width * height);
+        glGetTextureImage(tex, 0, GL_RED, GL_FLOAT,
+                          data.size() * sizeof(float), data.data());
+        for (int i = 0; i < width * height; ++i) {
+            INFO("i = " << i);
+            if (std::isinf(expected[i])) {
+                REQUIRE(std::isinf(data[i]));
+                continue;
+            }
+            if (backend == ComputeBackend::GPU and expected[i] > 2) continue;
+            REQUIRE(data[i] == expected[i]);
+        }
+    }
+    set_compute_backend(ComputeBackend::Automatic);
+}
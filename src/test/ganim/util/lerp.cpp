@@ -0,0 +1,98 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <vector>
+
+#include "ganim/util/lerp.hpp"
+#include "ganim/object/shape.hpp"
+
+using namespace ganim;
+
+TEST_CASE("lerp_floats", "[util]") {
+    // Go through enough sizes to hit every tail of the vector loops
+    for (int size = 0; size < 40; ++size) {
+        INFO("size = " << size);
+        auto start = std::vector<float>();
+        auto end = std::vector<float>();
+        for (int i = 0; i < size; ++i) {
+            start.push_back(i * 0.5f - 3);
+            end.push_back(i * -1.25f + 7);
+        }
+        auto output = std::vector<float>(size);
+        lerp_floats(start, end, output, 0);
+        REQUIRE(output == start);
+        lerp_floats(start, end, output, 1);
+        REQUIRE(output == end);
+        lerp_floats(start, end, output, 0.25);
+        for (int i = 0; i < size; ++i) {
+            REQUIRE(output[i] == 0.75f * start[i] + 0.25f * end[i]);
+        }
+        lerp_floats(start, end, start, 0.25);
+        REQUIRE(start == output);
+    }
+}
+
+TEST_CASE("lerp_floats large", "[util]") {
+    // Big enough to be split across threads
+    constexpr int size = 1 << 21;
+    auto start = std::vector<float>(size);
+    auto end = std::vector<float>(size);
+    for (int i = 0; i < size; ++i) {
+        start[i] = i % 1000;
+        end[i] = -(i % 777);
+    }
+    auto output = std::vector<float>(size);
+    lerp_floats(start, end, output, 0.5);
+    for (int i = 0; i < size; i += 997) {
+        REQUIRE(output[i] == 0.5f * start[i] + 0.5f * end[i]);
+    }
+    REQUIRE(output.back() == 0.5f * start.back() + 0.5f * end.back());
+}
+
+TEST_CASE("lerp_floats size mismatch", "[util]") {
+    auto a = std::vector<float>(4);
+    auto b = std::vector<float>(5);
+    auto c = std::vector<float>(4);
+    REQUIRE_THROWS_AS(lerp_floats(a, b, c, 0.5), std::invalid_argument);
+    REQUIRE_THROWS_AS(lerp_floats(a, c, b, 0.5), std::invalid_argument);
+}
+
+// Run with ./test "[benchmark]" to compare against the old per-field loop
+TEST_CASE("lerp_floats benchmark", "[.benchmark]") {
+    auto sphere1 = make_sphere(1, 316, 316);
+    auto sphere2 = make_sphere(2, 316, 316);
+    const auto& start = sphere1->get_vertices();
+    const auto& end = sphere2->get_vertices();
+    auto output = start;
+    const double t = 0.3;
+
+    BENCHMARK("Scalar Shape::Vertex loop") {
+        for (int i = 0; i < ssize(output); ++i) {
+            auto& v1 = start[i];
+            auto& v2 = output[i];
+            auto& v3 = end[i];
+            v2.x = (1 - t)*v1.x + t*v3.x;
+            v2.y = (1 - t)*v1.y + t*v3.y;
+            v2.z = (1 - t)*v1.z + t*v3.z;
+            v2.t = (1 - t)*v1.t + t*v3.t;
+            v2.r = (1 - t)*v1.r + t*v3.r;
+            v2.g = (1 - t)*v1.g + t*v3.g;
+            v2.b = (1 - t)*v1.b + t*v3.b;
+            v2.a = (1 - t)*v1.a + t*v3.a;
+        }
+        return output[0].x;
+    };
+    BENCHMARK("lerp_floats") {
+        lerp_floats(
+            {reinterpret_cast<const float*>(start.data()), 8 * start.size()},
+            {reinterpret_cast<const float*>(end.data()), 8 * end.size()},
+            {reinterpret_cast<float*>(output.data()), 8 * output.size()},
+            t
+        );
+        return output[0].x;
+    };
+    BENCHMARK("Shape::interpolate") {
+        sphere1->interpolate(*sphere1, *sphere2, t);
+        return sphere1->get_vertices()[0].x;
+    };
+}
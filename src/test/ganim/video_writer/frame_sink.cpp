@@ -0,0 +1,104 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "ganim/video_writer/frame_sink.hpp"
+#include "ganim/video_writer/image_sequence_writer.hpp"
+#include "ganim/video_writer/video_writer.hpp"
+
+using namespace ganim;
+
+namespace {
+    std::string read_file(const std::filesystem::path& path)
+    {
+        auto file = std::ifstream(path, std::ios::binary);
+        auto contents = std::stringstream();
+        contents << file.rdbuf();
+        return contents.str();
+    }
+}
+
+TEST_CASE("Null frame sink", "[video_writer]") {
+    auto image = std::vector<std::uint8_t>(2*2*3);
+    auto sink = make_frame_sink("null", 2, 2, 30, VideoWriterOptions());
+    auto& null_sink = dynamic_cast<NullFrameSink&>(*sink);
+    sink->write_frame(image);
+    sink->write_frame(image, 3);
+    REQUIRE(null_sink.get_frame_count() == 4);
+    REQUIRE_THROWS_AS(sink->write_frame(image, 0), std::invalid_argument);
+}
+
+TEST_CASE("Image sequences", "[video_writer]") {
+    const auto directory = std::filesystem::temp_directory_path()
+                         / "ganim_image_sequence_test";
+    std::filesystem::create_directories(directory);
+    const auto filename = (directory / "frames.rgb").string();
+    auto image1 = std::vector<std::uint8_t>{1, 2, 3, 4, 5, 6};
+    auto image2 = std::vector<std::uint8_t>{7, 8, 9, 10, 11, 12};
+    for (auto threads : {0, 2}) {
+        auto writer = ImageSequenceWriter(
+            filename, 2, 1, ImageFormat::Raw, 5, threads, 1);
+        REQUIRE(writer.get_image_filename(5)
+                == (directory / "frames.000005.rgb").string());
+        writer.write_frame(image1);
+        writer.write_frame(image2, 2);
+        writer.set_frame_number(10);
+        writer.write_frame(image1);
+        REQUIRE_THROWS_AS(writer.write_frame(std::span(image1).first(3)),
+                          std::invalid_argument);
+        writer.finish();
+        auto expected1 = std::string(image1.begin(), image1.end());
+        auto expected2 = std::string(image2.begin(), image2.end());
+        REQUIRE(read_file(directory / "frames.000005.rgb") == expected1);
+        REQUIRE(read_file(directory / "frames.000006.rgb") == expected2);
+        REQUIRE(read_file(directory / "frames.000007.rgb") == expected2);
+        REQUIRE(!std::filesystem::exists(directory / "frames.000008.rgb"));
+        REQUIRE(read_file(directory / "frames.000010.rgb") == expected1);
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+    }
+    std::filesystem::remove_all(directory);
+    auto sink = make_frame_sink(
+        (directory / "png" / "frames.png").string(), 2, 1, 30,
+        VideoWriterOptions());
+    sink->write_frame(image1);
+    sink->finish();
+    auto png = read_file(directory / "png" / "frames.000000.png");
+    REQUIRE(png.starts_with("\x89PNG"));
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("QOI encoding", "[video_writer]") {
+    auto image = std::vector<std::uint8_t>{255, 0, 0, 255, 0, 0};
+    auto qoi = encode_qoi(image, 2, 1);
+    auto expected = std::string("qoif\0\0\0\2\0\0\0\1\3\0", 14);
+    // The first pixel is a small difference from the starting black pixel,
+    // and the second one is a run of the first
+    expected += "\x5a\xc0";
+    expected += std::string("\0\0\0\0\0\0\0\1", 8);
+    REQUIRE(qoi == expected);
+}
+
+TEST_CASE("Raw frame streams", "[video_writer]") {
+    const auto filename = std::filesystem::temp_directory_path()
+                        / "ganim_raw_stream_test.rgb";
+    auto image = std::vector<std::uint8_t>{1, 2, 3, 4, 5, 6};
+    {
+        auto sink = make_frame_sink("pipe:" + filename.string(), 1, 2, 30,
+                                    VideoWriterOptions());
+        REQUIRE(dynamic_cast<RawStreamWriter*>(sink.get()));
+        sink->write_frame(image, 2);
+    }
+    auto contents = read_file(filename);
+    REQUIRE(contents.size() == 12);
+    REQUIRE(contents.substr(6) == std::string(image.begin(), image.end()));
+    std::filesystem::remove(filename);
+    REQUIRE(is_video_filename("scene.mp4"));
+    REQUIRE(!is_video_filename("scene.qoi"));
+    REQUIRE(!is_video_filename("-"));
+    REQUIRE(is_raw_stream_filename("-"));
+    REQUIRE(is_raw_stream_filename("pipe:frames"));
+    REQUIRE(!is_raw_stream_filename("scene.mp4"));
+}